@@ -0,0 +1,89 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationTracker.hpp"
+
+#ifdef TRACK_ALLOCATIONS
+
+static std::atomic<uint64_t> gAllocationCount{0};
+static std::atomic<uint64_t> gAllocatedBytes{0};
+
+static void *TrackedAllocate(std::size_t size)
+{
+    gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    gAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+    // malloc(0) may return nullptr, operator new must return a unique pointer
+    void *ptr = std::malloc(size != 0 ? size : 1);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void *operator new(std::size_t size)
+{
+    return TrackedAllocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return TrackedAllocate(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+bool AllocationTracker::IsEnabled()
+{
+    return true;
+}
+
+uint64_t AllocationTracker::GetAllocationCount()
+{
+    return gAllocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::GetAllocatedBytes()
+{
+    return gAllocatedBytes.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool AllocationTracker::IsEnabled()
+{
+    return false;
+}
+
+uint64_t AllocationTracker::GetAllocationCount()
+{
+    return 0;
+}
+
+uint64_t AllocationTracker::GetAllocatedBytes()
+{
+    return 0;
+}
+
+#endif
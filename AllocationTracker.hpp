@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts heap allocations made through global operator new.
+// Counting is only compiled in when TRACK_ALLOCATIONS is defined (make TRACK_ALLOCATIONS=1),
+// otherwise the global operators are left untouched and all counters stay 0.
+class AllocationTracker
+{
+public:
+    static bool IsEnabled();
+
+    static uint64_t GetAllocationCount(); // Number of operator new calls since start up
+    static uint64_t GetAllocatedBytes();  // Total bytes requested from operator new since start up
+};
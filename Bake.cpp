@@ -0,0 +1,199 @@
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <cstdlib>
+#include <algorithm>
+#include <cctype>
+
+#include "stb_image.h"
+
+#include "BlockCompression.hpp"
+#include "Ktx2File.hpp"
+
+// Command line options for the texture baker
+struct BakeOptions
+{
+    std::vector<std::string> inputFiles{};  // Images to bake, every image in Textures/ if empty
+    std::string format = "auto";            // bc1, bc3, bc7, rgba8 or auto (bc3 for images with alpha, otherwise bc1)
+    bool mipmaps = true;                    // Write full mip chain, otherwise only the full size image
+};
+
+static void PrintUsage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [options] [image...]\n"
+              << "  Bakes images to <image>.<ext>.ktx2 next to them (default: every image in Textures/)\n"
+              << "  --format <f>          bc1, bc3, bc7, rgba8 or auto: bc3 if the image has alpha, otherwise bc1 (default auto)\n"
+              << "                        bc7 is the same size as bc3 but higher quality, and slower to bake\n"
+              << "  --no-mips             only store the full size image\n";
+}
+
+static bool ParseOptions(int argc, char *argv[], BakeOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--no-mips")
+        {
+            options.mipmaps = false;
+        }
+        else if (arg == "--format" && hasValue)
+        {
+            options.format = argv[++i];
+        }
+        else if (arg.rfind("--", 0) == 0)
+        {
+            return false;
+        }
+        else
+        {
+            options.inputFiles.push_back(arg);
+        }
+    }
+
+    return options.format == "auto" || options.format == "bc1" || options.format == "bc3" || options.format == "bc7" ||
+           options.format == "rgba8";
+}
+
+static bool IsImageFile(const std::filesystem::path &path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp";
+}
+
+static VkFormat ChooseFormat(const std::string &format, const stbi_uc *pixels, size_t pixelCount)
+{
+    if (format == "bc1")
+    {
+        return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    }
+    if (format == "bc3")
+    {
+        return VK_FORMAT_BC3_UNORM_BLOCK;
+    }
+    if (format == "bc7")
+    {
+        return VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+    if (format == "rgba8")
+    {
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    // Auto: BC1 has no alpha, so only use BC3 when it is needed
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        if (pixels[i * 4 + 3] != 255)
+        {
+            return VK_FORMAT_BC3_UNORM_BLOCK;
+        }
+    }
+    return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+}
+
+static bool BakeTexture(const std::string &inputFile, const BakeOptions &options)
+{
+    int width, height, channels;
+    stbi_uc *pixels = stbi_load(inputFile.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (pixels == nullptr)
+    {
+        std::cerr << "Failed to load " << inputFile << std::endl;
+        return false;
+    }
+
+    VkFormat format = ChooseFormat(options.format, pixels, static_cast<size_t>(width) * height);
+
+    // Build mip chain from the full RGBA8 image, each level is filtered from the previous uncompressed level
+    std::vector<std::vector<uint8_t>> levels;
+    std::vector<uint8_t> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    uint32_t levelWidth = static_cast<uint32_t>(width);
+    uint32_t levelHeight = static_cast<uint32_t>(height);
+    while (true)
+    {
+        if (BlockCompression::IsCompressed(format))
+        {
+            levels.push_back(BlockCompression::Compress(level.data(), levelWidth, levelHeight, format));
+        }
+        else
+        {
+            levels.push_back(level);
+        }
+
+        if (!options.mipmaps || (levelWidth == 1 && levelHeight == 1))
+        {
+            break;
+        }
+
+        level = BlockCompression::Downsample(level.data(), levelWidth, levelHeight);
+        levelWidth = std::max(levelWidth / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+    }
+
+    std::string outputFile = Ktx2File::GetBakedPath(inputFile);
+    if (!Ktx2File::Write(outputFile, format, static_cast<uint32_t>(width), static_cast<uint32_t>(height), levels))
+    {
+        std::cerr << "Failed to write " << outputFile << std::endl;
+        return false;
+    }
+
+    size_t bakedBytes = 0;
+    for (const std::vector<uint8_t> &bakedLevel : levels)
+    {
+        bakedBytes += bakedLevel.size();
+    }
+
+    std::cout << inputFile << " -> " << outputFile << " (" << width << "x" << height << ", "
+              << (format == VK_FORMAT_BC1_RGB_UNORM_BLOCK ? "BC1" : (format == VK_FORMAT_BC3_UNORM_BLOCK ? "BC3" : (format == VK_FORMAT_BC7_UNORM_BLOCK ? "BC7" : "RGBA8")))
+              << ", " << levels.size() << " levels, " << bakedBytes / 1024 << " KB, RGBA8 "
+              << static_cast<size_t>(width) * height * 4 / 1024 << " KB)" << std::endl;
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    BakeOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (options.inputFiles.empty())
+    {
+        std::error_code error;
+        for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator("Textures", error))
+        {
+            if (entry.is_regular_file() && IsImageFile(entry.path()))
+            {
+                options.inputFiles.push_back(entry.path().generic_string());
+            }
+        }
+
+        if (error)
+        {
+            std::cerr << "Failed to list Textures/" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    int failures = 0;
+    for (const std::string &inputFile : options.inputFiles)
+    {
+        if (!BakeTexture(inputFile, options))
+        {
+            failures++;
+        }
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,565 @@
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "VulkanRenderer.h"
+#include "AllocationTracker.hpp"
+
+// Command line options for the benchmark run
+struct BenchOptions
+{
+    std::string modelFile = "Models/uh60.obj"; // Model loaded through CreateMeshModel
+    std::string outputFile{};                  // JSON output file, stdout if empty
+    int instances = 0;                         // Instances of the model drawn with it, on a grid behind it
+    int frames = 1000;                         // Number of measured frames
+    int warmupFrames = 100;                    // Frames drawn before measuring starts
+    int width = 1280;                          // Render target width
+    int height = 720;                          // Render target height
+    bool windowed = false;                     // Render to a window instead of offscreen targets
+    bool assertZeroAllocations = false;        // Fail if any measured frame allocates on the heap
+    RendererSettings settings{};               // Renderer options under test
+};
+
+// Per-frame samples of a single measured stage, in milliseconds
+struct StageSamples
+{
+    const char *name;
+    std::vector<double> values;
+};
+
+// Everything measured during a run
+struct BenchResults
+{
+    double modelLoadMs = 0.0;               // CreateMeshModel time
+    std::vector<StageSamples> stages{};     // Per-frame CPU times, first entry is the whole frame
+    std::vector<uint64_t> frameAllocations; // Heap allocations made by each measured frame
+    MemoryStatistics memory{};              // Device memory in use after the last frame
+    ImportStatistics import{};              // Mesh optimization of the loaded model
+    uint64_t visibleModels = 0;             // Models the scene tree found in the view frustum, summed over measured frames
+    uint64_t culledModels = 0;              // Models outside the view frustum, summed over measured frames
+    uint64_t visibleMeshes = 0;             // Meshes drawn, summed over measured frames
+    uint64_t culledMeshes = 0;              // Meshes outside the view frustum, summed over measured frames
+    std::array<uint64_t, BIND_TYPE_COUNT> bindsIssued{};  // Binds in the command buffer drawn, by BindType, summed over measured frames
+    std::array<uint64_t, BIND_TYPE_COUNT> bindsSkipped{}; // Binds left out because the state was already bound
+};
+
+static void PrintUsage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --model <file>        model to load (default Models/uh60.obj)\n"
+              << "  --instances <n>       instances of the model to draw with it (default 0)\n"
+              << "  --frames <n>          measured frames (default 1000)\n"
+              << "  --warmup <n>          warm-up frames, not measured (default 100)\n"
+              << "  --width <n>           render width (default 1280)\n"
+              << "  --height <n>          render height (default 720)\n"
+              << "  --window              render to a window instead of offscreen targets\n"
+              << "  --cache               keep recorded command buffers across frames\n"
+              << "  --no-transfer-queue   upload through the graphics queue even if a transfer queue exists\n"
+              << "  --staging-ring <mb>   size of the upload staging ring (default 32)\n"
+              << "  --import-threads <n>  worker threads used to load the model (default 0: one per hardware thread)\n"
+              << "  --no-mesh-cache       always import the model with Assimp, don't read or write a .meshcache file\n"
+              << "  --vertex-format <f>   full (32 bytes), compact (16) or quantized (12) vertices (default full)\n"
+              << "  --optimize            reorder imported meshes for the vertex cache, overdraw and vertex fetch\n"
+              << "  --strips              draw meshes as triangle strips where that takes fewer indices\n"
+              << "  --lods                generate simplified levels of detail and draw them by size on screen\n"
+              << "  --lod-error <px>      screen space error allowed before a finer level of detail is drawn (default 1)\n"
+              << "  --no-cull             draw every mesh, even those outside the view frustum\n"
+              << "  --gpu-driven          cull and choose LODs in a compute pass, draw with indirect commands\n"
+              << "  --bindless            index one array of every texture per draw instead of binding a set per texture\n"
+              << "  --assert-no-alloc     fail if a measured frame allocates (needs TRACK_ALLOCATIONS build)\n"
+              << "  --output <file>       write JSON report to file instead of stdout\n";
+}
+
+static const char *VertexFormatName(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::Compact:
+        return "compact";
+    case VertexFormat::Quantized:
+        return "quantized";
+    default:
+        return "full";
+    }
+}
+
+static const char *BindTypeName(size_t type)
+{
+    switch (static_cast<BindType>(type))
+    {
+    case BindType::Pipeline:
+        return "pipeline";
+    case BindType::VertexBuffer:
+        return "vertexBuffer";
+    case BindType::IndexBuffer:
+        return "indexBuffer";
+    default:
+        return "descriptorSet";
+    }
+}
+
+static bool ParseVertexFormat(const std::string &name, VertexFormat *format)
+{
+    for (size_t i = 0; i < VERTEX_FORMAT_COUNT; i++)
+    {
+        if (name == VertexFormatName(static_cast<VertexFormat>(i)))
+        {
+            *format = static_cast<VertexFormat>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool ParseOptions(int argc, char *argv[], BenchOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--window")
+        {
+            options.windowed = true;
+        }
+        else if (arg == "--cache")
+        {
+            options.settings.cacheCommandBuffers = true;
+        }
+        else if (arg == "--no-transfer-queue")
+        {
+            options.settings.useTransferQueue = false;
+        }
+        else if (arg == "--no-mesh-cache")
+        {
+            options.settings.useMeshCache = false;
+        }
+        else if (arg == "--optimize")
+        {
+            options.settings.optimizeMeshes = true;
+        }
+        else if (arg == "--strips")
+        {
+            options.settings.useTriangleStrips = true;
+        }
+        else if (arg == "--lods")
+        {
+            options.settings.generateLods = true;
+        }
+        else if (arg == "--no-cull")
+        {
+            options.settings.frustumCulling = false;
+        }
+        else if (arg == "--gpu-driven")
+        {
+            options.settings.gpuDrivenRendering = true;
+        }
+        else if (arg == "--bindless")
+        {
+            options.settings.bindlessTextures = true;
+        }
+        else if (arg == "--assert-no-alloc")
+        {
+            options.assertZeroAllocations = true;
+        }
+        else if (arg == "--model" && hasValue)
+        {
+            options.modelFile = argv[++i];
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            options.outputFile = argv[++i];
+        }
+        else if (arg == "--instances" && hasValue)
+        {
+            options.instances = std::atoi(argv[++i]);
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            options.frames = std::atoi(argv[++i]);
+        }
+        else if (arg == "--warmup" && hasValue)
+        {
+            options.warmupFrames = std::atoi(argv[++i]);
+        }
+        else if (arg == "--width" && hasValue)
+        {
+            options.width = std::atoi(argv[++i]);
+        }
+        else if (arg == "--height" && hasValue)
+        {
+            options.height = std::atoi(argv[++i]);
+        }
+        else if (arg == "--import-threads" && hasValue)
+        {
+            options.settings.importThreads = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--vertex-format" && hasValue)
+        {
+            if (!ParseVertexFormat(argv[++i], &options.settings.vertexFormat))
+            {
+                return false;
+            }
+        }
+        else if (arg == "--lod-error" && hasValue)
+        {
+            options.settings.lodErrorPixels = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--staging-ring" && hasValue)
+        {
+            options.settings.stagingRingSize = static_cast<VkDeviceSize>(std::atoi(argv[++i])) * 1024 * 1024;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return options.frames > 0 && options.warmupFrames >= 0 && options.width > 0 && options.height > 0 &&
+           options.settings.stagingRingSize > 0 && options.settings.lodErrorPixels > 0.0f;
+}
+
+// Text as a JSON string literal, with quotes, backslashes and control characters escaped
+static std::string JsonString(const std::string &text)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            quoted += "\\\"";
+            break;
+        case '\\':
+            quoted += "\\\\";
+            break;
+        case '\n':
+            quoted += "\\n";
+            break;
+        case '\r':
+            quoted += "\\r";
+            break;
+        case '\t':
+            quoted += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                quoted += "\\u00";
+                quoted += hexDigits[(c >> 4) & 0xF];
+                quoted += hexDigits[c & 0xF];
+            }
+            else
+            {
+                quoted += c;
+            }
+            break;
+        }
+    }
+    quoted += '"';
+
+    return quoted;
+}
+
+// Nearest-rank percentile of sorted samples
+static double Percentile(const std::vector<double> &sorted, double percent)
+{
+    size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * sorted.size()));
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+static void WriteStage(std::ostream &out, const StageSamples &stage)
+{
+    std::vector<double> sorted = stage.values;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (double value : sorted)
+    {
+        sum += value;
+    }
+
+    out << "    \"" << stage.name << "\": {"
+        << " \"mean\": " << sum / sorted.size()
+        << ", \"p50\": " << Percentile(sorted, 50.0)
+        << ", \"p95\": " << Percentile(sorted, 95.0)
+        << ", \"p99\": " << Percentile(sorted, 99.0)
+        << ", \"max\": " << sorted.back()
+        << " }";
+}
+
+static void WriteReport(std::ostream &out, const BenchOptions &options, const BenchResults &results)
+{
+    uint64_t totalAllocations = 0;
+    uint64_t maxAllocations = 0;
+    for (uint64_t allocations : results.frameAllocations)
+    {
+        totalAllocations += allocations;
+        maxAllocations = std::max(maxAllocations, allocations);
+    }
+
+    out.setf(std::ios::fixed);
+    out.precision(4);
+
+    out << "{\n"
+        << "  \"model\": " << JsonString(options.modelFile) << ",\n"
+        << "  \"mode\": \"" << (options.windowed ? "window" : "headless") << "\",\n"
+        << "  \"instances\": " << options.instances << ",\n"
+        << "  \"cacheCommandBuffers\": " << (options.settings.cacheCommandBuffers ? "true" : "false") << ",\n"
+        << "  \"useTransferQueue\": " << (options.settings.useTransferQueue ? "true" : "false") << ",\n"
+        << "  \"stagingRingMB\": " << options.settings.stagingRingSize / (1024 * 1024) << ",\n"
+        << "  \"importThreads\": " << options.settings.importThreads << ",\n"
+        << "  \"useMeshCache\": " << (options.settings.useMeshCache ? "true" : "false") << ",\n"
+        << "  \"vertexFormat\": \"" << VertexFormatName(options.settings.vertexFormat) << "\",\n"
+        << "  \"optimizeMeshes\": " << (options.settings.optimizeMeshes ? "true" : "false") << ",\n"
+        << "  \"useTriangleStrips\": " << (options.settings.useTriangleStrips ? "true" : "false") << ",\n"
+        << "  \"generateLods\": " << (options.settings.generateLods ? "true" : "false") << ",\n"
+        << "  \"lodErrorPixels\": " << options.settings.lodErrorPixels << ",\n"
+        << "  \"frustumCulling\": " << (options.settings.frustumCulling ? "true" : "false") << ",\n"
+        << "  \"gpuDrivenRendering\": " << (options.settings.gpuDrivenRendering ? "true" : "false") << ",\n"
+        << "  \"bindlessTextures\": " << (options.settings.bindlessTextures ? "true" : "false") << ",\n"
+        << "  \"width\": " << options.width << ",\n"
+        << "  \"height\": " << options.height << ",\n"
+        << "  \"warmupFrames\": " << options.warmupFrames << ",\n"
+        << "  \"frames\": " << options.frames << ",\n"
+        << "  \"modelLoadMs\": " << results.modelLoadMs << ",\n"
+        << "  \"meshOptimization\": {"
+        << " \"meshCacheHit\": " << (results.import.meshCacheHit ? "true" : "false")
+        << ", \"meshes\": " << results.import.optimizedMeshes
+        << ", \"triangles\": " << results.import.triangleCount
+        << ", \"acmrBefore\": " << results.import.before.acmr
+        << ", \"acmrAfter\": " << results.import.after.acmr
+        << ", \"atvrBefore\": " << results.import.before.atvr
+        << ", \"atvrAfter\": " << results.import.after.atvr
+        << ", \"lodLevels\": " << results.import.lodLevels
+        << " },\n"
+        << "  \"deviceMemory\": {"
+        << " \"blocks\": " << results.memory.blockCount
+        << ", \"allocations\": " << results.memory.allocationCount
+        << ", \"blockBytes\": " << results.memory.blockBytes
+        << ", \"allocatedBytes\": " << results.memory.allocationBytes
+        << " },\n"
+        << "  \"modelsPerFrame\": {"
+        << " \"visible\": " << static_cast<double>(results.visibleModels) / results.frameAllocations.size()
+        << ", \"culled\": " << static_cast<double>(results.culledModels) / results.frameAllocations.size()
+        << " },\n"
+        << "  \"meshesPerFrame\": {"
+        << " \"visible\": " << static_cast<double>(results.visibleMeshes) / results.frameAllocations.size()
+        << ", \"culled\": " << static_cast<double>(results.culledMeshes) / results.frameAllocations.size()
+        << " },\n"
+        << "  \"bindsPerFrame\": {";
+
+    for (size_t i = 0; i < BIND_TYPE_COUNT; i++)
+    {
+        out << (i == 0 ? " \"" : ", \"") << BindTypeName(i) << "\": {"
+            << " \"issued\": " << static_cast<double>(results.bindsIssued[i]) / results.frameAllocations.size()
+            << ", \"skipped\": " << static_cast<double>(results.bindsSkipped[i]) / results.frameAllocations.size()
+            << " }";
+    }
+
+    out << " },\n"
+        << "  \"allocationsPerFrame\": {"
+        << " \"tracked\": " << (AllocationTracker::IsEnabled() ? "true" : "false")
+        << ", \"mean\": " << static_cast<double>(totalAllocations) / results.frameAllocations.size()
+        << ", \"max\": " << maxAllocations
+        << ", \"total\": " << totalAllocations
+        << " },\n"
+        << "  \"cpuFrameMs\": {\n";
+
+    for (size_t i = 0; i < results.stages.size(); i++)
+    {
+        WriteStage(out, results.stages[i]);
+        out << (i + 1 < results.stages.size() ? ",\n" : "\n");
+    }
+
+    out << "  }\n"
+        << "}\n";
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (options.assertZeroAllocations && !AllocationTracker::IsEnabled())
+    {
+        std::cerr << "--assert-no-alloc requires a build with TRACK_ALLOCATIONS=1" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    GLFWwindow *window = nullptr;
+    VulkanRenderer vulkanRenderer;
+
+    int initResult;
+    if (options.windowed)
+    {
+        glfwInit();
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        window = glfwCreateWindow(options.width, options.height, "Vulkan Bench", nullptr, nullptr);
+
+        initResult = vulkanRenderer.Init(window, options.settings);
+    }
+    else
+    {
+        initResult = vulkanRenderer.InitHeadless(static_cast<uint32_t>(options.width), static_cast<uint32_t>(options.height), options.settings);
+    }
+
+    if (initResult == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+
+    BenchResults results;
+
+    auto loadStart = std::chrono::steady_clock::now();
+    int model = vulkanRenderer.CreateMeshModel(options.modelFile);
+    results.modelLoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    results.import = vulkanRenderer.GetImportStatistics();
+
+    // Instances stand on a grid behind the model, rows of ten, and turn with it
+    std::vector<int> instances(std::max(options.instances, 0));
+    std::vector<glm::vec3> instanceOffsets(instances.size());
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        instances[i] = vulkanRenderer.CreateModelInstance(model);
+        instanceOffsets[i] = glm::vec3((static_cast<float>(i % 10) - 4.5f) * 6.0f, 0.0f, -6.0f * static_cast<float>(i / 10 + 1));
+    }
+
+    std::vector<StageSamples> &stages = results.stages;
+    stages = {
+        {"total", {}},
+        {"fenceWait", {}},
+        {"acquire", {}},
+        {"recordCommands", {}},
+        {"updateUniformBuffers", {}},
+        {"cullMeshes", {}},
+        {"selectLods", {}},
+        {"queueSubmit", {}},
+        {"present", {}},
+    };
+    for (auto &stage : stages)
+    {
+        stage.values.reserve(options.frames);
+    }
+
+    std::vector<uint64_t> &frameAllocations = results.frameAllocations;
+    frameAllocations.reserve(options.frames);
+
+    // Rotate by a fixed step per frame so every run draws the same sequence of frames
+    float angle = 0.0f;
+    int totalFrames = options.warmupFrames + options.frames;
+
+    for (int frame = 0; frame < totalFrames; frame++)
+    {
+        if (window)
+        {
+            glfwPollEvents();
+        }
+
+        uint64_t allocationsStart = AllocationTracker::GetAllocationCount();
+        auto frameStart = std::chrono::steady_clock::now();
+
+        angle = std::fmod(angle + 0.5f, 360.0f);
+
+        glm::mat4 testMat = glm::rotate(glm::mat4(1.f), glm::radians(angle), glm::vec3(0.f, 1.0f, 0.0f));
+        testMat = glm::rotate(testMat, glm::radians(-90.f), glm::vec3(1.f, 0.f, 0.f));
+        vulkanRenderer.UpdateModel(model, testMat);
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            vulkanRenderer.UpdateModelInstance(instances[i], glm::translate(glm::mat4(1.f), instanceOffsets[i]) * testMat);
+        }
+
+        vulkanRenderer.Draw();
+
+        double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        uint64_t allocations = AllocationTracker::GetAllocationCount() - allocationsStart;
+
+        if (frame < options.warmupFrames)
+        {
+            continue;
+        }
+
+        const FrameTimings &timings = vulkanRenderer.GetFrameTimings();
+        stages[0].values.push_back(frameMs);
+        stages[1].values.push_back(timings.fenceWait);
+        stages[2].values.push_back(timings.acquire);
+        stages[3].values.push_back(timings.recordCommands);
+        stages[4].values.push_back(timings.updateUniformBuffers);
+        stages[5].values.push_back(timings.cullMeshes);
+        stages[6].values.push_back(timings.selectLods);
+        stages[7].values.push_back(timings.queueSubmit);
+        stages[8].values.push_back(timings.present);
+        frameAllocations.push_back(allocations);
+
+        const CullStatistics &culling = vulkanRenderer.GetCullStatistics();
+        results.visibleModels += culling.visibleModels;
+        results.culledModels += culling.culledModels;
+        results.visibleMeshes += culling.visibleMeshes;
+        results.culledMeshes += culling.culledMeshes;
+
+        const BindStatistics &binds = vulkanRenderer.GetBindStatistics();
+        for (size_t i = 0; i < BIND_TYPE_COUNT; i++)
+        {
+            results.bindsIssued[i] += binds.issued[i];
+            results.bindsSkipped[i] += binds.skipped[i];
+        }
+    }
+
+    results.memory = vulkanRenderer.GetMemoryStatistics();
+
+    vulkanRenderer.CleanUP();
+
+    if (window)
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+
+    if (options.outputFile.empty())
+    {
+        WriteReport(std::cout, options, results);
+    }
+    else
+    {
+        std::ofstream file(options.outputFile);
+        if (!file.is_open())
+        {
+            std::cerr << "Failed to open " << options.outputFile << std::endl;
+            return EXIT_FAILURE;
+        }
+        WriteReport(file, options, results);
+    }
+
+    if (options.assertZeroAllocations)
+    {
+        for (size_t i = 0; i < frameAllocations.size(); i++)
+        {
+            if (frameAllocations[i] != 0)
+            {
+                std::cerr << "Frame " << i << " allocated " << frameAllocations[i] << " times after warm-up" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,948 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSION_SSE2 1
+#endif
+
+#include "BlockCompression.hpp"
+
+// Quantise 8 bit colour to 5:6:5 and back (replicating high bits, as the hardware does)
+static uint16_t PackColor565(const uint8_t *color)
+{
+    return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 |
+                                 ((color[1] * 63 + 127) / 255) << 5 |
+                                 ((color[2] * 31 + 127) / 255));
+}
+
+static void UnpackColor565(uint16_t packed, uint8_t *color)
+{
+    uint8_t r = (packed >> 11) & 31;
+    uint8_t g = (packed >> 5) & 63;
+    uint8_t b = packed & 31;
+
+    color[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+    color[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+    color[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+    color[3] = 255;
+}
+
+// The four colours a BC1 colour block can pick from (three plus black when color0 <= color1 outside of BC3)
+static void BuildColorPalette(uint16_t color0, uint16_t color1, bool fourColors, uint8_t palette[4][4])
+{
+    UnpackColor565(color0, palette[0]);
+    UnpackColor565(color1, palette[1]);
+
+    for (int c = 0; c < 3; c++)
+    {
+        if (fourColors)
+        {
+            palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+            palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+        }
+        else
+        {
+            palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c] + 1) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = 255;
+}
+
+static int ColorDistance(const uint8_t *a, const uint8_t *b)
+{
+    int dr = a[0] - b[0];
+    int dg = a[1] - b[1];
+    int db = a[2] - b[2];
+    return dr * dr + dg * dg + db * db;
+}
+
+// Endpoints are the two pixels furthest apart along the main axis of the block's colours (found by power iteration)
+static void EncodeColorBlock(const uint8_t *pixels, uint8_t *block)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            mean[c] += pixels[i * 4 + c] / 16.0f;
+        }
+    }
+
+    float covariance[6] = {}; // rr, rg, rb, gg, gb, bb
+    for (int i = 0; i < 16; i++)
+    {
+        float r = pixels[i * 4 + 0] - mean[0];
+        float g = pixels[i * 4 + 1] - mean[1];
+        float b = pixels[i * 4 + 2] - mean[2];
+
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 4; iteration++)
+    {
+        float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+
+        float length = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+        if (length < 1e-6f)
+        {
+            break;
+        }
+
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+
+    int minIndex = 0;
+    int maxIndex = 0;
+    float minProjection = 1e30f;
+    float maxProjection = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float projection = pixels[i * 4 + 0] * axis[0] + pixels[i * 4 + 1] * axis[1] + pixels[i * 4 + 2] * axis[2];
+        if (projection < minProjection)
+        {
+            minProjection = projection;
+            minIndex = i;
+        }
+        if (projection > maxProjection)
+        {
+            maxProjection = projection;
+            maxIndex = i;
+        }
+    }
+
+    uint16_t color0 = PackColor565(&pixels[maxIndex * 4]);
+    uint16_t color1 = PackColor565(&pixels[minIndex * 4]);
+
+    // color0 > color1 selects four colour mode
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        uint8_t palette[4][4];
+        BuildColorPalette(color0, color1, true, palette);
+
+        for (int i = 0; i < 16; i++)
+        {
+            uint32_t best = 0;
+            int bestDistance = ColorDistance(&pixels[i * 4], palette[0]);
+            for (uint32_t p = 1; p < 4; p++)
+            {
+                int distance = ColorDistance(&pixels[i * 4], palette[p]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= best << (i * 2);
+        }
+    }
+
+    block[0] = static_cast<uint8_t>(color0 & 0xFF);
+    block[1] = static_cast<uint8_t>(color0 >> 8);
+    block[2] = static_cast<uint8_t>(color1 & 0xFF);
+    block[3] = static_cast<uint8_t>(color1 >> 8);
+    std::memcpy(&block[4], &indices, sizeof(uint32_t));
+}
+
+static void DecodeColorBlock(const uint8_t *block, uint8_t *pixels, bool alwaysFourColors)
+{
+    uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+    uint32_t indices;
+    std::memcpy(&indices, &block[4], sizeof(uint32_t));
+
+    uint8_t palette[4][4];
+    BuildColorPalette(color0, color1, alwaysFourColors || color0 > color1, palette);
+
+    for (int i = 0; i < 16; i++)
+    {
+        std::memcpy(&pixels[i * 4], palette[(indices >> (i * 2)) & 3], 4);
+    }
+}
+
+// Alpha endpoints are the block's minimum and maximum, 8 interpolated values with 3 bit indices
+static void EncodeAlphaBlock(const uint8_t *pixels, uint8_t *block)
+{
+    uint8_t alpha0 = 0;
+    uint8_t alpha1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        alpha0 = std::max(alpha0, pixels[i * 4 + 3]);
+        alpha1 = std::min(alpha1, pixels[i * 4 + 3]);
+    }
+
+    uint64_t indices = 0;
+    if (alpha0 != alpha1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            // Position between endpoints in sevenths, mapped to palette order (0: alpha0, 1: alpha1, 2-7: in between)
+            int step = ((alpha0 - pixels[i * 4 + 3]) * 7 + (alpha0 - alpha1) / 2) / (alpha0 - alpha1);
+            uint64_t index = step == 0 ? 0 : (step == 7 ? 1 : static_cast<uint64_t>(step + 1));
+            indices |= index << (i * 3);
+        }
+    }
+
+    block[0] = alpha0;
+    block[1] = alpha1;
+    for (int i = 0; i < 6; i++)
+    {
+        block[2 + i] = static_cast<uint8_t>((indices >> (i * 8)) & 0xFF);
+    }
+}
+
+static void DecodeAlphaBlock(const uint8_t *block, uint8_t *pixels)
+{
+    uint8_t palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+
+    if (palette[0] > palette[1])
+    {
+        for (int i = 1; i < 7; i++)
+        {
+            palette[1 + i] = static_cast<uint8_t>(((7 - i) * palette[0] + i * palette[1] + 3) / 7);
+        }
+    }
+    else
+    {
+        for (int i = 1; i < 5; i++)
+        {
+            palette[1 + i] = static_cast<uint8_t>(((5 - i) * palette[0] + i * palette[1] + 2) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+        pixels[i * 4 + 3] = palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+// BC7 (RGBA, 16 bytes per block): eight modes that trade subsets (regions of the block with their own endpoints),
+// endpoint precision and index precision. Everything is read LSB first; the mode is the number of zero bits before
+// the first set bit.
+struct BC7Mode
+{
+    uint32_t subsets;
+    uint32_t partitionBits;
+    uint32_t rotationBits;       // Swap alpha with one of the colour channels
+    uint32_t indexSelectionBits; // Swap which index set is used for colour and for alpha
+    uint32_t colorBits;
+    uint32_t alphaBits;          // 0 if alpha is always 255
+    uint32_t endpointPBits;      // Low bit shared by all channels of one endpoint
+    uint32_t sharedPBits;        // Low bit shared by both endpoints of a subset
+    uint32_t indexBits;
+    uint32_t secondaryIndexBits; // Separate alpha indices (modes 4 and 5)
+};
+
+static const BC7Mode BC7_MODES[8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0}};
+
+// Subset of each pixel for the two subset partitions, one bit per pixel
+static const uint16_t BC7_PARTITIONS_2[64] = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+    0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+    0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+    0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+    0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+    0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22};
+
+// Subset of each pixel for the three subset partitions, two bits per pixel
+static const uint32_t BC7_PARTITIONS_3[64] = {
+    0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+    0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+    0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+    0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+    0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+    0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+    0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+    0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254};
+
+// Anchor pixel of every subset after the first (the first subset's anchor is pixel 0). An anchor's index has an
+// implicit zero high bit, so the encoder orders endpoints to make it less than half the palette.
+static const uint8_t BC7_ANCHORS_2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15};
+static const uint8_t BC7_ANCHORS_3_SECOND[64] = {
+     3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+     3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+     8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+     3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3};
+static const uint8_t BC7_ANCHORS_3_THIRD[64] = {
+    15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+    15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+    15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+    15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8};
+
+static const uint32_t BC7_WEIGHTS_2[4] = {0, 21, 43, 64};
+static const uint32_t BC7_WEIGHTS_3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const uint32_t BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static const uint32_t *GetBC7Weights(uint32_t indexBits)
+{
+    return indexBits == 2 ? BC7_WEIGHTS_2 : (indexBits == 3 ? BC7_WEIGHTS_3 : BC7_WEIGHTS_4);
+}
+
+static uint8_t InterpolateBC7(uint32_t endpoint0, uint32_t endpoint1, uint32_t weight)
+{
+    return static_cast<uint8_t>(((64 - weight) * endpoint0 + weight * endpoint1 + 32) >> 6);
+}
+
+static uint32_t GetBC7Subset(uint32_t subsets, uint32_t partition, uint32_t pixel)
+{
+    if (subsets == 2)
+    {
+        return (BC7_PARTITIONS_2[partition] >> pixel) & 1;
+    }
+    if (subsets == 3)
+    {
+        return (BC7_PARTITIONS_3[partition] >> (pixel * 2)) & 3;
+    }
+    return 0;
+}
+
+static bool IsBC7Anchor(uint32_t subsets, uint32_t partition, uint32_t pixel)
+{
+    if (pixel == 0)
+    {
+        return true;
+    }
+    if (subsets == 2)
+    {
+        return pixel == BC7_ANCHORS_2[partition];
+    }
+    if (subsets == 3)
+    {
+        return pixel == BC7_ANCHORS_3_SECOND[partition] || pixel == BC7_ANCHORS_3_THIRD[partition];
+    }
+    return false;
+}
+
+// Reads or writes consecutive bit fields of one 128 bit block
+class BC7Bits
+{
+public:
+    explicit BC7Bits(uint8_t *block) : m_block(block) {}
+
+    uint32_t Read(uint32_t count)
+    {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; i++, m_position++)
+        {
+            value |= ((m_block[m_position / 8] >> (m_position % 8)) & 1u) << i;
+        }
+        return value;
+    }
+
+    // Block must start zeroed
+    void Write(uint32_t value, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++, m_position++)
+        {
+            m_block[m_position / 8] |= static_cast<uint8_t>(((value >> i) & 1u) << (m_position % 8));
+        }
+    }
+
+private:
+    uint8_t *m_block;
+    uint32_t m_position = 0;
+};
+
+static void DecodeBC7(const uint8_t *block, uint8_t *pixels)
+{
+    uint8_t data[16];
+    std::memcpy(data, block, sizeof(data));
+    BC7Bits bits(data);
+
+    uint32_t mode = 0;
+    while (mode < 8 && bits.Read(1) == 0)
+    {
+        mode++;
+    }
+
+    // Reserved mode, decodes to transparent black
+    if (mode == 8)
+    {
+        std::memset(pixels, 0, 16 * 4);
+        return;
+    }
+
+    const BC7Mode &info = BC7_MODES[mode];
+    uint32_t partition = bits.Read(info.partitionBits);
+    uint32_t rotation = bits.Read(info.rotationBits);
+    uint32_t indexSelection = bits.Read(info.indexSelectionBits);
+
+    uint32_t endpoints[3][2][4] = {}; // Subset, endpoint, channel
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        for (uint32_t s = 0; s < info.subsets; s++)
+        {
+            endpoints[s][0][c] = bits.Read(info.colorBits);
+            endpoints[s][1][c] = bits.Read(info.colorBits);
+        }
+    }
+    for (uint32_t s = 0; s < info.subsets && info.alphaBits > 0; s++)
+    {
+        endpoints[s][0][3] = bits.Read(info.alphaBits);
+        endpoints[s][1][3] = bits.Read(info.alphaBits);
+    }
+
+    uint32_t pBits = info.endpointPBits | info.sharedPBits;
+    for (uint32_t s = 0; s < info.subsets && pBits > 0; s++)
+    {
+        uint32_t p[2];
+        p[0] = bits.Read(1);
+        p[1] = info.sharedPBits ? p[0] : bits.Read(1);
+
+        for (uint32_t e = 0; e < 2; e++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                endpoints[s][e][c] = endpoints[s][e][c] << 1 | p[e];
+            }
+        }
+    }
+
+    // Expand to 8 bits by replicating the high bits
+    uint32_t colorPrecision = info.colorBits + pBits;
+    uint32_t alphaPrecision = info.alphaBits > 0 ? info.alphaBits + pBits : 0;
+    for (uint32_t s = 0; s < info.subsets; s++)
+    {
+        for (uint32_t e = 0; e < 2; e++)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                uint32_t value = endpoints[s][e][c] << (8 - colorPrecision);
+                endpoints[s][e][c] = value | (value >> colorPrecision);
+            }
+
+            if (alphaPrecision > 0)
+            {
+                uint32_t value = endpoints[s][e][3] << (8 - alphaPrecision);
+                endpoints[s][e][3] = value | (value >> alphaPrecision);
+            }
+            else
+            {
+                endpoints[s][e][3] = 255;
+            }
+        }
+    }
+
+    uint32_t indices[16];
+    uint32_t secondaryIndices[16];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        indices[i] = bits.Read(info.indexBits - (IsBC7Anchor(info.subsets, partition, i) ? 1 : 0));
+    }
+    for (uint32_t i = 0; i < 16 && info.secondaryIndexBits > 0; i++)
+    {
+        secondaryIndices[i] = bits.Read(info.secondaryIndexBits - (i == 0 ? 1 : 0));
+    }
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        const uint32_t(*subset)[4] = endpoints[GetBC7Subset(info.subsets, partition, i)];
+
+        uint32_t colorWeight = GetBC7Weights(info.indexBits)[indices[i]];
+        uint32_t alphaWeight = colorWeight;
+        if (info.secondaryIndexBits > 0)
+        {
+            alphaWeight = GetBC7Weights(info.secondaryIndexBits)[secondaryIndices[i]];
+            if (indexSelection)
+            {
+                std::swap(colorWeight, alphaWeight);
+            }
+        }
+
+        uint8_t *pixel = &pixels[i * 4];
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            pixel[c] = InterpolateBC7(subset[0][c], subset[1][c], colorWeight);
+        }
+        pixel[3] = InterpolateBC7(subset[0][3], subset[1][3], alphaWeight);
+
+        if (rotation > 0)
+        {
+            std::swap(pixel[3], pixel[rotation - 1]);
+        }
+    }
+}
+
+// Nearest palette entry of every pixel for mode 6 endpoints (8 bit values including the p-bit), returns the total
+// squared error
+static uint32_t FindBC7Indices(const uint8_t *pixels, const uint32_t endpoints[2][4], uint32_t *indices)
+{
+    uint8_t palette[16][4];
+    for (uint32_t p = 0; p < 16; p++)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            palette[p][c] = InterpolateBC7(endpoints[0][c], endpoints[1][c], BC7_WEIGHTS_4[p]);
+        }
+    }
+
+    uint32_t totalError = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t bestError = UINT32_MAX;
+        for (uint32_t p = 0; p < 16; p++)
+        {
+            uint32_t error = 0;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                int difference = pixels[i * 4 + c] - palette[p][c];
+                error += static_cast<uint32_t>(difference * difference);
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = p;
+            }
+        }
+        totalError += bestError;
+    }
+
+    return totalError;
+}
+
+// Rounds an endpoint to 7 bits per channel plus the p-bit that fits it best
+static void QuantizeBC7Endpoint(const float *endpoint, uint32_t *quantized, uint32_t *pBit)
+{
+    float bestError = 1e30f;
+    for (uint32_t p = 0; p < 2; p++)
+    {
+        uint32_t candidate[4];
+        float error = 0.0f;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            float value = std::round((endpoint[c] - p) / 2.0f);
+            candidate[c] = static_cast<uint32_t>(std::min(std::max(value, 0.0f), 127.0f)) << 1 | p;
+            error += (endpoint[c] - candidate[c]) * (endpoint[c] - candidate[c]);
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            *pBit = p;
+            std::memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+// Mode 6 only: one subset with 7:7:7:7 endpoints, per-endpoint p-bits and 4 bit indices. Endpoints start at the
+// extent of the block along the main axis of its RGBA values (power iteration, as for BC1), then are refitted once
+// to the chosen indices by least squares.
+static void EncodeBC7(const uint8_t *pixels, uint8_t *block)
+{
+    float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            mean[c] += pixels[i * 4 + c] / 16.0f;
+        }
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int a = 0; a < 4; a++)
+        {
+            for (int b = 0; b < 4; b++)
+            {
+                covariance[a][b] += (pixels[i * 4 + a] - mean[a]) * (pixels[i * 4 + b] - mean[b]);
+            }
+        }
+    }
+
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 4; iteration++)
+    {
+        float next[4] = {};
+        for (int a = 0; a < 4; a++)
+        {
+            for (int b = 0; b < 4; b++)
+            {
+                next[a] += covariance[a][b] * axis[b];
+            }
+        }
+
+        float length = std::max(std::max(std::abs(next[0]), std::abs(next[1])), std::max(std::abs(next[2]), std::abs(next[3])));
+        if (length < 1e-6f)
+        {
+            break;
+        }
+
+        for (int c = 0; c < 4; c++)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float minProjection = 1e30f;
+    float maxProjection = -1e30f;
+    float axisLength = 0.0f;
+    for (int c = 0; c < 4; c++)
+    {
+        axisLength += axis[c] * axis[c];
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        float projection = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+            projection += (pixels[i * 4 + c] - mean[c]) * axis[c];
+        }
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    float endpoints[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+        float scale = axisLength > 1e-6f ? axis[c] / axisLength : 0.0f;
+        endpoints[0][c] = std::min(std::max(mean[c] + minProjection * scale, 0.0f), 255.0f);
+        endpoints[1][c] = std::min(std::max(mean[c] + maxProjection * scale, 0.0f), 255.0f);
+    }
+
+    uint32_t bestEndpoints[2][4];
+    uint32_t bestPBits[2];
+    uint32_t bestIndices[16];
+    uint32_t bestError = UINT32_MAX;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        uint32_t quantized[2][4];
+        uint32_t pBits[2];
+        QuantizeBC7Endpoint(endpoints[0], quantized[0], &pBits[0]);
+        QuantizeBC7Endpoint(endpoints[1], quantized[1], &pBits[1]);
+
+        uint32_t indices[16];
+        uint32_t error = FindBC7Indices(pixels, quantized, indices);
+        if (error < bestError)
+        {
+            bestError = error;
+            std::memcpy(bestEndpoints, quantized, sizeof(quantized));
+            std::memcpy(bestPBits, pBits, sizeof(pBits));
+            std::memcpy(bestIndices, indices, sizeof(indices));
+        }
+
+        if (pass == 1 || error == 0)
+        {
+            break;
+        }
+
+        // Endpoints that minimise the error for these indices: solve the 2x2 normal equations of
+        // pixel = (1 - t) * endpoint0 + t * endpoint1
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            float t = BC7_WEIGHTS_4[indices[i]] / 64.0f;
+            aa += (1.0f - t) * (1.0f - t);
+            ab += (1.0f - t) * t;
+            bb += t * t;
+            for (int c = 0; c < 4; c++)
+            {
+                ax[c] += (1.0f - t) * pixels[i * 4 + c];
+                bx[c] += t * pixels[i * 4 + c];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f)
+        {
+            break;
+        }
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / determinant, 0.0f), 255.0f);
+            endpoints[1][c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / determinant, 0.0f), 255.0f);
+        }
+    }
+
+    // Pixel 0 is stored without its index's high bit, swap the endpoints if it is set
+    if (bestIndices[0] >= 8)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+        }
+        std::swap(bestPBits[0], bestPBits[1]);
+        for (int i = 0; i < 16; i++)
+        {
+            bestIndices[i] = 15 - bestIndices[i];
+        }
+    }
+
+    std::memset(block, 0, 16);
+    BC7Bits bits(block);
+    bits.Write(1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        bits.Write(bestEndpoints[0][c] >> 1, 7);
+        bits.Write(bestEndpoints[1][c] >> 1, 7);
+    }
+    bits.Write(bestPBits[0], 1);
+    bits.Write(bestPBits[1], 1);
+    for (int i = 0; i < 16; i++)
+    {
+        bits.Write(bestIndices[i], i == 0 ? 3 : 4);
+    }
+}
+
+static VkDeviceSize GetBlockSize(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+        return 16;
+    default:
+        throw std::runtime_error("Unsupported block compressed format");
+    }
+}
+
+void BlockCompression::EncodeBC1Block(const uint8_t *pixels, uint8_t *block)
+{
+    EncodeColorBlock(pixels, block);
+}
+
+void BlockCompression::EncodeBC3Block(const uint8_t *pixels, uint8_t *block)
+{
+    EncodeAlphaBlock(pixels, block);
+    EncodeColorBlock(pixels, block + 8);
+}
+
+void BlockCompression::EncodeBC7Block(const uint8_t *pixels, uint8_t *block)
+{
+    EncodeBC7(pixels, block);
+}
+
+void BlockCompression::DecodeBC1Block(const uint8_t *block, uint8_t *pixels)
+{
+    DecodeColorBlock(block, pixels, false);
+}
+
+void BlockCompression::DecodeBC3Block(const uint8_t *block, uint8_t *pixels)
+{
+    DecodeColorBlock(block + 8, pixels, true);
+    DecodeAlphaBlock(block, pixels);
+}
+
+void BlockCompression::DecodeBC7Block(const uint8_t *block, uint8_t *pixels)
+{
+    DecodeBC7(block, pixels);
+}
+
+std::vector<uint8_t> BlockCompression::Compress(const uint8_t *pixels, uint32_t width, uint32_t height, VkFormat format)
+{
+    VkDeviceSize blockSize = GetBlockSize(format);
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+
+    std::vector<uint8_t> blocks(static_cast<size_t>(blocksX * blocksY * blockSize));
+    uint8_t *block = blocks.data();
+
+    for (uint32_t by = 0; by < blocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            // Gather block, repeating the last row/column for blocks hanging over the edge
+            uint8_t blockPixels[16 * 4];
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                uint32_t sourceY = std::min(by * 4 + y, height - 1);
+                for (uint32_t x = 0; x < 4; x++)
+                {
+                    uint32_t sourceX = std::min(bx * 4 + x, width - 1);
+                    std::memcpy(&blockPixels[(y * 4 + x) * 4], &pixels[(static_cast<size_t>(sourceY) * width + sourceX) * 4], 4);
+                }
+            }
+
+            if (format == VK_FORMAT_BC1_RGB_UNORM_BLOCK)
+            {
+                EncodeBC1Block(blockPixels, block);
+            }
+            else if (format == VK_FORMAT_BC7_UNORM_BLOCK)
+            {
+                EncodeBC7Block(blockPixels, block);
+            }
+            else
+            {
+                EncodeBC3Block(blockPixels, block);
+            }
+            block += blockSize;
+        }
+    }
+
+    return blocks;
+}
+
+std::vector<uint8_t> BlockCompression::Decompress(const uint8_t *blocks, uint32_t width, uint32_t height, VkFormat format)
+{
+    VkDeviceSize blockSize = GetBlockSize(format);
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    const uint8_t *block = blocks;
+
+    for (uint32_t by = 0; by < blocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            uint8_t blockPixels[16 * 4];
+            if (format == VK_FORMAT_BC1_RGB_UNORM_BLOCK)
+            {
+                DecodeBC1Block(block, blockPixels);
+            }
+            else if (format == VK_FORMAT_BC7_UNORM_BLOCK)
+            {
+                DecodeBC7Block(block, blockPixels);
+            }
+            else
+            {
+                DecodeBC3Block(block, blockPixels);
+            }
+            block += blockSize;
+
+            // Scatter block, dropping pixels past the edge
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+            {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+                {
+                    std::memcpy(&pixels[(static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4], &blockPixels[(y * 4 + x) * 4], 4);
+                }
+            }
+        }
+    }
+
+    return pixels;
+}
+
+std::vector<uint8_t> BlockCompression::Downsample(const uint8_t *pixels, uint32_t width, uint32_t height)
+{
+    uint32_t newWidth = std::max(width / 2, 1u);
+    uint32_t newHeight = std::max(height / 2, 1u);
+
+    std::vector<uint8_t> result(static_cast<size_t>(newWidth) * newHeight * 4);
+
+    for (uint32_t y = 0; y < newHeight; y++)
+    {
+        // Odd sizes (or a side of 1) reuse the last row/column
+        uint32_t y0 = std::min(y * 2, height - 1);
+        uint32_t y1 = std::min(y * 2 + 1, height - 1);
+
+        uint32_t x = 0;
+
+#ifdef BLOCK_COMPRESSION_SSE2
+        // Two result pixels at a time: widen 4 pixels of both rows to 16 bits, add rows, then add neighbouring pixels
+        // (only while no column has to be clamped)
+        if (width > 1)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i rounding = _mm_set1_epi16(2);
+            const uint8_t *row0 = &pixels[static_cast<size_t>(y0) * width * 4];
+            const uint8_t *row1 = &pixels[static_cast<size_t>(y1) * width * 4];
+
+            for (; x + 2 <= newWidth; x += 2)
+            {
+                __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + x * 8));
+                __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + x * 8));
+
+                __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));   // Pixels 0, 1
+                __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero)); // Pixels 2, 3
+
+                __m128i sum = _mm_unpacklo_epi64(_mm_add_epi16(low, _mm_srli_si128(low, 8)), _mm_add_epi16(high, _mm_srli_si128(high, 8)));
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(&result[(static_cast<size_t>(y) * newWidth + x) * 4]), _mm_packus_epi16(sum, zero));
+            }
+        }
+#endif
+
+        for (; x < newWidth; x++)
+        {
+            uint32_t x0 = std::min(x * 2, width - 1);
+            uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                uint32_t sum = pixels[(static_cast<size_t>(y0) * width + x0) * 4 + c] +
+                               pixels[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                               pixels[(static_cast<size_t>(y1) * width + x0) * 4 + c] +
+                               pixels[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                result[(static_cast<size_t>(y) * newWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+
+    return result;
+}
+
+uint32_t BlockCompression::GetMipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+    {
+        levels++;
+    }
+
+    return levels;
+}
+
+bool BlockCompression::IsCompressed(VkFormat format)
+{
+    return format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC7_UNORM_BLOCK;
+}
+
+VkDeviceSize BlockCompression::GetLevelSize(uint32_t width, uint32_t height, VkFormat format)
+{
+    if (!IsCompressed(format))
+    {
+        return static_cast<VkDeviceSize>(width) * height * 4;
+    }
+
+    return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+}
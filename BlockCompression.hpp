@@ -0,0 +1,36 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <cstdint>
+
+// CPU encoder and decoder for BC1 (opaque colour, 8 bytes per 4x4 block), BC3 (colour plus alpha, 16 bytes per block)
+// and BC7 (colour plus alpha at higher quality, 16 bytes per block; every mode decodes, the encoder only writes mode 6).
+// RGBA8 images are passed as tightly packed rows, 4 bytes per pixel.
+class BlockCompression
+{
+public:
+    // Single 4x4 block, pixels row by row
+    static void EncodeBC1Block(const uint8_t *pixels, uint8_t *block);
+    static void EncodeBC3Block(const uint8_t *pixels, uint8_t *block);
+    static void EncodeBC7Block(const uint8_t *pixels, uint8_t *block);
+    static void DecodeBC1Block(const uint8_t *block, uint8_t *pixels);
+    static void DecodeBC3Block(const uint8_t *block, uint8_t *pixels);
+    static void DecodeBC7Block(const uint8_t *block, uint8_t *pixels);
+
+    // Whole image (width and height don't have to be multiples of 4), format is BC1_RGB_UNORM, BC3_UNORM or BC7_UNORM
+    static std::vector<uint8_t> Compress(const uint8_t *pixels, uint32_t width, uint32_t height, VkFormat format);
+    static std::vector<uint8_t> Decompress(const uint8_t *blocks, uint32_t width, uint32_t height, VkFormat format);
+
+    // Next smaller mip level of an RGBA8 image (2x2 box filter)
+    static std::vector<uint8_t> Downsample(const uint8_t *pixels, uint32_t width, uint32_t height);
+
+    // Levels of a full mip chain down to 1x1
+    static uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+    static bool IsCompressed(VkFormat format);
+    // Bytes of one level of an image in this format (BC formats, or RGBA8)
+    static VkDeviceSize GetLevelSize(uint32_t width, uint32_t height, VkFormat format);
+};
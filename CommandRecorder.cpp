@@ -0,0 +1,103 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "CommandRecorder.hpp"
+
+CommandRecorder::CommandRecorder()
+{
+}
+
+void CommandRecorder::Begin(VkCommandBuffer newCommandBuffer, VkPipelineLayout newLayout)
+{
+    m_commandBuffer = newCommandBuffer;
+    m_layout = newLayout;
+
+    m_pipeline = VK_NULL_HANDLE;
+    m_vertexBuffer = VK_NULL_HANDLE;
+    m_vertexBufferOffset = 0;
+    m_indexBuffer = VK_NULL_HANDLE;
+    m_indexBufferOffset = 0;
+    m_indexType = VK_INDEX_TYPE_UINT32;
+    m_sets = {};
+
+    m_statistics = {};
+}
+
+void CommandRecorder::BindPipeline(VkPipeline pipeline)
+{
+    if (!CountBind(BindType::Pipeline, pipeline == m_pipeline))
+    {
+        return;
+    }
+
+    vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    m_pipeline = pipeline;
+}
+
+void CommandRecorder::BindVertexBuffer(VkBuffer buffer, VkDeviceSize offset)
+{
+    if (!CountBind(BindType::VertexBuffer, buffer == m_vertexBuffer && offset == m_vertexBufferOffset))
+    {
+        return;
+    }
+
+    vkCmdBindVertexBuffers(m_commandBuffer, 0, 1, &buffer, &offset);
+    m_vertexBuffer = buffer;
+    m_vertexBufferOffset = offset;
+}
+
+void CommandRecorder::BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+    if (!CountBind(BindType::IndexBuffer, buffer == m_indexBuffer && offset == m_indexBufferOffset && indexType == m_indexType))
+    {
+        return;
+    }
+
+    vkCmdBindIndexBuffer(m_commandBuffer, buffer, offset, indexType);
+    m_indexBuffer = buffer;
+    m_indexBufferOffset = offset;
+    m_indexType = indexType;
+}
+
+void CommandRecorder::BindDescriptorSet(uint32_t setIndex, VkDescriptorSet set, uint32_t dynamicOffsetCount, const uint32_t *dynamicOffsets)
+{
+    if (setIndex >= MAX_DESCRIPTOR_SETS || dynamicOffsetCount > MAX_DYNAMIC_OFFSETS)
+    {
+        throw std::runtime_error("Descriptor set bind exceeds what the command recorder tracks");
+    }
+
+    BoundSet &bound = m_sets[setIndex];
+    bool same = set == bound.set && dynamicOffsetCount == bound.dynamicOffsetCount &&
+                std::equal(dynamicOffsets, dynamicOffsets + dynamicOffsetCount, bound.dynamicOffsets.begin());
+    if (!CountBind(BindType::DescriptorSet, same))
+    {
+        return;
+    }
+
+    vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_layout, setIndex, 1, &set,
+                            dynamicOffsetCount, dynamicOffsets);
+    bound.set = set;
+    bound.dynamicOffsetCount = dynamicOffsetCount;
+    std::copy(dynamicOffsets, dynamicOffsets + dynamicOffsetCount, bound.dynamicOffsets.begin());
+}
+
+const BindStatistics &CommandRecorder::GetStatistics() const
+{
+    return m_statistics;
+}
+
+CommandRecorder::~CommandRecorder()
+{
+}
+
+bool CommandRecorder::CountBind(BindType type, bool bound)
+{
+    if (bound)
+    {
+        m_statistics.skipped[static_cast<size_t>(type)]++;
+        return false;
+    }
+
+    m_statistics.issued[static_cast<size_t>(type)]++;
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <cstdint>
+
+// State a CommandRecorder binds
+enum class BindType : uint32_t
+{
+    Pipeline,
+    VertexBuffer,
+    IndexBuffer,
+    DescriptorSet,
+};
+
+constexpr size_t BIND_TYPE_COUNT = 4;
+
+// Binds of one recorded command buffer, indexed by BindType
+struct BindStatistics
+{
+    std::array<uint32_t, BIND_TYPE_COUNT> issued{};  // Recorded into the command buffer
+    std::array<uint32_t, BIND_TYPE_COUNT> skipped{}; // Same state was already bound, not recorded
+};
+
+// Thin wrapper binding graphics state into a command buffer, skipping binds of the state that is already bound.
+// It only knows what was bound through it since Begin, binds recorded into the command buffer directly aren't tracked.
+// Every descriptor set is bound with one pipeline layout, so binding a set never disturbs the others
+class CommandRecorder
+{
+public:
+    CommandRecorder();
+
+    // Forgets what was bound and the statistics, descriptor sets are bound with the given layout
+    void Begin(VkCommandBuffer newCommandBuffer, VkPipelineLayout newLayout);
+
+    void BindPipeline(VkPipeline pipeline);
+    void BindVertexBuffer(VkBuffer buffer, VkDeviceSize offset);
+    void BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+    // A set bound again with other dynamic offsets is bound again
+    void BindDescriptorSet(uint32_t setIndex, VkDescriptorSet set, uint32_t dynamicOffsetCount = 0, const uint32_t *dynamicOffsets = nullptr);
+
+    const BindStatistics &GetStatistics() const;
+
+    ~CommandRecorder();
+
+private:
+    static constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+    static constexpr uint32_t MAX_DYNAMIC_OFFSETS = 4;
+
+    struct BoundSet
+    {
+        VkDescriptorSet set;
+        uint32_t dynamicOffsetCount;
+        std::array<uint32_t, MAX_DYNAMIC_OFFSETS> dynamicOffsets;
+    };
+
+    VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+    VkPipelineLayout m_layout = VK_NULL_HANDLE;
+
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize m_vertexBufferOffset = 0;
+    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize m_indexBufferOffset = 0;
+    VkIndexType m_indexType = VK_INDEX_TYPE_UINT32;
+    std::array<BoundSet, MAX_DESCRIPTOR_SETS> m_sets{};
+
+    BindStatistics m_statistics{};
+
+    // True (and counted as issued) if the bind has to be recorded, otherwise counted as skipped
+    bool CountBind(BindType type, bool bound);
+};
@@ -0,0 +1,208 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "DescriptorAllocator.hpp"
+
+DescriptorAllocator::DescriptorAllocator()
+{
+}
+
+void DescriptorAllocator::Init(VkDevice newDevice, VkDescriptorSetLayout newLayout, const std::vector<VkDescriptorPoolSize> &setSizes,
+                               const std::vector<VkDescriptorUpdateTemplateEntry> &entries, uint32_t firstPoolSets,
+                               const DescriptorTemplateFunctions &newTemplateFunctions)
+{
+    m_device = newDevice;
+    m_layout = newLayout;
+    m_setSizes = setSizes;
+    m_entries = entries;
+    m_nextPoolSets = std::max(firstPoolSets, 1u);
+    m_templateFunctions = newTemplateFunctions;
+
+    if (m_templateFunctions.create == nullptr)
+    {
+        return;
+    }
+
+    // Template replaying the entries for any set of the layout
+    VkDescriptorUpdateTemplateCreateInfo templateCreateInfo = {};
+    templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+    templateCreateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(m_entries.size());
+    templateCreateInfo.pDescriptorUpdateEntries = m_entries.data();
+    templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+    templateCreateInfo.descriptorSetLayout = m_layout;
+
+    VkResult result = m_templateFunctions.create(m_device, &templateCreateInfo, nullptr, &m_updateTemplate);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Descriptor Update Template");
+    }
+}
+
+DescriptorAllocation DescriptorAllocator::Allocate()
+{
+    DescriptorAllocation allocation;
+
+    // First pool with room
+    for (uint32_t i = 0; i < m_pools.size(); i++)
+    {
+        if (m_pools[i].allocated < m_pools[i].capacity && AllocateFromPool(i, &allocation))
+        {
+            return allocation;
+        }
+    }
+
+    // Every pool is full, chain a new one
+    AddPool();
+    if (!AllocateFromPool(static_cast<uint32_t>(m_pools.size() - 1), &allocation))
+    {
+        throw std::runtime_error("Failed to allocate a Descriptor Set from a new Descriptor Pool");
+    }
+
+    return allocation;
+}
+
+void DescriptorAllocator::Free(DescriptorAllocation &allocation)
+{
+    if (allocation.set == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    if (allocation.pool >= m_pools.size())
+    {
+        throw std::runtime_error("Attempted to free descriptor set not owned by allocator");
+    }
+
+    vkFreeDescriptorSets(m_device, m_pools[allocation.pool].pool, 1, &allocation.set);
+    m_pools[allocation.pool].allocated--;
+
+    allocation = {};
+}
+
+void DescriptorAllocator::Write(VkDescriptorSet set, const void *data)
+{
+    if (m_updateTemplate != VK_NULL_HANDLE)
+    {
+        m_templateFunctions.update(m_device, set, m_updateTemplate, data);
+        return;
+    }
+
+    // Same descriptors as the template, one write per descriptor (entries may have any stride)
+    const char *bytes = static_cast<const char *>(data);
+    std::vector<VkWriteDescriptorSet> setWrites;
+    for (const VkDescriptorUpdateTemplateEntry &entry : m_entries)
+    {
+        for (uint32_t i = 0; i < entry.descriptorCount; i++)
+        {
+            const char *info = bytes + entry.offset + entry.stride * i;
+
+            VkWriteDescriptorSet setWrite = {};
+            setWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            setWrite.dstSet = set;
+            setWrite.dstBinding = entry.dstBinding;
+            setWrite.dstArrayElement = entry.dstArrayElement + i;
+            setWrite.descriptorType = entry.descriptorType;
+            setWrite.descriptorCount = 1;
+
+            switch (entry.descriptorType)
+            {
+            case VK_DESCRIPTOR_TYPE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+                setWrite.pImageInfo = reinterpret_cast<const VkDescriptorImageInfo *>(info);
+                break;
+            case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+            case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+                setWrite.pTexelBufferView = reinterpret_cast<const VkBufferView *>(info);
+                break;
+            default:
+                setWrite.pBufferInfo = reinterpret_cast<const VkDescriptorBufferInfo *>(info);
+                break;
+            }
+
+            setWrites.push_back(setWrite);
+        }
+    }
+
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+}
+
+size_t DescriptorAllocator::GetPoolCount() const
+{
+    return m_pools.size();
+}
+
+void DescriptorAllocator::Destroy()
+{
+    // Sets still allocated are freed with their pools
+    for (Pool &pool : m_pools)
+    {
+        vkDestroyDescriptorPool(m_device, pool.pool, nullptr);
+    }
+    m_pools.clear();
+
+    if (m_updateTemplate != VK_NULL_HANDLE)
+    {
+        m_templateFunctions.destroy(m_device, m_updateTemplate, nullptr);
+        m_updateTemplate = VK_NULL_HANDLE;
+    }
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
+
+void DescriptorAllocator::AddPool()
+{
+    // Room for m_nextPoolSets sets of the layout
+    std::vector<VkDescriptorPoolSize> poolSizes = m_setSizes;
+    for (VkDescriptorPoolSize &poolSize : poolSizes)
+    {
+        poolSize.descriptorCount *= m_nextPoolSets;
+    }
+
+    VkDescriptorPoolCreateInfo poolCreateInfo = {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // Sets are given back one by one
+    poolCreateInfo.maxSets = m_nextPoolSets;
+    poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCreateInfo.pPoolSizes = poolSizes.data();
+
+    Pool pool = {};
+    pool.capacity = m_nextPoolSets;
+
+    VkResult result = vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &pool.pool);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create Descriptor Pool");
+    }
+
+    m_pools.push_back(pool);
+    m_nextPoolSets *= 2;
+}
+
+bool DescriptorAllocator::AllocateFromPool(uint32_t poolIndex, DescriptorAllocation *allocation)
+{
+    VkDescriptorSetAllocateInfo setAllocInfo = {};
+    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocInfo.descriptorPool = m_pools[poolIndex].pool;
+    setAllocInfo.descriptorSetCount = 1;
+    setAllocInfo.pSetLayouts = &m_layout;
+
+    VkResult result = vkAllocateDescriptorSets(m_device, &setAllocInfo, &allocation->set);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY_KHR || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        // Sets are all the same size, but a pool may still fragment
+        return false;
+    }
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate a Descriptor Set");
+    }
+
+    m_pools[poolIndex].allocated++;
+    allocation->pool = poolIndex;
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <cstdint>
+
+// Descriptor set handed out by DescriptorAllocator
+struct DescriptorAllocation
+{
+    VkDescriptorSet set = VK_NULL_HANDLE; // Set to bind and write
+    uint32_t pool = 0;                    // Pool of the allocator the set is freed to
+};
+
+// VK_KHR_descriptor_update_template (core since Vulkan 1.1), all null if the device doesn't have it
+struct DescriptorTemplateFunctions
+{
+    PFN_vkCreateDescriptorUpdateTemplateKHR create = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR destroy = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR update = nullptr;
+};
+
+// Sets of one layout out of a chain of descriptor pools. Once every pool is full a new one, twice the size of the last,
+// is added, so the number of sets is only limited by memory. Freed sets go back to their pool and are allocated again.
+// Sets are written from one struct holding all their descriptors, with a descriptor update template (a single call
+// the driver can replay without parsing writes) or with the same descriptors as vkUpdateDescriptorSets writes.
+class DescriptorAllocator
+{
+public:
+    DescriptorAllocator();
+
+    // setSizes: descriptors of one set by type. entries: where Write finds each descriptor of the set in its data
+    void Init(VkDevice newDevice, VkDescriptorSetLayout newLayout, const std::vector<VkDescriptorPoolSize> &setSizes,
+              const std::vector<VkDescriptorUpdateTemplateEntry> &entries, uint32_t firstPoolSets,
+              const DescriptorTemplateFunctions &newTemplateFunctions);
+
+    DescriptorAllocation Allocate();
+    void Free(DescriptorAllocation &allocation);
+    // Every descriptor of the set, data is laid out as the entries given to Init describe
+    void Write(VkDescriptorSet set, const void *data);
+
+    size_t GetPoolCount() const;
+
+    void Destroy();
+
+    ~DescriptorAllocator();
+
+private:
+    struct Pool
+    {
+        VkDescriptorPool pool;
+        uint32_t capacity;  // Sets the pool was created for
+        uint32_t allocated; // Sets currently allocated from it
+    };
+
+    VkDevice m_device = nullptr;
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPoolSize> m_setSizes{};
+    std::vector<VkDescriptorUpdateTemplateEntry> m_entries{};
+
+    std::vector<Pool> m_pools{};
+    uint32_t m_nextPoolSets = 0; // Capacity of the next pool added
+
+    DescriptorTemplateFunctions m_templateFunctions{};
+    VkDescriptorUpdateTemplateKHR m_updateTemplate = VK_NULL_HANDLE; // Null without the extension, Write falls back to plain writes
+
+    void AddPool();
+    // False if the pool is out of room
+    bool AllocateFromPool(uint32_t poolIndex, DescriptorAllocation *allocation);
+};
@@ -0,0 +1,303 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "DeviceMemoryAllocator.hpp"
+
+// Round value up to a multiple of alignment (alignment must be a power of two)
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Check if two byte offsets fall into the same bufferImageGranularity "page"
+static bool OnSamePage(VkDeviceSize offsetA, VkDeviceSize offsetB, VkDeviceSize pageSize)
+{
+    return (offsetA & ~(pageSize - 1)) == (offsetB & ~(pageSize - 1));
+}
+
+DeviceMemoryAllocator::DeviceMemoryAllocator()
+{
+}
+
+void DeviceMemoryAllocator::Init(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkDeviceSize newBlockSize)
+{
+    m_physicalDevice = newPhysicalDevice;
+    m_device = newDevice;
+    m_blockSize = newBlockSize;
+
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+    // Linear and optimal resources closer than this must not share a "page" of memory
+    VkPhysicalDeviceProperties deviceProperties = {};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+    m_bufferImageGranularity = std::max<VkDeviceSize>(deviceProperties.limits.bufferImageGranularity, 1);
+}
+
+MemoryAllocation DeviceMemoryAllocator::Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear)
+{
+    uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+    SuballocationType type = linear ? SUBALLOCATION_LINEAR : SUBALLOCATION_OPTIMAL;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    MemoryAllocation allocation = {};
+
+    // Try to fit allocation into an existing block of this memory type
+    for (MemoryBlock &block : m_blocks[memoryTypeIndex])
+    {
+        if (TryAllocate(block, requirements.size, alignment, type, &allocation))
+        {
+            return allocation;
+        }
+    }
+
+    // No room left, start a new block (at least large enough for this allocation)
+    m_blocks[memoryTypeIndex].push_back(CreateBlock(memoryTypeIndex, requirements.size));
+    if (!TryAllocate(m_blocks[memoryTypeIndex].back(), requirements.size, alignment, type, &allocation))
+    {
+        throw std::runtime_error("Failed to sub-allocate device memory from new block");
+    }
+
+    return allocation;
+}
+
+void DeviceMemoryAllocator::Free(MemoryAllocation &allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::vector<MemoryBlock> &blocks = m_blocks[allocation.memoryTypeIndex];
+
+    // Find block the allocation came from
+    auto blockIt = std::find_if(blocks.begin(), blocks.end(), [&](const MemoryBlock &block)
+                                { return block.memory == allocation.memory; });
+    if (blockIt == blocks.end())
+    {
+        throw std::runtime_error("Attempted to free memory not owned by allocator");
+    }
+
+    // Find suballocation within block (sorted by offset)
+    std::vector<Suballocation> &ranges = blockIt->suballocations;
+    auto rangeIt = std::lower_bound(ranges.begin(), ranges.end(), allocation.offset, [](const Suballocation &range, VkDeviceSize offset)
+                                    { return range.offset < offset; });
+    if (rangeIt == ranges.end() || rangeIt->offset != allocation.offset || rangeIt->type == SUBALLOCATION_FREE)
+    {
+        throw std::runtime_error("Attempted to free invalid memory allocation");
+    }
+
+    rangeIt->type = SUBALLOCATION_FREE;
+    blockIt->usedBytes -= allocation.size;
+    blockIt->allocationCount--;
+
+    // Merge with free neighbours so free ranges never sit next to each other
+    size_t index = rangeIt - ranges.begin();
+    if (index + 1 < ranges.size() && ranges[index + 1].type == SUBALLOCATION_FREE)
+    {
+        ranges[index].size += ranges[index + 1].size;
+        ranges.erase(ranges.begin() + index + 1);
+    }
+    if (index > 0 && ranges[index - 1].type == SUBALLOCATION_FREE)
+    {
+        ranges[index - 1].size += ranges[index].size;
+        ranges.erase(ranges.begin() + index);
+    }
+
+    // Keep a single empty block per memory type around for reuse, release any other
+    if (blockIt->allocationCount == 0)
+    {
+        size_t emptyBlocks = std::count_if(blocks.begin(), blocks.end(), [](const MemoryBlock &block)
+                                           { return block.allocationCount == 0; });
+        if (emptyBlocks > 1)
+        {
+            if (blockIt->mapped != nullptr)
+            {
+                vkUnmapMemory(m_device, blockIt->memory);
+            }
+            vkFreeMemory(m_device, blockIt->memory, nullptr);
+            blocks.erase(blockIt);
+        }
+    }
+
+    allocation = {};
+}
+
+VkDevice DeviceMemoryAllocator::GetDevice()
+{
+    return m_device;
+}
+
+MemoryStatistics DeviceMemoryAllocator::GetStatistics() const
+{
+    MemoryStatistics statistics = {};
+
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+    {
+        for (const MemoryBlock &block : m_blocks[i])
+        {
+            statistics.blockCount++;
+            statistics.allocationCount += block.allocationCount;
+            statistics.blockBytes += block.size;
+            statistics.allocationBytes += block.usedBytes;
+
+            for (const Suballocation &range : block.suballocations)
+            {
+                if (range.type == SUBALLOCATION_FREE)
+                {
+                    statistics.largestFreeRange = std::max(statistics.largestFreeRange, range.size);
+                }
+            }
+        }
+    }
+
+    return statistics;
+}
+
+void DeviceMemoryAllocator::Destroy()
+{
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+    {
+        for (MemoryBlock &block : m_blocks[i])
+        {
+            if (block.mapped != nullptr)
+            {
+                vkUnmapMemory(m_device, block.memory);
+            }
+            vkFreeMemory(m_device, block.memory, nullptr);
+        }
+        m_blocks[i].clear();
+    }
+}
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator()
+{
+}
+
+uint32_t DeviceMemoryAllocator::FindMemoryType(uint32_t allowedTypes, VkMemoryPropertyFlags properties)
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    {
+        // Index of memory type must match corresponding bit in allowedTypes
+        // AND
+        // Desired property bit flags are part of memory type's property
+        if ((allowedTypes & (1 << i)) && ((m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties))
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find memory type index");
+}
+
+DeviceMemoryAllocator::MemoryBlock DeviceMemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize minSize)
+{
+    // Don't let a single block take up more than an eighth of a small heap (e.g. 256MB host visible device memory)
+    uint32_t heapIndex = m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    VkDeviceSize preferredSize = std::min(m_blockSize, m_memoryProperties.memoryHeaps[heapIndex].size / 8);
+
+    MemoryBlock block = {};
+    block.size = std::max(preferredSize, minSize);
+    block.memoryTypeIndex = memoryTypeIndex;
+
+    VkMemoryAllocateInfo memAllocInfo = {};
+    memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memAllocInfo.allocationSize = block.size;
+    memAllocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkResult result = vkAllocateMemory(m_device, &memAllocInfo, nullptr, &block.memory);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate device memory block");
+    }
+
+    // Map host visible blocks once, allocations get pointers into the mapping
+    if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        result = vkMapMemory(m_device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped);
+        if (result != VK_SUCCESS)
+        {
+            vkFreeMemory(m_device, block.memory, nullptr);
+            throw std::runtime_error("Failed to map device memory block");
+        }
+    }
+
+    // Whole block starts out as one free range
+    block.suballocations.push_back({0, block.size, SUBALLOCATION_FREE});
+
+    return block;
+}
+
+bool DeviceMemoryAllocator::TryAllocate(MemoryBlock &block, VkDeviceSize size, VkDeviceSize alignment, SuballocationType type, MemoryAllocation *allocation)
+{
+    if (block.size - block.usedBytes < size)
+    {
+        return false;
+    }
+
+    std::vector<Suballocation> &ranges = block.suballocations;
+
+    // First fit over free ranges
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+        if (ranges[i].type != SUBALLOCATION_FREE || ranges[i].size < size)
+        {
+            continue;
+        }
+
+        VkDeviceSize offset = AlignUp(ranges[i].offset, alignment);
+
+        // Previous range is in use (free ranges are always merged), keep a linear/optimal pair on separate pages
+        if (i > 0)
+        {
+            const Suballocation &previous = ranges[i - 1];
+            if (previous.type != type && OnSamePage(previous.offset + previous.size - 1, offset, m_bufferImageGranularity))
+            {
+                offset = AlignUp(offset, m_bufferImageGranularity);
+            }
+        }
+
+        VkDeviceSize rangeEnd = ranges[i].offset + ranges[i].size;
+        if (offset + size > rangeEnd)
+        {
+            continue;
+        }
+
+        // Same check against the following range, it can't be moved so skip this range instead
+        if (i + 1 < ranges.size())
+        {
+            const Suballocation &next = ranges[i + 1];
+            if (next.type != type && OnSamePage(offset + size - 1, next.offset, m_bufferImageGranularity))
+            {
+                continue;
+            }
+        }
+
+        // Split free range into [padding][allocation][remainder]
+        Suballocation padding = {ranges[i].offset, offset - ranges[i].offset, SUBALLOCATION_FREE};
+        Suballocation used = {offset, size, type};
+        Suballocation remainder = {offset + size, rangeEnd - (offset + size), SUBALLOCATION_FREE};
+
+        ranges[i] = used;
+        if (remainder.size > 0)
+        {
+            ranges.insert(ranges.begin() + i + 1, remainder);
+        }
+        if (padding.size > 0)
+        {
+            ranges.insert(ranges.begin() + i, padding);
+        }
+
+        block.usedBytes += size;
+        block.allocationCount++;
+
+        allocation->memory = block.memory;
+        allocation->offset = offset;
+        allocation->size = size;
+        allocation->memoryTypeIndex = block.memoryTypeIndex;
+        allocation->mapped = block.mapped != nullptr ? static_cast<char *>(block.mapped) + offset : nullptr;
+
+        return true;
+    }
+
+    return false;
+}
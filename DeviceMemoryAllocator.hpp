@@ -0,0 +1,88 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <cstdint>
+
+// Region of a pooled VkDeviceMemory block handed out by DeviceMemoryAllocator
+struct MemoryAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE; // Block the allocation lives in (bind resources to this)
+    VkDeviceSize offset = 0;                // Offset of allocation in block (bind resources at this offset)
+    VkDeviceSize size = 0;                  // Size of allocation
+    uint32_t memoryTypeIndex = 0;           // Memory type of block
+    void *mapped = nullptr;                 // Host pointer to start of allocation, only set for host visible memory
+};
+
+// Current usage of device memory
+struct MemoryStatistics
+{
+    uint32_t blockCount = 0;           // Live vkAllocateMemory allocations
+    uint32_t allocationCount = 0;      // Live sub-allocations
+    VkDeviceSize blockBytes = 0;       // Bytes allocated from the device
+    VkDeviceSize allocationBytes = 0;  // Bytes handed out to resources (excluding alignment padding)
+    VkDeviceSize largestFreeRange = 0; // Largest contiguous free range in any block
+};
+
+// Carves buffers and images out of large VkDeviceMemory blocks, one list of blocks per memory type.
+// Host visible blocks stay mapped for their whole lifetime, so allocations must not be mapped again with vkMapMemory.
+class DeviceMemoryAllocator
+{
+public:
+    DeviceMemoryAllocator();
+
+    void Init(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkDeviceSize newBlockSize = 64 * 1024 * 1024);
+
+    // linear: buffer or linear tiled image, otherwise optimal tiled image (kept bufferImageGranularity apart from linear resources)
+    MemoryAllocation Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear);
+    void Free(MemoryAllocation &allocation);
+
+    VkDevice GetDevice();
+    MemoryStatistics GetStatistics() const;
+
+    void Destroy();
+
+    ~DeviceMemoryAllocator();
+
+private:
+    enum SuballocationType
+    {
+        SUBALLOCATION_FREE,
+        SUBALLOCATION_LINEAR,
+        SUBALLOCATION_OPTIMAL
+    };
+
+    // Range inside a block, ranges of a block are kept sorted by offset and cover the whole block
+    struct Suballocation
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        SuballocationType type;
+    };
+
+    struct MemoryBlock
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        VkDeviceSize usedBytes = 0;
+        uint32_t allocationCount = 0;
+        void *mapped = nullptr;
+        std::vector<Suballocation> suballocations{};
+    };
+
+    VkPhysicalDevice m_physicalDevice = nullptr;
+    VkDevice m_device = nullptr;
+
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize m_bufferImageGranularity = 1;
+    VkDeviceSize m_blockSize = 0;
+
+    std::vector<MemoryBlock> m_blocks[VK_MAX_MEMORY_TYPES];
+
+    uint32_t FindMemoryType(uint32_t allowedTypes, VkMemoryPropertyFlags properties);
+    MemoryBlock CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize minSize);
+    bool TryAllocate(MemoryBlock &block, VkDeviceSize size, VkDeviceSize alignment, SuballocationType type, MemoryAllocation *allocation);
+};
@@ -0,0 +1,97 @@
+#include <cstring>
+
+#include "DrawList.hpp"
+
+// Bits of each key field, fields are packed most significant first in this order
+constexpr uint32_t KEY_PIPELINE_BITS = 8;
+constexpr uint32_t KEY_TEXTURE_BITS = 24;
+constexpr uint32_t KEY_DEPTH_BITS = 32;
+
+static_assert(KEY_PIPELINE_BITS + KEY_TEXTURE_BITS + KEY_DEPTH_BITS == 64, "Draw key fields must fill 64 bits");
+
+DrawList::DrawList()
+{
+}
+
+void DrawList::Clear()
+{
+    m_items.clear();
+}
+
+void DrawList::Add(uint64_t key, uint32_t model, uint32_t mesh)
+{
+    m_items.push_back({key, model, mesh});
+}
+
+void DrawList::Sort()
+{
+    const size_t count = m_items.size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    m_scratch.resize(count);
+
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        // Keys per value of this byte
+        uint32_t offsets[256] = {};
+        for (const DrawItem &item : m_items)
+        {
+            offsets[(item.key >> shift) & 0xFF]++;
+        }
+
+        // Every key has the same byte, the pass wouldn't move anything
+        if (offsets[(m_items[0].key >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        // First position of each value in the output
+        uint32_t position = 0;
+        for (uint32_t &offset : offsets)
+        {
+            uint32_t valueCount = offset;
+            offset = position;
+            position += valueCount;
+        }
+
+        // Scattered in input order, so the order the previous passes sorted the lower bytes into is kept
+        for (const DrawItem &item : m_items)
+        {
+            m_scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+        }
+        m_items.swap(m_scratch);
+    }
+}
+
+size_t DrawList::GetCount() const
+{
+    return m_items.size();
+}
+
+const DrawItem &DrawList::GetItem(size_t index) const
+{
+    return m_items[index];
+}
+
+uint64_t DrawList::MakeKey(uint32_t pipeline, uint32_t texture, float depth)
+{
+    // Bits of a non-negative float order the same as its value
+    uint32_t depthBits = 0;
+    if (depth > 0.0f)
+    {
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    }
+
+    uint64_t key = pipeline & ((1u << KEY_PIPELINE_BITS) - 1);
+    key = (key << KEY_TEXTURE_BITS) | (texture & ((1u << KEY_TEXTURE_BITS) - 1));
+    key = (key << KEY_DEPTH_BITS) | depthBits;
+
+    return key;
+}
+
+DrawList::~DrawList()
+{
+}
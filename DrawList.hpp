@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// One draw of a frame, recorded in the order of the keys
+struct DrawItem
+{
+    uint64_t key;   // DrawList::MakeKey
+    uint32_t model; // Model slot
+    uint32_t mesh;  // Mesh of the model
+};
+
+// Draws of a frame sorted by 64 bit keys, so draws sharing a pipeline and texture are recorded one after the
+// other and don't bind them again. Keys are sorted with an LSD radix sort, a byte per pass, skipping passes where every
+// key has the same byte. Storage only grows, so building a list of the same size every frame doesn't allocate.
+class DrawList
+{
+public:
+    DrawList();
+
+    void Clear();
+    void Add(uint64_t key, uint32_t model, uint32_t mesh);
+    // Stable, draws with equal keys keep the order they were added in
+    void Sort();
+
+    size_t GetCount() const;
+    const DrawItem &GetItem(size_t index) const;
+
+    // Pipeline (8 bits), texture (24 bits), then view depth (32 bits), most significant first.
+    // Values too large for their field are masked, which only changes the order of the draws.
+    // Depth is a view space distance, draws of one pipeline and texture are sorted front to back (negative depths sort first)
+    static uint64_t MakeKey(uint32_t pipeline, uint32_t texture, float depth);
+
+    ~DrawList();
+
+private:
+    std::vector<DrawItem> m_items{};
+    std::vector<DrawItem> m_scratch{}; // Items are scattered into it on each pass, then swapped with m_items
+};
@@ -0,0 +1,66 @@
+#include <stdexcept>
+
+#include "FrameAllocator.hpp"
+#include "Utilities.h"
+
+FrameAllocator::FrameAllocator()
+{
+}
+
+void FrameAllocator::Init(DeviceMemoryAllocator *newAllocator, VkDeviceSize newSize, VkDeviceSize newAlignment, VkBufferUsageFlags usageFlags)
+{
+    m_allocator = newAllocator;
+    m_device = newAllocator->GetDevice();
+    m_size = newSize;
+    m_alignment = newAlignment;
+    m_head = 0;
+
+    // Host visible allocations are mapped by the allocator for their whole lifetime
+    CreateBuffer(m_allocator, m_size, usageFlags,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &m_buffer, &m_memory);
+}
+
+FrameAllocation FrameAllocator::Allocate(VkDeviceSize size)
+{
+    // Alignment is a power of two (Vulkan offset alignment limits are)
+    VkDeviceSize offset = (m_head + m_alignment - 1) & ~(m_alignment - 1);
+    if (offset + size > m_size)
+    {
+        throw std::runtime_error("Frame allocator out of space");
+    }
+
+    m_head = offset + size;
+
+    FrameAllocation allocation = {};
+    allocation.mapped = static_cast<char *>(m_memory.mapped) + offset;
+    allocation.offset = static_cast<uint32_t>(offset);
+
+    return allocation;
+}
+
+void FrameAllocator::Reset()
+{
+    m_head = 0;
+}
+
+VkBuffer FrameAllocator::GetBuffer()
+{
+    return m_buffer;
+}
+
+VkDeviceSize FrameAllocator::GetUsedBytes() const
+{
+    return m_head;
+}
+
+void FrameAllocator::Destroy()
+{
+    vkDestroyBuffer(m_device, m_buffer, nullptr);
+    m_buffer = VK_NULL_HANDLE;
+    m_allocator->Free(m_memory);
+}
+
+FrameAllocator::~FrameAllocator()
+{
+}
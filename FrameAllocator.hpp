@@ -0,0 +1,48 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+#include "DeviceMemoryAllocator.hpp"
+
+// Slice of a frame allocator's buffer
+struct FrameAllocation
+{
+    void *mapped = nullptr; // Host pointer to write data to
+    uint32_t offset = 0;    // Offset of slice in buffer (use as dynamic offset when binding)
+};
+
+// Bump allocator over one persistently mapped host visible buffer, handing out aligned slices for data that only
+// lives for one frame (view projection, per-object data). Slices are bound with dynamic offsets.
+// Must only be reset once the GPU has finished the frame that last read from it.
+// Slices are sized to what the frame holds (e.g. the live model and instance transforms), so offsets of later slices
+// move when that changes. The renderer records the offsets into command buffers and re-records them when they move.
+class FrameAllocator
+{
+public:
+    FrameAllocator();
+
+    void Init(DeviceMemoryAllocator *newAllocator, VkDeviceSize newSize, VkDeviceSize newAlignment, VkBufferUsageFlags usageFlags);
+
+    FrameAllocation Allocate(VkDeviceSize size);
+    void Reset();
+
+    VkBuffer GetBuffer();
+    VkDeviceSize GetUsedBytes() const;
+
+    void Destroy();
+
+    ~FrameAllocator();
+
+private:
+    DeviceMemoryAllocator *m_allocator = nullptr;
+    VkDevice m_device = nullptr;
+
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    MemoryAllocation m_memory{};
+    VkDeviceSize m_size = 0;
+    VkDeviceSize m_alignment = 1; // Every slice starts at a multiple of this (min uniform/storage buffer offset alignment)
+    VkDeviceSize m_head = 0;      // Start of free space
+};
@@ -0,0 +1,147 @@
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLER_SSE 1
+#include <xmmintrin.h>
+#endif
+
+#include "FrustumCuller.hpp"
+
+// Boxes are tested in batches of this many, arrays are padded to a multiple of it
+static const size_t CULL_BATCH = 4;
+
+FrustumCuller::FrustumCuller()
+{
+}
+
+void FrustumCuller::Resize(size_t count)
+{
+    m_count = count;
+
+    size_t padded = (count + CULL_BATCH - 1) / CULL_BATCH * CULL_BATCH;
+    if (padded > m_centerX.size())
+    {
+        m_centerX.resize(padded, 0.0f);
+        m_centerY.resize(padded, 0.0f);
+        m_centerZ.resize(padded, 0.0f);
+        m_extentX.resize(padded, 0.0f);
+        m_extentY.resize(padded, 0.0f);
+        m_extentZ.resize(padded, 0.0f);
+        m_visible.resize(padded, 0);
+    }
+}
+
+void FrustumCuller::SetBox(size_t index, const glm::mat4 &transform, const glm::vec3 &minPos, const glm::vec3 &maxPos)
+{
+    glm::vec3 center;
+    glm::vec3 extent;
+    TransformBounds(transform, minPos, maxPos, &center, &extent);
+
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_extentX[index] = extent.x;
+    m_extentY[index] = extent.y;
+    m_extentZ[index] = extent.z;
+}
+
+uint32_t FrustumCuller::Cull(const glm::mat4 &viewProjection)
+{
+    glm::vec4 planes[6];
+    ExtractPlanes(viewProjection, planes);
+
+    // A box is outside once it lies entirely behind one plane: distance of its center below minus its projected extent
+    for (size_t i = 0; i < m_count; i += CULL_BATCH)
+    {
+#ifdef FRUSTUM_CULLER_SSE
+        __m128 centerX = _mm_loadu_ps(&m_centerX[i]);
+        __m128 centerY = _mm_loadu_ps(&m_centerY[i]);
+        __m128 centerZ = _mm_loadu_ps(&m_centerZ[i]);
+        __m128 extentX = _mm_loadu_ps(&m_extentX[i]);
+        __m128 extentY = _mm_loadu_ps(&m_extentY[i]);
+        __m128 extentZ = _mm_loadu_ps(&m_extentZ[i]);
+
+        __m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps()); // All lanes set
+        for (const glm::vec4 &plane : planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_mul_ps(centerY, _mm_set1_ps(plane.y))),
+                                         _mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extentX, _mm_set1_ps(std::abs(plane.x))), _mm_mul_ps(extentY, _mm_set1_ps(std::abs(plane.y)))),
+                                       _mm_mul_ps(extentZ, _mm_set1_ps(std::abs(plane.z))));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (size_t lane = 0; lane < CULL_BATCH; lane++)
+        {
+            m_visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+#else
+        for (size_t lane = 0; lane < CULL_BATCH; lane++)
+        {
+            size_t box = i + lane;
+            bool inside = true;
+            for (const glm::vec4 &plane : planes)
+            {
+                float distance = m_centerX[box] * plane.x + m_centerY[box] * plane.y + m_centerZ[box] * plane.z + plane.w;
+                float radius = m_extentX[box] * std::abs(plane.x) + m_extentY[box] * std::abs(plane.y) + m_extentZ[box] * std::abs(plane.z);
+                inside = inside && distance + radius >= 0.0f;
+            }
+            m_visible[box] = inside ? 1 : 0;
+        }
+#endif
+    }
+
+    uint32_t visibleCount = 0;
+    for (size_t i = 0; i < m_count; i++)
+    {
+        visibleCount += m_visible[i];
+    }
+
+    return visibleCount;
+}
+
+bool FrustumCuller::IsVisible(size_t index) const
+{
+    return index < m_count && m_visible[index] != 0;
+}
+
+void FrustumCuller::TransformBounds(const glm::mat4 &transform, const glm::vec3 &minPos, const glm::vec3 &maxPos,
+                                    glm::vec3 *center, glm::vec3 *extent)
+{
+    // Center moves with the transform, extent along each world axis sums the absolute contributions of the local axes
+    glm::vec3 localCenter = (minPos + maxPos) * 0.5f;
+    glm::vec3 localExtent = (maxPos - minPos) * 0.5f;
+
+    *center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+    *extent = glm::abs(glm::vec3(transform[0])) * localExtent.x +
+              glm::abs(glm::vec3(transform[1])) * localExtent.y +
+              glm::abs(glm::vec3(transform[2])) * localExtent.z;
+}
+
+void FrustumCuller::ExtractPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6])
+{
+    // Rows of the matrix (Gribb and Hartmann 2001), glm stores columns
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+    {
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    planes[0] = row[3] + row[0];
+    planes[1] = row[3] - row[0];
+    planes[2] = row[3] + row[1];
+    planes[3] = row[3] - row[1];
+    // -w <= z holds for both 0 to 1 and -1 to 1 depth projections, at worst it keeps a little more than Vulkan draws
+    planes[4] = row[3] + row[2];
+    planes[5] = row[3] - row[2];
+
+    for (int i = 0; i < 6; i++)
+    {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+FrustumCuller::~FrustumCuller()
+{
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Tests axis aligned boxes against the view frustum, four boxes at a time with SSE (scalar where SSE isn't available).
+// Boxes are kept as separate arrays of centers and half extents so a batch loads straight into registers.
+// Storage only grows, so culling the same number of boxes every frame doesn't allocate.
+class FrustumCuller
+{
+public:
+    FrustumCuller();
+
+    // Number of boxes set with SetBox before the next Cull
+    void Resize(size_t count);
+    // World space box enclosing the local box minPos, maxPos once transformed
+    void SetBox(size_t index, const glm::mat4 &transform, const glm::vec3 &minPos, const glm::vec3 &maxPos);
+
+    // Culls every box against the frustum of viewProjection, returns the number of boxes at least partly inside
+    uint32_t Cull(const glm::mat4 &viewProjection);
+    bool IsVisible(size_t index) const;
+
+    // World space box enclosing the local box minPos, maxPos once transformed (Arvo 1990)
+    static void TransformBounds(const glm::mat4 &transform, const glm::vec3 &minPos, const glm::vec3 &maxPos,
+                                glm::vec3 *center, glm::vec3 *extent);
+    // Planes point inwards (xyz normal, w distance), normalized. Left, right, bottom, top, near, far
+    static void ExtractPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6]);
+
+    ~FrustumCuller();
+
+private:
+    size_t m_count = 0;
+
+    std::vector<float> m_centerX{};
+    std::vector<float> m_centerY{};
+    std::vector<float> m_centerZ{};
+    std::vector<float> m_extentX{};
+    std::vector<float> m_extentY{};
+    std::vector<float> m_extentZ{};
+    std::vector<uint8_t> m_visible{};
+};
@@ -0,0 +1,160 @@
+#include <stdexcept>
+
+#include "GeometryPool.hpp"
+#include "Utilities.h"
+
+GeometryPool::GeometryPool()
+{
+}
+
+void GeometryPool::Init(DeviceMemoryAllocator *newAllocator, uint32_t newVertexSize, VkDeviceSize size)
+{
+    m_allocator = newAllocator;
+    m_device = newAllocator->GetDevice();
+    m_vertexSize = newVertexSize;
+
+    // Meshes are copied in by upload batches, each into its own range
+    CreateBuffer(m_allocator, size,
+                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 &m_vertexBuffer, &m_vertexBufferMemory);
+    CreateBuffer(m_allocator, size,
+                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 &m_indexBuffer, &m_indexBufferMemory);
+
+    // Everything is free
+    m_freeVertices.assign(1, {0, static_cast<uint32_t>(size / m_vertexSize)});
+    m_freeIndices.assign(1, {0, static_cast<uint32_t>(size / sizeof(uint32_t))});
+}
+
+GeometryRange GeometryPool::Allocate(uint32_t vertexCount, uint32_t indexCount)
+{
+    GeometryRange range = {};
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+
+    if (!TakeRange(m_freeVertices, vertexCount, &range.firstVertex))
+    {
+        throw std::runtime_error("Geometry pool vertex buffer is full");
+    }
+
+    if (!TakeRange(m_freeIndices, indexCount, &range.firstIndex))
+    {
+        ReturnRange(m_freeVertices, range.firstVertex, vertexCount);
+        throw std::runtime_error("Geometry pool index buffer is full");
+    }
+
+    return range;
+}
+
+void GeometryPool::Free(const GeometryRange &range)
+{
+    ReturnRange(m_freeVertices, range.firstVertex, range.vertexCount);
+    ReturnRange(m_freeIndices, range.firstIndex, range.indexCount);
+}
+
+VkBuffer GeometryPool::GetVertexBuffer()
+{
+    return m_vertexBuffer;
+}
+
+VkBuffer GeometryPool::GetIndexBuffer()
+{
+    return m_indexBuffer;
+}
+
+uint32_t GeometryPool::GetVertexSize()
+{
+    return m_vertexSize;
+}
+
+void GeometryPool::Destroy()
+{
+    if (m_vertexBuffer == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
+    m_vertexBuffer = VK_NULL_HANDLE;
+    m_allocator->Free(m_vertexBufferMemory);
+
+    vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
+    m_indexBuffer = VK_NULL_HANDLE;
+    m_allocator->Free(m_indexBufferMemory);
+
+    m_freeVertices.clear();
+    m_freeIndices.clear();
+}
+
+GeometryPool::~GeometryPool()
+{
+}
+
+bool GeometryPool::TakeRange(std::vector<FreeRange> &freeRanges, uint32_t count, uint32_t *offset)
+{
+    // Empty meshes take no space
+    if (count == 0)
+    {
+        *offset = 0;
+        return true;
+    }
+
+    for (size_t i = 0; i < freeRanges.size(); i++)
+    {
+        if (freeRanges[i].count < count)
+        {
+            continue;
+        }
+
+        *offset = freeRanges[i].offset;
+        freeRanges[i].offset += count;
+        freeRanges[i].count -= count;
+        if (freeRanges[i].count == 0)
+        {
+            freeRanges.erase(freeRanges.begin() + i);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void GeometryPool::ReturnRange(std::vector<FreeRange> &freeRanges, uint32_t offset, uint32_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // First free range after the one given back
+    size_t next = 0;
+    while (next < freeRanges.size() && freeRanges[next].offset < offset)
+    {
+        next++;
+    }
+
+    // Merge with the free range before and/or after it, otherwise insert it in between
+    bool mergePrevious = next > 0 && freeRanges[next - 1].offset + freeRanges[next - 1].count == offset;
+    bool mergeNext = next < freeRanges.size() && offset + count == freeRanges[next].offset;
+
+    if (mergePrevious && mergeNext)
+    {
+        freeRanges[next - 1].count += count + freeRanges[next].count;
+        freeRanges.erase(freeRanges.begin() + next);
+    }
+    else if (mergePrevious)
+    {
+        freeRanges[next - 1].count += count;
+    }
+    else if (mergeNext)
+    {
+        freeRanges[next].offset = offset;
+        freeRanges[next].count += count;
+    }
+    else
+    {
+        freeRanges.insert(freeRanges.begin() + next, {offset, count});
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "DeviceMemoryAllocator.hpp"
+
+// Part of a geometry pool holding one mesh, in vertices and indices (not bytes)
+struct GeometryRange
+{
+    uint32_t firstVertex = 0; // Vertex offset of the mesh's draws
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;  // Added to the first index of the mesh's draws
+    uint32_t indexCount = 0;
+};
+
+// One device local vertex buffer and one 32 bit index buffer every mesh is placed in, so a single bind of each covers
+// the draws of all of them (GPU-driven rendering draws the whole scene with indirect commands).
+// Ranges are handed out first fit from free lists, ranges given back are merged with free neighbours.
+class GeometryPool
+{
+public:
+    GeometryPool();
+
+    // size is the size of each of the two buffers in bytes, every vertex placed in the pool is vertexSize bytes
+    void Init(DeviceMemoryAllocator *newAllocator, uint32_t newVertexSize, VkDeviceSize size);
+
+    // Throws if either buffer has no free range large enough
+    GeometryRange Allocate(uint32_t vertexCount, uint32_t indexCount);
+    void Free(const GeometryRange &range);
+
+    VkBuffer GetVertexBuffer();
+    VkBuffer GetIndexBuffer();
+    uint32_t GetVertexSize();
+
+    void Destroy();
+
+    ~GeometryPool();
+
+private:
+    struct FreeRange
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    DeviceMemoryAllocator *m_allocator = nullptr;
+    VkDevice m_device = nullptr;
+    uint32_t m_vertexSize = 0;
+
+    VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation m_vertexBufferMemory{};
+    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation m_indexBufferMemory{};
+
+    std::vector<FreeRange> m_freeVertices{}; // Sorted by offset, neighbours are never adjacent
+    std::vector<FreeRange> m_freeIndices{};
+
+    static bool TakeRange(std::vector<FreeRange> &freeRanges, uint32_t count, uint32_t *offset);
+    static void ReturnRange(std::vector<FreeRange> &freeRanges, uint32_t offset, uint32_t count);
+};
@@ -0,0 +1,253 @@
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+#include "Ktx2File.hpp"
+#include "BlockCompression.hpp"
+
+static const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct Ktx2Header
+{
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;             // 0 for 2D textures
+    uint32_t layerCount;             // 0 for non array textures
+    uint32_t faceCount;              // 6 for cube maps, otherwise 1
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+
+    // Index
+    uint32_t dfdByteOffset;          // Data format descriptor
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;          // Key/value data
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;          // Supercompression global data
+    uint64_t sgdByteLength;
+};
+
+// Follows the header, one per level starting with the full size image
+struct Ktx2LevelIndex
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Data format descriptor constants (Khronos Data Format Specification)
+static const uint32_t KHR_DF_MODEL_RGBSDA = 1;
+static const uint32_t KHR_DF_MODEL_BC1A = 128;
+static const uint32_t KHR_DF_MODEL_BC3 = 130;
+static const uint32_t KHR_DF_MODEL_BC7 = 134;
+static const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+static const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+static const uint32_t KHR_DF_CHANNEL_COLOR = 0;
+static const uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+
+static bool IsSupportedFormat(uint32_t format)
+{
+    return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC3_UNORM_BLOCK ||
+           format == VK_FORMAT_BC7_UNORM_BLOCK;
+}
+
+// Level data is aligned to the least common multiple of 4 and the texel block size
+static uint64_t GetLevelAlignment(VkFormat format)
+{
+    return (format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC7_UNORM_BLOCK) ? 16 : (format == VK_FORMAT_BC1_RGB_UNORM_BLOCK ? 8 : 4);
+}
+
+// Basic data format descriptor block: colour model and one sample per channel
+static std::vector<uint32_t> BuildDataFormatDescriptor(VkFormat format)
+{
+    struct Sample
+    {
+        uint32_t bitOffset;
+        uint32_t bitLength;
+        uint32_t channel;
+        uint32_t upper;
+    };
+
+    uint32_t model;
+    uint32_t blockDimensions; // Each byte is block size - 1 in that dimension
+    uint32_t bytesPlane0;
+    std::vector<Sample> samples;
+
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        model = KHR_DF_MODEL_BC1A;
+        blockDimensions = 3 | (3 << 8);
+        bytesPlane0 = 8;
+        samples = {{0, 64, KHR_DF_CHANNEL_COLOR, 0xFFFFFFFF}};
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+        model = KHR_DF_MODEL_BC3;
+        blockDimensions = 3 | (3 << 8);
+        bytesPlane0 = 16;
+        samples = {{0, 64, KHR_DF_CHANNEL_ALPHA, 0xFFFFFFFF}, {64, 64, KHR_DF_CHANNEL_COLOR, 0xFFFFFFFF}};
+        break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+        model = KHR_DF_MODEL_BC7;
+        blockDimensions = 3 | (3 << 8);
+        bytesPlane0 = 16;
+        samples = {{0, 128, KHR_DF_CHANNEL_COLOR, 0xFFFFFFFF}};
+        break;
+    default:
+        model = KHR_DF_MODEL_RGBSDA;
+        blockDimensions = 0;
+        bytesPlane0 = 4;
+        samples = {{0, 8, 0, 255}, {8, 8, 1, 255}, {16, 8, 2, 255}, {24, 8, KHR_DF_CHANNEL_ALPHA, 255}};
+        break;
+    }
+
+    uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+
+    std::vector<uint32_t> descriptor;
+    descriptor.push_back(4 + blockSize);                                                           // Total size
+    descriptor.push_back(0);                                                                       // Vendor (Khronos), descriptor type (basic)
+    descriptor.push_back(2 | (blockSize << 16));                                                   // Version, block size
+    descriptor.push_back(model | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16)); // Model, primaries, transfer, flags
+    descriptor.push_back(blockDimensions);
+    descriptor.push_back(bytesPlane0);                                                             // Bytes in planes 0-3
+    descriptor.push_back(0);                                                                       // Bytes in planes 4-7
+
+    for (const Sample &sample : samples)
+    {
+        descriptor.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channel << 24));
+        descriptor.push_back(0); // Sample position
+        descriptor.push_back(0); // Lower
+        descriptor.push_back(sample.upper);
+    }
+
+    return descriptor;
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool Ktx2File::Write(const std::string &path, VkFormat format, uint32_t width, uint32_t height,
+                     const std::vector<std::vector<uint8_t>> &levels)
+{
+    if (!IsSupportedFormat(format) || levels.empty())
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> descriptor = BuildDataFormatDescriptor(format);
+
+    Ktx2Header header = {};
+    std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    header.vkFormat = format;
+    header.typeSize = 1;
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.pixelDepth = 0;
+    header.layerCount = 0;
+    header.faceCount = 1;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.supercompressionScheme = 0;
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * levels.size());
+    header.dfdByteLength = static_cast<uint32_t>(descriptor.size() * sizeof(uint32_t));
+
+    // Levels are stored smallest first, so a reader streaming the file gets usable low detail levels early
+    std::vector<Ktx2LevelIndex> levelIndex(levels.size());
+    uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+    for (size_t i = levels.size(); i-- > 0;)
+    {
+        offset = AlignUp(offset, GetLevelAlignment(format));
+        levelIndex[i].byteOffset = offset;
+        levelIndex[i].byteLength = levels[i].size();
+        levelIndex[i].uncompressedByteLength = levels[i].size();
+        offset += levels[i].size();
+    }
+
+    std::vector<char> file(static_cast<size_t>(offset), 0);
+    std::memcpy(file.data(), &header, sizeof(Ktx2Header));
+    std::memcpy(file.data() + sizeof(Ktx2Header), levelIndex.data(), sizeof(Ktx2LevelIndex) * levelIndex.size());
+    std::memcpy(file.data() + header.dfdByteOffset, descriptor.data(), header.dfdByteLength);
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        std::memcpy(file.data() + levelIndex[i].byteOffset, levels[i].data(), levels[i].size());
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        return false;
+    }
+
+    out.write(file.data(), file.size());
+    return static_cast<bool>(out);
+}
+
+bool Ktx2File::Read(const std::string &path, VkFormat *format, uint32_t *width, uint32_t *height,
+                    std::vector<uint8_t> *data, std::vector<Ktx2Level> *levels)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> content(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(content.data()), content.size());
+    if (!file || content.size() < sizeof(Ktx2Header))
+    {
+        return false;
+    }
+
+    Ktx2Header header;
+    std::memcpy(&header, content.data(), sizeof(Ktx2Header));
+
+    if (std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 || !IsSupportedFormat(header.vkFormat) ||
+        header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 || header.layerCount != 0 ||
+        header.faceCount != 1 || header.levelCount == 0 || header.levelCount > 32 || header.supercompressionScheme != 0)
+    {
+        return false;
+    }
+
+    if (content.size() < sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * header.levelCount)
+    {
+        return false;
+    }
+
+    std::vector<Ktx2LevelIndex> levelIndex(header.levelCount);
+    std::memcpy(levelIndex.data(), content.data() + sizeof(Ktx2Header), sizeof(Ktx2LevelIndex) * levelIndex.size());
+
+    VkFormat levelFormat = static_cast<VkFormat>(header.vkFormat);
+    levels->resize(header.levelCount);
+    for (uint32_t i = 0; i < header.levelCount; i++)
+    {
+        Ktx2Level &level = (*levels)[i];
+        level.width = std::max(header.pixelWidth >> i, 1u);
+        level.height = std::max(header.pixelHeight >> i, 1u);
+        level.offset = levelIndex[i].byteOffset;
+        level.size = levelIndex[i].byteLength;
+
+        // Level must hold exactly the image of its size, inside the file, at a valid copy offset
+        if (level.size != BlockCompression::GetLevelSize(level.width, level.height, levelFormat) ||
+            level.offset > content.size() || level.size > content.size() - level.offset ||
+            level.offset % GetLevelAlignment(levelFormat) != 0)
+        {
+            return false;
+        }
+    }
+
+    *format = levelFormat;
+    *width = header.pixelWidth;
+    *height = header.pixelHeight;
+    *data = std::move(content);
+
+    return true;
+}
+
+std::string Ktx2File::GetBakedPath(const std::string &sourcePath)
+{
+    return sourcePath + ".ktx2";
+}
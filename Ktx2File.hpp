@@ -0,0 +1,34 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Mip level of a texture read from a KTX2 file, offset is into the data returned with it
+struct Ktx2Level
+{
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Reads and writes the subset of KTX2 (Khronos texture container) the bake tool produces:
+// single 2D image with a full mip chain in R8G8B8A8_UNORM, BC1_RGB_UNORM, BC3_UNORM or BC7_UNORM, no supercompression.
+class Ktx2File
+{
+public:
+    // levels[0] is the full size image, each following level half the size of the previous one
+    static bool Write(const std::string &path, VkFormat format, uint32_t width, uint32_t height,
+                      const std::vector<std::vector<uint8_t>> &levels);
+    // Returns false if the file is missing or uses anything outside the supported subset
+    static bool Read(const std::string &path, VkFormat *format, uint32_t *width, uint32_t *height,
+                     std::vector<uint8_t> *data, std::vector<Ktx2Level> *levels);
+
+    // Baked texture sits next to the image file it was made from, e.g. Textures/wood.jpg -> Textures/wood.jpg.ktx2.
+    // The whole file name is kept, so images differing only by extension don't bake to the same file
+    static std::string GetBakedPath(const std::string &sourcePath);
+};
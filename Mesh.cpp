@@ -1,21 +1,81 @@
-#include <cstring>
-
 #include "Mesh.hpp"
 
+// Full vertices and 32 bit indices as they are, with bounds so the mesh can be culled
+static PackedMesh PackArrays(const Vertex *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount)
+{
+    PackedMesh packedMesh;
+    packedMesh.vertexData = vertices;
+    packedMesh.vertexCount = vertexCount;
+    packedMesh.indexData = indices;
+    packedMesh.indexCount = indexCount;
+
+    if (vertexCount > 0)
+    {
+        packedMesh.boundsMin = packedMesh.boundsMax = vertices[0].pos;
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            packedMesh.boundsMin = glm::min(packedMesh.boundsMin, vertices[i].pos);
+            packedMesh.boundsMax = glm::max(packedMesh.boundsMax, vertices[i].pos);
+        }
+    }
+
+    return packedMesh;
+}
+
 Mesh::Mesh()
 {
 }
 
-Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex> *vertices, std::vector<uint32_t> *indices, int newTexId)
+Mesh::Mesh(DeviceMemoryAllocator *newAllocator, VkDevice newDevice, UploadBatch *upload, std::vector<Vertex> *vertices, std::vector<uint32_t> *indices, int newTexId)
+    : Mesh(newAllocator, newDevice, upload, vertices->data(), static_cast<uint32_t>(vertices->size()),
+           indices->data(), static_cast<uint32_t>(indices->size()), newTexId)
+{
+}
+
+Mesh::Mesh(DeviceMemoryAllocator *newAllocator, VkDevice newDevice, UploadBatch *upload, const Vertex *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount, int newTexId)
+    : Mesh(newAllocator, newDevice, upload, PackArrays(vertices, vertexCount, indices, indexCount), newTexId)
+{
+}
+
+Mesh::Mesh(DeviceMemoryAllocator *newAllocator, VkDevice newDevice, UploadBatch *upload, const PackedMesh &packedMesh, int newTexId,
+           GeometryPool *newGeometryPool)
     :  m_uboModel({glm::mat4(1.0f)}),
       m_texId(newTexId),
-      m_vertexCount(vertices->size()),
-      m_indexCount(indices->size()),
-      m_physicalDevice(newPhysicalDevice),
+      m_vertexCount(packedMesh.vertexCount),
+      m_vertexFormat(packedMesh.vertexFormat),
+      m_dequantization(packedMesh.dequantization),
+      m_indexCount(packedMesh.indexCount),
+      m_indexType(packedMesh.indexType),
+      m_topology(packedMesh.topology),
+      m_geometryPool(newGeometryPool),
+      m_boundingSphere(packedMesh.boundingSphere),
+      m_boundsMin(packedMesh.boundsMin),
+      m_boundsMax(packedMesh.boundsMax),
+      m_allocator(newAllocator),
       m_device(newDevice)
 {
-    CreateVertexBuffer(vertices, transferQueue, transferCommandPool);
-    CreateIndexBuffer(indices, transferQueue, transferCommandPool);
+    if (m_geometryPool != nullptr)
+    {
+        if (m_indexType != VK_INDEX_TYPE_UINT32 || m_topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST ||
+            GetVertexSize(m_vertexFormat) != m_geometryPool->GetVertexSize())
+        {
+            throw std::runtime_error("Mesh doesn't match the layout of the geometry pool");
+        }
+
+        m_geometryRange = m_geometryPool->Allocate(packedMesh.vertexCount, packedMesh.indexCount);
+    }
+
+    if (packedMesh.lodCount > 0)
+    {
+        m_lods.assign(packedMesh.lods, packedMesh.lods + packedMesh.lodCount);
+    }
+    else
+    {
+        m_lods.push_back({0, packedMesh.indexCount, 0.0f});
+    }
+
+    CreateVertexBuffer(packedMesh.vertexData, upload);
+    CreateIndexBuffer(packedMesh.indexData, upload);
 }
 
 int Mesh::GetVertexCount()
@@ -28,6 +88,16 @@ VkBuffer Mesh::GetVertexBuffer()
     return m_vertexBuffer;
 }
 
+VertexFormat Mesh::GetVertexFormat()
+{
+    return m_vertexFormat;
+}
+
+const MeshDequantization *Mesh::GetDequantizationPtr()
+{
+    return &m_dequantization;
+}
+
 int Mesh::GetIndexCount()
 {
     return m_indexCount;
@@ -38,90 +108,154 @@ VkBuffer Mesh::GetIndexBuffer()
     return m_indexBuffer;
 }
 
-Mesh::~Mesh()
+VkIndexType Mesh::GetIndexType()
 {
+    return m_indexType;
 }
 
-void Mesh::CreateVertexBuffer(std::vector<Vertex> *vertices, VkQueue transferQueue, VkCommandPool transferCommandPool)
+VkPrimitiveTopology Mesh::GetTopology()
 {
-    VkDeviceSize bufferSize = sizeof(Vertex) * vertices->size();
+    return m_topology;
+}
 
-    // Temporary Buffer to "Stage" vertex data before transferring to GPU
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+int32_t Mesh::GetVertexOffset()
+{
+    return static_cast<int32_t>(m_geometryRange.firstVertex);
+}
 
-    // Create Buffer and allocate memory
-    CreateBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 &stagingBuffer, &stagingBufferMemory);
+uint32_t Mesh::GetFirstIndex()
+{
+    return m_geometryRange.firstIndex;
+}
+
+uint32_t Mesh::GetLodCount()
+{
+    return static_cast<uint32_t>(m_lods.size());
+}
 
-    // MAP MEMORY TO VERTEX BUFFER
-    void *data;                                                          // 1. Create pointer to a point in normal memory
-    vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &data); // 2. Map the vertex buffer memory to that point
-    memcpy(data, vertices->data(), bufferSize);                          // 3. Copy memory from vertices to the point
-    vkUnmapMemory(m_device, stagingBufferMemory);                        // 4. Unmap the vertex buffer memory
+const MeshLod &Mesh::GetLod(uint32_t lod)
+{
+    if (lod >= m_lods.size())
+    {
+        throw std::runtime_error("Attempted to access invalid Mesh LOD");
+    }
+
+    return m_lods[lod];
+}
+
+uint32_t Mesh::GetSelectedLod()
+{
+    return m_selectedLod;
+}
+
+void Mesh::SetSelectedLod(uint32_t lod)
+{
+    m_selectedLod = lod < m_lods.size() ? lod : static_cast<uint32_t>(m_lods.size()) - 1;
+}
+
+glm::vec4 Mesh::GetBoundingSphere()
+{
+    return m_boundingSphere;
+}
+
+glm::vec3 Mesh::GetBoundsMin()
+{
+    return m_boundsMin;
+}
+
+glm::vec3 Mesh::GetBoundsMax()
+{
+    return m_boundsMax;
+}
+
+bool Mesh::IsVisible()
+{
+    return m_visible;
+}
+
+void Mesh::SetVisible(bool visible)
+{
+    m_visible = visible;
+}
+
+Mesh::~Mesh()
+{
+}
+
+void Mesh::CreateVertexBuffer(const void *vertexData, UploadBatch *upload)
+{
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(GetVertexSize(m_vertexFormat)) * m_vertexCount;
+
+    if (m_geometryPool != nullptr)
+    {
+        // Shared buffer, vertices are copied into the mesh's range of it
+        m_vertexBuffer = m_geometryPool->GetVertexBuffer();
+        upload->UploadBuffer(m_vertexBuffer, vertexData, bufferSize,
+                             VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                             static_cast<VkDeviceSize>(m_geometryPool->GetVertexSize()) * m_geometryRange.firstVertex);
+        return;
+    }
 
     // Create buffer with TRANSFER_DST_BIT to mark as recipient of transfer data (also VERTEX_BUFFER)
     // Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU and only accessible by it and not CPU(host)
-    CreateBuffer(m_physicalDevice, m_device, bufferSize,
+    CreateBuffer(m_allocator, bufferSize,
                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                  &m_vertexBuffer, &m_vertexBufferMemory);
 
-    CopyBuffer(m_device, transferQueue, transferCommandPool, stagingBuffer, m_vertexBuffer, bufferSize);
-
-    // Clean up staging buffer parts
-    vkFreeMemory(m_device, stagingBufferMemory, nullptr);
-    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+    // Stage vertex data and record copy, it lands once the upload batch has been submitted
+    upload->UploadBuffer(m_vertexBuffer, vertexData, bufferSize,
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 }
 
-void Mesh::CreateIndexBuffer(std::vector<uint32_t> *indices, VkQueue transferQueue, VkCommandPool transferCommandPool)
+void Mesh::CreateIndexBuffer(const void *indexData, UploadBatch *upload)
 {
-    VkDeviceSize bufferSize = sizeof(uint32_t) * indices->size();
-
-    // Temporary Buffer to "Stage" index data before transferring to GPU
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    VkDeviceSize indexSize = m_indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    VkDeviceSize bufferSize = indexSize * m_indexCount;
 
-    // Create Buffer and allocate memory
-    CreateBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 &stagingBuffer, &stagingBufferMemory);
-
-    // MAP MEMORY TO INDEX BUFFER
-    void *data;                                                          // 1. Create pointer to a point in normal memory
-    vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &data); // 2. Map the index buffer memory to that point
-    memcpy(data, indices->data(), bufferSize);                           // 3. Copy memory from vertices to the point
-    vkUnmapMemory(m_device, stagingBufferMemory);                        // 4. Unmap the index buffer memory
+    if (m_geometryPool != nullptr)
+    {
+        // Shared buffer, indices are copied into the mesh's range of it
+        m_indexBuffer = m_geometryPool->GetIndexBuffer();
+        upload->UploadBuffer(m_indexBuffer, indexData, bufferSize,
+                             VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                             sizeof(uint32_t) * static_cast<VkDeviceSize>(m_geometryRange.firstIndex));
+        return;
+    }
 
     // Create buffer with TRANSFER_DST_BIT to mark as recipient of transfer data (also INDEX_BUFFER)
     // Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU and only accessible by it and not CPU(host)
-    CreateBuffer(m_physicalDevice, m_device, bufferSize,
+    CreateBuffer(m_allocator, bufferSize,
                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                  &m_indexBuffer, &m_indexBufferMemory);
 
-    CopyBuffer(m_device, transferQueue, transferCommandPool, stagingBuffer, m_indexBuffer, bufferSize);
-
-    // Clean up staging buffer parts
-    vkFreeMemory(m_device, stagingBufferMemory, nullptr);
-    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+    // Stage index data and record copy, it lands once the upload batch has been submitted
+    upload->UploadBuffer(m_indexBuffer, indexData, bufferSize,
+                         VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 }
 
 void Mesh::DestroyBuffers()
 {
-    vkFreeMemory(m_device, m_vertexBufferMemory, nullptr);
-    m_vertexBufferMemory = nullptr;
+    if (m_geometryPool != nullptr)
+    {
+        // Buffers belong to the pool, only give the mesh's range back
+        m_geometryPool->Free(m_geometryRange);
+        m_geometryPool = nullptr;
+        m_vertexBuffer = nullptr;
+        m_indexBuffer = nullptr;
+        return;
+    }
 
     vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
     m_vertexBuffer = nullptr;
 
-    vkFreeMemory(m_device, m_indexBufferMemory, nullptr);
-    m_indexBufferMemory = nullptr;
+    m_allocator->Free(m_vertexBufferMemory);
 
     vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
-
     m_indexBuffer = nullptr;
+
+    m_allocator->Free(m_indexBufferMemory);
 }
 
 void Mesh::SetModel(glm::mat4 newModel)
@@ -7,18 +7,57 @@
 #include <vector>
 
 #include "Utilities.h"
+#include "UploadBatch.hpp"
+#include "GeometryPool.hpp"
 
 struct Model {
     glm::mat4 model;
 };
 
+// Levels of detail a mesh can have, LOD 0 is the full mesh
+constexpr uint32_t MAX_MESH_LODS = 4;
+
+// Level of detail of a mesh: a range of its index buffer, every level indexes the same vertex buffer
+struct MeshLod
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f; // Distance the simplified surface is off the full mesh at most, in mesh units
+};
+
+// Mesh in the layout it is uploaded in (see MeshModel::PackVertices and PackIndices), data is copied into staging
+struct PackedMesh
+{
+    const void *vertexData = nullptr;
+    uint32_t vertexCount = 0;
+    VertexFormat vertexFormat = VertexFormat::Full;
+    MeshDequantization dequantization{}; // Pushed with every draw of the mesh
+
+    const void *indexData = nullptr;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; // Strips are split by the primitive restart index
+
+    const MeshLod *lods = nullptr;   // Ranges of the index data, a single level spanning all of it if there are none
+    uint32_t lodCount = 0;
+    glm::vec4 boundingSphere{0.0f}; // Center and radius in mesh units, LOD selection keeps LOD 0 if the radius is 0
+    glm::vec3 boundsMin{0.0f};      // Axis aligned bounds in mesh units, culled against the view frustum
+    glm::vec3 boundsMax{0.0f};
+};
+
 class Mesh
 {
 public:
     Mesh();
-    Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice,
-     VkQueue transferQueue, VkCommandPool transferCommandPool,
+    Mesh(DeviceMemoryAllocator *newAllocator, VkDevice newDevice, UploadBatch *upload,
      std::vector<Vertex> *vertices, std::vector<uint32_t> *indices, int newTexId);
+    // Same from plain arrays (e.g. a mapped mesh cache), data is copied into staging before returning
+    Mesh(DeviceMemoryAllocator *newAllocator, VkDevice newDevice, UploadBatch *upload,
+     const Vertex *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount, int newTexId);
+    // With a geometry pool, vertices and indices go to a range of its buffers instead of buffers of the mesh's own
+    // (32 bit triangle list indices only, vertices of the pool's size)
+    Mesh(DeviceMemoryAllocator *newAllocator, VkDevice newDevice, UploadBatch *upload, const PackedMesh &packedMesh, int newTexId,
+         GeometryPool *newGeometryPool = nullptr);
 
     void SetModel(glm::mat4 newModel);
     Model GetModel();
@@ -26,9 +65,28 @@ public:
 
     int GetVertexCount();
     VkBuffer GetVertexBuffer();
+    VertexFormat GetVertexFormat();
+    const MeshDequantization *GetDequantizationPtr();
 
     int GetIndexCount();
     VkBuffer GetIndexBuffer();
+    VkIndexType GetIndexType();
+    VkPrimitiveTopology GetTopology();
+    // Where the mesh starts in its buffers, added to every draw (0 unless it is in a geometry pool)
+    int32_t GetVertexOffset();
+    uint32_t GetFirstIndex();
+
+    uint32_t GetLodCount();
+    const MeshLod &GetLod(uint32_t lod);
+    // LOD drawn by RecordCommands, chosen every frame from the screen size of the bounding sphere
+    uint32_t GetSelectedLod();
+    void SetSelectedLod(uint32_t lod);
+    glm::vec4 GetBoundingSphere();
+    glm::vec3 GetBoundsMin();
+    glm::vec3 GetBoundsMax();
+    // Whether the last frustum cull found the mesh on screen, RecordCommands skips it otherwise
+    bool IsVisible();
+    void SetVisible(bool visible);
 
     int GetTexId();
 
@@ -42,16 +100,30 @@ private:
     int m_texId;
 
     int m_vertexCount;
+    VertexFormat m_vertexFormat = VertexFormat::Full;
+    MeshDequantization m_dequantization{};
     VkBuffer m_vertexBuffer{};
-    VkDeviceMemory m_vertexBufferMemory{};
+    MemoryAllocation m_vertexBufferMemory{};
 
     int m_indexCount;
+    VkIndexType m_indexType = VK_INDEX_TYPE_UINT32;
+    VkPrimitiveTopology m_topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     VkBuffer m_indexBuffer{};
-    VkDeviceMemory m_indexBufferMemory{};
+    MemoryAllocation m_indexBufferMemory{};
+
+    GeometryPool *m_geometryPool = nullptr; // Owner of the buffers if the mesh doesn't have its own
+    GeometryRange m_geometryRange{};
+
+    std::vector<MeshLod> m_lods{};
+    uint32_t m_selectedLod = 0;
+    glm::vec4 m_boundingSphere{0.0f};
+    glm::vec3 m_boundsMin{0.0f};
+    glm::vec3 m_boundsMax{0.0f};
+    bool m_visible = true;
 
-    VkPhysicalDevice m_physicalDevice;
+    DeviceMemoryAllocator *m_allocator;
     VkDevice m_device;
 
-    void CreateVertexBuffer(std::vector<Vertex> *vertices, VkQueue transferQueue, VkCommandPool transferCommandPool);
-    void CreateIndexBuffer(std::vector<uint32_t> *indices, VkQueue transferQueue, VkCommandPool transferCommandPool);
+    void CreateVertexBuffer(const void *vertexData, UploadBatch *upload);
+    void CreateIndexBuffer(const void *indexData, UploadBatch *upload);
 };
@@ -0,0 +1,517 @@
+#include <stdexcept>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "MeshCache.hpp"
+#include "TextureCache.hpp"
+
+// Bump whenever the layout below changes, older cache files are then rebuilt
+static const uint32_t CACHE_VERSION = 6;
+static const char CACHE_MAGIC[8] = {'V', 'K', 'M', 'E', 'S', 'H', 'C', '\0'};
+
+// Vertex and index arrays start at multiples of this
+static const uint64_t DATA_ALIGNMENT = 16;
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexSize;   // Size of one vertex in vertexFormat in the build that wrote the file
+    uint32_t importFlags;  // Assimp post processing flags the model was imported with
+    uint32_t textureCount;
+    uint32_t meshCount;
+    uint32_t vertexFormat; // VertexFormat meshes were packed in
+    uint64_t sourceSize;   // Model file the cache was made from
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    uint64_t fileSize;     // Whole cache file, a truncated file is stale
+    uint32_t processFlags; // MeshProcessFlags meshes were processed with
+    uint32_t reserved;
+};
+
+// Followed by the texture names (uint32_t length and characters each), then the vertex and index arrays
+struct CacheMeshRecord
+{
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t materialIndex;
+    uint32_t indexType;    // VkIndexType, UINT16 or UINT32
+    uint32_t topology;     // VkPrimitiveTopology, TRIANGLE_LIST or TRIANGLE_STRIP
+    uint32_t reserved;
+    MeshDequantization dequantization;
+    glm::vec4 boundingSphere;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    uint32_t lodCount;
+    MeshLod lods[MAX_MESH_LODS]; // Ranges of the index array, read in place from the mapping
+};
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Size and modification time of a file, false if it doesn't exist
+static bool GetSourceStamp(const std::string &path, uint64_t *size, int64_t *time)
+{
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    std::filesystem::file_time_type fileTime = std::filesystem::last_write_time(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    *size = static_cast<uint64_t>(fileSize);
+    *time = static_cast<int64_t>(fileTime.time_since_epoch().count());
+    return true;
+}
+
+static bool HashSource(const std::string &path, uint64_t *hash)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::vector<char> content(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(content.data(), content.size());
+    if (!file)
+    {
+        return false;
+    }
+
+    *hash = TextureCache::HashContent(content.data(), content.size());
+    return true;
+}
+
+// Rewrite only the model time in the header of a cache file, rest of the file stays as it is
+static bool UpdateSourceTime(const std::string &cachePath, int64_t sourceTime)
+{
+    std::fstream file(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    file.seekp(offsetof(CacheHeader, sourceTime));
+    file.write(reinterpret_cast<const char *>(&sourceTime), sizeof(sourceTime));
+
+    return static_cast<bool>(file);
+}
+
+MeshCache::MeshCache()
+{
+}
+
+bool MeshCache::Open(const std::string &cachePath, const std::string &sourcePath, uint32_t importFlags, uint32_t processFlags,
+                     VertexFormat vertexFormat)
+{
+    Close();
+
+    if (!Map(cachePath))
+    {
+        return false;
+    }
+
+    int64_t sourceTime;
+    bool sourceTouched;
+    if (!Parse(sourcePath, importFlags, processFlags, vertexFormat, &sourceTime, &sourceTouched))
+    {
+        Close();
+        return false;
+    }
+
+    // Model file only got a new time, store it so the next open doesn't hash the model again. The header is rewritten
+    // while the file isn't mapped, if that fails the model is just hashed again next time
+    if (sourceTouched)
+    {
+        Close();
+        UpdateSourceTime(cachePath, sourceTime);
+
+        if (!Map(cachePath) || !Parse(sourcePath, importFlags, processFlags, vertexFormat, &sourceTime, &sourceTouched))
+        {
+            Close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MeshCache::Close()
+{
+    m_textureNames.clear();
+    m_meshes.clear();
+    Unmap();
+}
+
+VertexFormat MeshCache::GetVertexFormat() const
+{
+    return m_vertexFormat;
+}
+
+const std::vector<std::string> &MeshCache::GetTextureNames() const
+{
+    return m_textureNames;
+}
+
+size_t MeshCache::GetMeshCount() const
+{
+    return m_meshes.size();
+}
+
+const CachedMesh &MeshCache::GetMesh(size_t index) const
+{
+    if (index >= m_meshes.size())
+    {
+        throw std::runtime_error("Attempted to access invalid cached Mesh Index");
+    }
+
+    return m_meshes[index];
+}
+
+bool MeshCache::Write(const std::string &cachePath, const std::string &sourcePath, uint32_t importFlags, uint32_t processFlags,
+                      VertexFormat vertexFormat, const std::vector<std::string> &textureNames, const std::vector<MeshData> &meshData)
+{
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.vertexSize = GetVertexSize(vertexFormat);
+    header.importFlags = importFlags;
+    header.vertexFormat = static_cast<uint32_t>(vertexFormat);
+    header.processFlags = processFlags;
+    header.textureCount = static_cast<uint32_t>(textureNames.size());
+    header.meshCount = static_cast<uint32_t>(meshData.size());
+
+    if (!GetSourceStamp(sourcePath, &header.sourceSize, &header.sourceTime) || !HashSource(sourcePath, &header.sourceHash))
+    {
+        return false;
+    }
+
+    // Lay out file: header, mesh records, texture names, then every mesh's vertices and indices
+    uint64_t size = sizeof(CacheHeader) + sizeof(CacheMeshRecord) * meshData.size();
+    for (const std::string &name : textureNames)
+    {
+        size += sizeof(uint32_t) + name.size();
+    }
+
+    std::vector<CacheMeshRecord> records(meshData.size());
+    for (size_t i = 0; i < meshData.size(); i++)
+    {
+        if (meshData[i].vertexFormat != vertexFormat)
+        {
+            return false;
+        }
+
+        records[i] = {};
+        records[i].vertexCount = static_cast<uint32_t>(meshData[i].vertices.size());
+        records[i].indexCount = meshData[i].indexCount;
+        records[i].indexType = static_cast<uint32_t>(meshData[i].indexType);
+        records[i].topology = static_cast<uint32_t>(meshData[i].topology);
+        records[i].materialIndex = meshData[i].materialIndex;
+        records[i].dequantization = meshData[i].dequantization;
+        records[i].boundingSphere = meshData[i].boundingSphere;
+        records[i].boundsMin = meshData[i].boundsMin;
+        records[i].boundsMax = meshData[i].boundsMax;
+
+        if (meshData[i].packedLods.size() > MAX_MESH_LODS)
+        {
+            return false;
+        }
+        records[i].lodCount = static_cast<uint32_t>(meshData[i].packedLods.size());
+        std::copy(meshData[i].packedLods.begin(), meshData[i].packedLods.end(), records[i].lods);
+
+        records[i].vertexOffset = AlignUp(size, DATA_ALIGNMENT);
+        size = records[i].vertexOffset + meshData[i].vertexData.size();
+
+        records[i].indexOffset = AlignUp(size, DATA_ALIGNMENT);
+        size = records[i].indexOffset + meshData[i].indexData.size();
+    }
+    header.fileSize = size;
+
+    // Assemble whole file in memory, then write it in one go
+    std::vector<char> file(static_cast<size_t>(size), 0);
+    char *cursor = file.data();
+
+    std::memcpy(cursor, &header, sizeof(CacheHeader));
+    cursor += sizeof(CacheHeader);
+
+    std::memcpy(cursor, records.data(), sizeof(CacheMeshRecord) * records.size());
+    cursor += sizeof(CacheMeshRecord) * records.size();
+
+    for (const std::string &name : textureNames)
+    {
+        uint32_t length = static_cast<uint32_t>(name.size());
+        std::memcpy(cursor, &length, sizeof(uint32_t));
+        std::memcpy(cursor + sizeof(uint32_t), name.data(), name.size());
+        cursor += sizeof(uint32_t) + name.size();
+    }
+
+    for (size_t i = 0; i < meshData.size(); i++)
+    {
+        std::memcpy(file.data() + records[i].vertexOffset, meshData[i].vertexData.data(), meshData[i].vertexData.size());
+        std::memcpy(file.data() + records[i].indexOffset, meshData[i].indexData.data(), meshData[i].indexData.size());
+    }
+
+    // Write to a temporary file and move it in place, so a reader never maps a half written cache
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            return false;
+        }
+
+        out.write(file.data(), file.size());
+        if (!out)
+        {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+std::string MeshCache::GetCachePath(const std::string &sourcePath)
+{
+    return sourcePath + ".meshcache";
+}
+
+MeshCache::~MeshCache()
+{
+    Close();
+}
+
+bool MeshCache::Map(const std::string &path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (fileMapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void *data = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr)
+    {
+        CloseHandle(fileMapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_fileMapping = fileMapping;
+    m_data = static_cast<const char *>(data);
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat = {};
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    void *data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+    // Mapping stays valid after the descriptor is closed
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    m_data = static_cast<const char *>(data);
+    m_size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+    return true;
+}
+
+void MeshCache::Unmap()
+{
+    if (m_data == nullptr)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_fileMapping);
+    CloseHandle(m_file);
+    m_fileMapping = nullptr;
+    m_file = nullptr;
+#else
+    munmap(const_cast<char *>(m_data), m_size);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool MeshCache::Parse(const std::string &sourcePath, uint32_t importFlags, uint32_t processFlags, VertexFormat vertexFormat,
+                      int64_t *sourceTime, bool *sourceTouched)
+{
+    *sourceTouched = false;
+    if (m_size < sizeof(CacheHeader))
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, m_data, sizeof(CacheHeader));
+
+    // Written by another version, with other import or process flags or vertex format or cut short
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.vertexFormat != static_cast<uint32_t>(vertexFormat) || header.vertexSize != GetVertexSize(vertexFormat) ||
+        header.importFlags != importFlags || header.processFlags != processFlags || header.fileSize != m_size)
+    {
+        return false;
+    }
+
+    // Model file changed since the cache was written (same content with a new time, e.g. after a checkout, still matches)
+    uint64_t sourceSize;
+    if (!GetSourceStamp(sourcePath, &sourceSize, sourceTime) || sourceSize != header.sourceSize)
+    {
+        return false;
+    }
+    if (*sourceTime != header.sourceTime)
+    {
+        uint64_t sourceHash;
+        if (!HashSource(sourcePath, &sourceHash) || sourceHash != header.sourceHash)
+        {
+            return false;
+        }
+        *sourceTouched = true;
+    }
+
+    // Mesh records
+    uint64_t cursor = sizeof(CacheHeader);
+    if (header.meshCount > (m_size - cursor) / sizeof(CacheMeshRecord))
+    {
+        return false;
+    }
+
+    std::vector<CacheMeshRecord> records(header.meshCount);
+    std::memcpy(records.data(), m_data + cursor, sizeof(CacheMeshRecord) * records.size());
+    cursor += sizeof(CacheMeshRecord) * records.size();
+
+    // Texture names
+    m_textureNames.resize(header.textureCount);
+    for (std::string &name : m_textureNames)
+    {
+        uint32_t length;
+        if (m_size - cursor < sizeof(uint32_t))
+        {
+            return false;
+        }
+        std::memcpy(&length, m_data + cursor, sizeof(uint32_t));
+        cursor += sizeof(uint32_t);
+
+        if (m_size - cursor < length)
+        {
+            return false;
+        }
+        name.assign(m_data + cursor, length);
+        cursor += length;
+    }
+
+    // Point meshes into the mapping (offsets are aligned and the mapping starts on a page boundary)
+    m_meshes.resize(records.size());
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const CacheMeshRecord &record = records[i];
+        uint64_t vertexBytes = header.vertexSize * static_cast<uint64_t>(record.vertexCount);
+        uint64_t indexSize = record.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        uint64_t indexBytes = indexSize * static_cast<uint64_t>(record.indexCount);
+
+        if (record.materialIndex >= header.textureCount ||
+            (record.indexType != VK_INDEX_TYPE_UINT16 && record.indexType != VK_INDEX_TYPE_UINT32) ||
+            (record.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST && record.topology != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP) ||
+            record.vertexOffset % DATA_ALIGNMENT != 0 || record.indexOffset % DATA_ALIGNMENT != 0 ||
+            record.vertexOffset > m_size || vertexBytes > m_size - record.vertexOffset ||
+            record.indexOffset > m_size || indexBytes > m_size - record.indexOffset ||
+            record.lodCount == 0 || record.lodCount > MAX_MESH_LODS)
+        {
+            return false;
+        }
+        for (uint32_t lod = 0; lod < record.lodCount; lod++)
+        {
+            if (record.lods[lod].firstIndex > record.indexCount || record.lods[lod].indexCount > record.indexCount - record.lods[lod].firstIndex)
+            {
+                return false;
+            }
+        }
+
+        PackedMesh &packedMesh = m_meshes[i].packedMesh;
+        packedMesh.vertexData = m_data + record.vertexOffset;
+        packedMesh.vertexCount = record.vertexCount;
+        packedMesh.vertexFormat = vertexFormat;
+        packedMesh.dequantization = record.dequantization;
+        packedMesh.indexData = m_data + record.indexOffset;
+        packedMesh.indexCount = record.indexCount;
+        packedMesh.indexType = static_cast<VkIndexType>(record.indexType);
+        packedMesh.topology = static_cast<VkPrimitiveTopology>(record.topology);
+        packedMesh.lods = reinterpret_cast<const MeshLod *>(m_data + sizeof(CacheHeader) + sizeof(CacheMeshRecord) * i +
+                                                            offsetof(CacheMeshRecord, lods));
+        packedMesh.lodCount = record.lodCount;
+        packedMesh.boundingSphere = record.boundingSphere;
+        packedMesh.boundsMin = record.boundsMin;
+        packedMesh.boundsMax = record.boundsMax;
+        m_meshes[i].materialIndex = record.materialIndex;
+    }
+
+    m_vertexFormat = vertexFormat;
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "MeshModel.hpp"
+
+// Mesh stored in a cache file, data pointers stay valid while the cache is open
+struct CachedMesh
+{
+    PackedMesh packedMesh{};
+    unsigned int materialIndex = 0; // Scene material, same as MeshData::materialIndex
+};
+
+// Binary copy of an imported model (converted meshes and material texture names) stored next to the model file.
+// The file is mapped into memory when opened, so meshes are read in place instead of being parsed.
+// A cache is stale once the model file changes (size plus modification time, or content hash), the import flags,
+// process flags (MeshProcessFlags) or vertex format differ or the layout of the file or of the vertex structs changed.
+class MeshCache
+{
+public:
+    MeshCache();
+
+    // Map cache file, returns false if there is none or it is stale (caller imports the model instead)
+    bool Open(const std::string &cachePath, const std::string &sourcePath, uint32_t importFlags, uint32_t processFlags,
+              VertexFormat vertexFormat);
+    void Close();
+
+    VertexFormat GetVertexFormat() const;
+    const std::vector<std::string> &GetTextureNames() const;
+    size_t GetMeshCount() const;
+    const CachedMesh &GetMesh(size_t index) const;
+
+    // Write cache for a freshly imported model, returns false if the file couldn't be written
+    // Meshes must have been packed in vertexFormat
+    static bool Write(const std::string &cachePath, const std::string &sourcePath, uint32_t importFlags, uint32_t processFlags,
+                      VertexFormat vertexFormat, const std::vector<std::string> &textureNames, const std::vector<MeshData> &meshData);
+    static std::string GetCachePath(const std::string &sourcePath);
+
+    ~MeshCache();
+
+private:
+    // Mapping of the whole cache file
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    VertexFormat m_vertexFormat = VertexFormat::Full;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_fileMapping = nullptr;
+#endif
+
+    std::vector<std::string> m_textureNames{};
+    std::vector<CachedMesh> m_meshes{};
+
+    bool Map(const std::string &path);
+    void Unmap();
+    // sourceTouched is set when the model file only got a new modification time (sourceTime) but has the same content
+    bool Parse(const std::string &sourcePath, uint32_t importFlags, uint32_t processFlags, VertexFormat vertexFormat,
+               int64_t *sourceTime, bool *sourceTouched);
+};
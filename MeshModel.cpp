@@ -1,9 +1,28 @@
+#include <cstring>
+#include <algorithm>
+
+#include <glm/gtc/packing.hpp>
+
 #include "MeshModel.hpp"
+#include "MeshCache.hpp"
+
+// Meshes with fewer triangles than this are cheap enough to always draw in full
+static const size_t LOD_MIN_TRIANGLES = 64;
+
+MeshModel::MeshModel()
+    : m_model(glm::mat4{1.0f})
+{
+}
 
 MeshModel::MeshModel(std::vector<Mesh> &newMeshList)
     : m_meshList(newMeshList),
       m_model(glm::mat4{1.0f})
 {
+    for (size_t i = 0; i < m_meshList.size(); i++)
+    {
+        m_boundsMin = i == 0 ? m_meshList[i].GetBoundsMin() : glm::min(m_boundsMin, m_meshList[i].GetBoundsMin());
+        m_boundsMax = i == 0 ? m_meshList[i].GetBoundsMax() : glm::max(m_boundsMax, m_meshList[i].GetBoundsMax());
+    }
 }
 
 uint32_t MeshModel::GetMeshCount()
@@ -36,6 +55,16 @@ void MeshModel::SetModel(const glm::mat4 &newModel)
     m_model = newModel;
 }
 
+glm::vec3 MeshModel::GetBoundsMin()
+{
+    return m_boundsMin;
+}
+
+glm::vec3 MeshModel::GetBoundsMax()
+{
+    return m_boundsMax;
+}
+
 void MeshModel::DestroyModel()
 {
     for (Mesh &mesh : m_meshList)
@@ -77,34 +106,60 @@ std::vector<std::string> MeshModel::LoadMaterials(const aiScene *scene)
     return textureList;
 }
 
-std::vector<Mesh> MeshModel::LoadModel(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
+std::vector<Mesh> MeshModel::LoadModel(DeviceMemoryAllocator *allocator, VkDevice device, UploadBatch *upload,
                                        aiNode *node, const aiScene *scene, std::vector<int> &matToTex)
 {
-    std::vector<Mesh> meshList;
+    // Flatten node tree into list of meshes (same order as walking the tree)
+    std::vector<aiMesh *> sceneMeshes;
+    CollectMeshes(node, scene, sceneMeshes);
+
+    std::vector<MeshData> meshData(sceneMeshes.size());
+    for (size_t i = 0; i < sceneMeshes.size(); i++)
+    {
+        meshData[i] = ConvertMesh(sceneMeshes[i]);
+        PackVertices(meshData[i], VertexFormat::Full);
+        PackIndices(meshData[i], false);
+    }
+
+    return CreateMeshes(allocator, device, upload, meshData, matToTex);
+}
+
+Mesh MeshModel::LoadMesh(DeviceMemoryAllocator *allocator, VkDevice device, UploadBatch *upload,
+                         aiMesh *mesh, const aiScene *scene, std::vector<int> &matToTex)
+{
+    MeshData data = ConvertMesh(mesh);
+    PackVertices(data, VertexFormat::Full);
+    PackIndices(data, false);
+
+    // Create new mesh with details (and the bounds computed on conversion) and return it
+    Mesh newMesh = Mesh(allocator, device, upload, GetPackedMesh(data), matToTex[data.materialIndex]);
 
-    // Go through each mesh at this node and create it, then add it to out meshList
+    return newMesh;
+}
+
+void MeshModel::CollectMeshes(aiNode *node, const aiScene *scene, std::vector<aiMesh *> &meshes)
+{
+    // Go through each mesh at this node and add it to the list
     for (size_t i = 0; i < node->mNumMeshes; i++)
     {
-        meshList.push_back(
-            LoadMesh(physicalDevice, device, transferQueue, transferCommandPool, scene->mMeshes[node->mMeshes[i]], scene, matToTex));
+        meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
     }
 
-    // Go through each node attached to this node and load it, then append their meshes to this node's mesh list
+    // Go through each node attached to this node and append their meshes
     for (size_t i = 0; i < node->mNumChildren; i++)
     {
-        std::vector<Mesh> newList = LoadModel(physicalDevice, device, transferQueue, transferCommandPool, node->mChildren[i], scene, matToTex);
-        meshList.insert(meshList.end(), newList.begin(), newList.end());
+        CollectMeshes(node->mChildren[i], scene, meshes);
     }
-
-    return meshList;
 }
 
-Mesh MeshModel::LoadMesh(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
-                         aiMesh *mesh, const aiScene *scene, std::vector<int> &matToTex)
+MeshData MeshModel::ConvertMesh(aiMesh *mesh)
 {
-    std::vector<uint32_t> indices;
+    MeshData data;
+    data.materialIndex = mesh->mMaterialIndex;
+
     // Vertex list for holding all vertices for mesh
-    std::vector<Vertex> vertices(mesh->mNumVertices);
+    std::vector<Vertex> &vertices = data.vertices;
+    vertices.resize(mesh->mNumVertices);
 
     for (size_t i = 0; i < mesh->mNumVertices; i++)
     {
@@ -127,21 +182,252 @@ Mesh MeshModel::LoadMesh(VkPhysicalDevice physicalDevice, VkDevice device, VkQue
         vertices[i].col = {1.f, 1.f, 1.f};
     }
 
-    // Iterate over indices through faces and copy across
+    // Iterate over indices through faces and copy across (triangulated on import, so 3 per face)
+    std::vector<uint32_t> &indices = data.indices;
+    indices.reserve(mesh->mNumFaces * 3);
     for (size_t i = 0; i < mesh->mNumFaces; i++)
     {
         // Get a face
-        aiFace face = mesh->mFaces[i];
+        const aiFace &face = mesh->mFaces[i];
         for (size_t j = 0; j < face.mNumIndices; j++)
         {
             indices.push_back(face.mIndices[j]);
         }
     }
 
-    // Create new mesh with details and return it
-    Mesh newMesh = Mesh(physicalDevice, device, transferQueue, transferCommandPool, &vertices, &indices, matToTex[mesh->mMaterialIndex]);
+    // Bounds are culled against the view frustum, the sphere around their center is projected to the screen for LOD selection
+    if (!vertices.empty())
+    {
+        glm::vec3 minPos = vertices[0].pos;
+        glm::vec3 maxPos = vertices[0].pos;
+        for (const Vertex &vertex : vertices)
+        {
+            minPos = glm::min(minPos, vertex.pos);
+            maxPos = glm::max(maxPos, vertex.pos);
+        }
+        data.boundsMin = minPos;
+        data.boundsMax = maxPos;
 
-    return newMesh;
+        glm::vec3 center = (minPos + maxPos) * 0.5f;
+        float radius = 0.0f;
+        for (const Vertex &vertex : vertices)
+        {
+            radius = std::max(radius, glm::length(vertex.pos - center));
+        }
+        data.boundingSphere = glm::vec4(center, radius);
+    }
+
+    return data;
+}
+
+void MeshModel::GenerateLods(MeshData &data)
+{
+    data.lods.assign(1, MeshLod{0, static_cast<uint32_t>(data.indices.size()), 0.0f});
+
+    // Every level is simplified from the one before, so their errors add up
+    std::vector<uint32_t> lodIndices = data.indices;
+    float lodError = 0.0f;
+    while (data.lods.size() < MAX_MESH_LODS && lodIndices.size() / 3 >= LOD_MIN_TRIANGLES * 2)
+    {
+        float error;
+        std::vector<uint32_t> simplified = MeshOptimizer::Simplify(data.vertices, lodIndices, lodIndices.size() / 6, &error);
+
+        // Locked borders and seams can stop simplification early, a level that is barely smaller isn't worth keeping
+        if (simplified.size() > lodIndices.size() * 3 / 4)
+        {
+            break;
+        }
+
+        std::vector<uint32_t> clusters;
+        lodIndices = MeshOptimizer::OptimizeVertexCache(simplified, data.vertices.size(), MeshOptimizer::CACHE_SIZE, &clusters);
+        lodError += error;
+
+        data.lods.push_back({static_cast<uint32_t>(data.indices.size()), static_cast<uint32_t>(lodIndices.size()), lodError});
+        data.indices.insert(data.indices.end(), lodIndices.begin(), lodIndices.end());
+    }
+}
+
+void MeshModel::PackVertices(MeshData &data, VertexFormat format)
+{
+    const std::vector<Vertex> &vertices = data.vertices;
+
+    data.vertexFormat = format;
+    data.vertexData.resize(static_cast<size_t>(GetVertexSize(format)) * vertices.size());
+    data.dequantization = MeshDequantization{};
+
+    switch (format)
+    {
+    case VertexFormat::Compact:
+    {
+        CompactVertex *packed = reinterpret_cast<CompactVertex *>(data.vertexData.data());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            packed[i].pos = vertices[i].pos;
+            packed[i].tex = glm::packHalf2x16(vertices[i].tex);
+        }
+        break;
+    }
+    case VertexFormat::Quantized:
+    {
+        // Positions are stored relative to the mesh bounds, so 16 bits cover the mesh however large it is
+        glm::vec3 minPos(0.0f);
+        glm::vec3 maxPos(0.0f);
+        if (!vertices.empty())
+        {
+            minPos = maxPos = vertices[0].pos;
+        }
+        for (const Vertex &vertex : vertices)
+        {
+            minPos = glm::min(minPos, vertex.pos);
+            maxPos = glm::max(maxPos, vertex.pos);
+        }
+
+        glm::vec3 center = (minPos + maxPos) * 0.5f;
+        glm::vec3 extent = (maxPos - minPos) * 0.5f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            // Flat mesh, any scale reproduces the single value
+            if (extent[axis] <= 0.0f)
+            {
+                extent[axis] = 1.0f;
+            }
+        }
+
+        QuantizedVertex *packed = reinterpret_cast<QuantizedVertex *>(data.vertexData.data());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            glm::vec3 normalized = (vertices[i].pos - center) / extent;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                packed[i].pos[axis] = static_cast<int16_t>(glm::packSnorm1x16(normalized[axis]));
+            }
+            packed[i].pos[3] = 0;
+            packed[i].tex = glm::packHalf2x16(vertices[i].tex);
+        }
+
+        data.dequantization.positionScale = glm::vec4(extent, 1.0f);
+        data.dequantization.positionOffset = glm::vec4(center, 0.0f);
+        break;
+    }
+    default:
+        if (!vertices.empty())
+        {
+            std::memcpy(data.vertexData.data(), vertices.data(), data.vertexData.size());
+        }
+        break;
+    }
+}
+
+void MeshModel::PackIndices(MeshData &data, bool allowStrips, bool allowShortIndices)
+{
+    // Largest value is reserved as primitive restart index
+    bool shortIndices = allowShortIndices && data.vertices.size() < UINT16_MAX;
+    uint32_t restartIndex = shortIndices ? UINT16_MAX : UINT32_MAX;
+
+    std::vector<MeshLod> lods = data.lods;
+    if (lods.empty())
+    {
+        lods.push_back({0, static_cast<uint32_t>(data.indices.size()), 0.0f});
+    }
+
+    const std::vector<uint32_t> *indices = &data.indices;
+    std::vector<uint32_t> strips;
+    std::vector<MeshLod> stripLods = lods;
+    data.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    data.packedLods = lods;
+    if (allowStrips)
+    {
+        for (MeshLod &lod : stripLods)
+        {
+            std::vector<uint32_t> lodIndices(data.indices.begin() + lod.firstIndex,
+                                             data.indices.begin() + lod.firstIndex + lod.indexCount);
+            std::vector<uint32_t> lodStrips = MeshOptimizer::GenerateStrips(lodIndices, restartIndex);
+
+            lod.firstIndex = static_cast<uint32_t>(strips.size());
+            lod.indexCount = static_cast<uint32_t>(lodStrips.size());
+            strips.insert(strips.end(), lodStrips.begin(), lodStrips.end());
+        }
+
+        if (strips.size() < data.indices.size())
+        {
+            indices = &strips;
+            data.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+            data.packedLods = stripLods;
+        }
+    }
+
+    data.indexCount = static_cast<uint32_t>(indices->size());
+    if (shortIndices)
+    {
+        data.indexType = VK_INDEX_TYPE_UINT16;
+        data.indexData.resize(sizeof(uint16_t) * indices->size());
+
+        uint16_t *packed = reinterpret_cast<uint16_t *>(data.indexData.data());
+        for (size_t i = 0; i < indices->size(); i++)
+        {
+            packed[i] = static_cast<uint16_t>((*indices)[i]);
+        }
+    }
+    else
+    {
+        data.indexType = VK_INDEX_TYPE_UINT32;
+        data.indexData.resize(sizeof(uint32_t) * indices->size());
+        if (!indices->empty())
+        {
+            std::memcpy(data.indexData.data(), indices->data(), data.indexData.size());
+        }
+    }
+}
+
+PackedMesh MeshModel::GetPackedMesh(const MeshData &data)
+{
+    PackedMesh packedMesh;
+    packedMesh.vertexData = data.vertexData.data();
+    packedMesh.vertexCount = static_cast<uint32_t>(data.vertices.size());
+    packedMesh.vertexFormat = data.vertexFormat;
+    packedMesh.dequantization = data.dequantization;
+    packedMesh.indexData = data.indexData.data();
+    packedMesh.indexCount = data.indexCount;
+    packedMesh.indexType = data.indexType;
+    packedMesh.topology = data.topology;
+    packedMesh.lods = data.packedLods.data();
+    packedMesh.lodCount = static_cast<uint32_t>(data.packedLods.size());
+    packedMesh.boundingSphere = data.boundingSphere;
+    packedMesh.boundsMin = data.boundsMin;
+    packedMesh.boundsMax = data.boundsMax;
+
+    return packedMesh;
+}
+
+std::vector<Mesh> MeshModel::CreateMeshes(DeviceMemoryAllocator *allocator, VkDevice device, UploadBatch *upload,
+                                          std::vector<MeshData> &meshData, const std::vector<int> &matToTex,
+                                          GeometryPool *geometryPool)
+{
+    std::vector<Mesh> meshList;
+    meshList.reserve(meshData.size());
+
+    for (MeshData &data : meshData)
+    {
+        meshList.push_back(Mesh(allocator, device, upload, GetPackedMesh(data), matToTex[data.materialIndex], geometryPool));
+    }
+
+    return meshList;
+}
+
+std::vector<Mesh> MeshModel::CreateMeshes(DeviceMemoryAllocator *allocator, VkDevice device, UploadBatch *upload,
+                                          const MeshCache &meshCache, const std::vector<int> &matToTex,
+                                          GeometryPool *geometryPool)
+{
+    std::vector<Mesh> meshList;
+    meshList.reserve(meshCache.GetMeshCount());
+
+    for (size_t i = 0; i < meshCache.GetMeshCount(); i++)
+    {
+        const CachedMesh &mesh = meshCache.GetMesh(i);
+        meshList.push_back(Mesh(allocator, device, upload, mesh.packedMesh, matToTex[mesh.materialIndex], geometryPool));
+    }
+
+    return meshList;
 }
 
 MeshModel::~MeshModel()
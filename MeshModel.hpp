@@ -6,6 +6,43 @@
 #include <glm/glm.hpp>
 
 #include "Mesh.hpp"
+#include "MeshOptimizer.hpp"
+
+class MeshCache;
+
+// Steps run on imported meshes before they are packed, part of the mesh cache key
+enum MeshProcessFlags : uint32_t
+{
+    MESH_PROCESS_OPTIMIZE = 1 << 0,     // MeshOptimizer: vertex cache, overdraw and vertex fetch order
+    MESH_PROCESS_STRIPS = 1 << 1,       // Triangle strips with primitive restart where they take fewer indices than the list
+    MESH_PROCESS_LODS = 1 << 2,         // Simplified levels of detail (MeshOptimizer::Simplify) after the full mesh
+    MESH_PROCESS_WIDE_INDICES = 1 << 3, // 32 bit indices even if the vertices fit 16 bits (meshes in a geometry pool)
+};
+
+// CPU side of a mesh, converted from the imported scene and ready to be uploaded
+struct MeshData
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    unsigned int materialIndex = 0; // Scene material, mapped to a texture once textures are created
+    MeshOptimizationStatistics optimization{}; // Only filled in if the mesh was optimized
+    std::vector<MeshLod> lods;                 // Ranges of indices, LOD 0 first (all indices as one level if empty)
+    glm::vec4 boundingSphere{0.0f};            // Center and radius of the vertices
+    glm::vec3 boundsMin{0.0f};                 // Axis aligned bounds of the vertices
+    glm::vec3 boundsMax{0.0f};
+
+    // Vertices in the layout they are uploaded in, filled in by PackVertices
+    VertexFormat vertexFormat = VertexFormat::Full;
+    std::vector<uint8_t> vertexData;
+    MeshDequantization dequantization{};
+
+    // Indices in the layout they are uploaded in, filled in by PackIndices
+    std::vector<uint8_t> indexData;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    std::vector<MeshLod> packedLods;           // Ranges of indexData, one per LOD
+};
 
 class MeshModel
 {
@@ -19,18 +56,43 @@ public:
     glm::mat4 GetModel();
     const glm::mat4 *GetModelPtr();
     void SetModel(const glm::mat4 &newModel);
+    // Bounds of all meshes, in model space
+    glm::vec3 GetBoundsMin();
+    glm::vec3 GetBoundsMax();
 
     void DestroyModel();
 
     static std::vector<std::string> LoadMaterials(const aiScene *scene);
-    static std::vector<Mesh> LoadModel(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
+    static std::vector<Mesh> LoadModel(DeviceMemoryAllocator *allocator, VkDevice device, UploadBatch *upload,
                                        aiNode *node, const aiScene *scene, std::vector<int> &matToTex);
-    static Mesh LoadMesh(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
+    static Mesh LoadMesh(DeviceMemoryAllocator *allocator, VkDevice device, UploadBatch *upload,
                          aiMesh *mesh, const aiScene *scene, std::vector<int> &matToTex);
 
+    // Split steps of LoadModel: ConvertMesh only touches CPU data (safe to run on worker threads),
+    // CreateMeshes creates the buffers and records their uploads
+    static void CollectMeshes(aiNode *node, const aiScene *scene, std::vector<aiMesh *> &meshes);
+    static MeshData ConvertMesh(aiMesh *mesh);
+    // Appends simplified levels (half the triangles of the level before each) to the indices of an unpacked mesh
+    static void GenerateLods(MeshData &data);
+    static void PackVertices(MeshData &data, VertexFormat format);
+    // 16 bit indices whenever the vertices fit (and they are allowed), strips only if allowed and smaller than the list.
+    // Each LOD is packed on its own, so it stays a single range of the index buffer
+    static void PackIndices(MeshData &data, bool allowStrips, bool allowShortIndices = true);
+    static PackedMesh GetPackedMesh(const MeshData &data);
+    // Meshes get buffers of their own, or ranges of the geometry pool if one is given
+    static std::vector<Mesh> CreateMeshes(DeviceMemoryAllocator *allocator, VkDevice device, UploadBatch *upload,
+                                          std::vector<MeshData> &meshData, const std::vector<int> &matToTex,
+                                          GeometryPool *geometryPool = nullptr);
+    // Same for meshes read from a mesh cache, copies straight from the mapped file into staging
+    static std::vector<Mesh> CreateMeshes(DeviceMemoryAllocator *allocator, VkDevice device, UploadBatch *upload,
+                                          const MeshCache &meshCache, const std::vector<int> &matToTex,
+                                          GeometryPool *geometryPool = nullptr);
+
     ~MeshModel();
 
 private:
     std::vector<Mesh> m_meshList;
     glm::mat4 m_model;
+    glm::vec3 m_boundsMin{0.0f};
+    glm::vec3 m_boundsMax{0.0f};
 };
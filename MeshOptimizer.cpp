@@ -0,0 +1,700 @@
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+#include "MeshOptimizer.hpp"
+
+// Triangles using each vertex, as one flat list with a range per vertex
+struct VertexAdjacency
+{
+    std::vector<uint32_t> offsets;   // vertexCount + 1 entries, triangles of v are [offsets[v], offsets[v + 1])
+    std::vector<uint32_t> triangles;
+};
+
+static VertexAdjacency BuildAdjacency(const std::vector<uint32_t> &indices, size_t vertexCount)
+{
+    VertexAdjacency adjacency;
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (uint32_t index : indices)
+    {
+        adjacency.offsets[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        adjacency.offsets[v + 1] += adjacency.offsets[v];
+    }
+
+    adjacency.triangles.resize(indices.size());
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    return adjacency;
+}
+
+MeshOptimizationStatistics MeshOptimizer::Optimize(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    MeshOptimizationStatistics statistics;
+    statistics.triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    statistics.before = AnalyzeVertexCache(indices, vertices.size(), CACHE_SIZE);
+
+    if (!indices.empty())
+    {
+        std::vector<uint32_t> clusters;
+        indices = OptimizeVertexCache(indices, vertices.size(), CACHE_SIZE, &clusters);
+        indices = OptimizeOverdraw(indices, vertices, clusters, CACHE_SIZE, OVERDRAW_THRESHOLD);
+        vertices = OptimizeVertexFetch(vertices, indices);
+    }
+
+    statistics.vertexCount = static_cast<uint32_t>(vertices.size());
+    statistics.after = AnalyzeVertexCache(indices, vertices.size(), CACHE_SIZE);
+
+    return statistics;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize,
+                                                         std::vector<uint32_t> *clusters)
+{
+    const size_t triangleCount = indices.size() / 3;
+    VertexAdjacency adjacency = BuildAdjacency(indices, vertexCount);
+
+    // Triangles not yet emitted per vertex, and when each vertex last entered the cache
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<uint32_t> deadEnd;     // Recently used vertices, to continue from when a fan runs out
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;                 // Next vertex to try once the dead end stack is empty too
+    clusters->clear();
+
+    int64_t fanning = 0;
+    bool newCluster = true;
+    while (fanning >= 0)
+    {
+        uint32_t vertex = static_cast<uint32_t>(fanning);
+        candidates.clear();
+
+        // Emit every remaining triangle around the fanning vertex
+        for (uint32_t i = adjacency.offsets[vertex]; i < adjacency.offsets[vertex + 1]; i++)
+        {
+            uint32_t triangle = adjacency.triangles[i];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+
+            if (newCluster)
+            {
+                clusters->push_back(static_cast<uint32_t>(result.size() / 3));
+                newCluster = false;
+            }
+
+            for (size_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t v = indices[triangle * 3 + corner];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+
+                // Vertex wasn't in the cache anymore, so it is transformed (enters the cache) again
+                if (time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Next fanning vertex: the candidate that is still in the cache and will stay there longest while its fan is emitted
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+            {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+            {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+
+        if (fanning >= 0)
+        {
+            continue;
+        }
+
+        // Dead end: fall back to a recently used vertex, then to the next vertex in input order (cache starts over)
+        while (!deadEnd.empty() && fanning < 0)
+        {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[v] > 0)
+            {
+                fanning = v;
+            }
+        }
+        while (cursor < vertexCount && fanning < 0)
+        {
+            if (liveTriangles[cursor] > 0)
+            {
+                fanning = static_cast<int64_t>(cursor);
+                newCluster = true;
+            }
+            cursor++;
+        }
+    }
+
+    return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeOverdraw(const std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices,
+                                                      const std::vector<uint32_t> &clusters, uint32_t cacheSize, float threshold)
+{
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0 || clusters.empty())
+    {
+        return indices;
+    }
+
+    // Split clusters wherever the part so far is about as cache efficient as the whole mesh, restarting the cache there costs little
+    const double meshAcmr = AnalyzeVertexCache(indices, vertices.size(), cacheSize).acmr;
+    std::vector<uint32_t> splitClusters;
+    std::vector<uint32_t> cacheTime(vertices.size(), 0);
+    uint32_t time = cacheSize + 1;
+
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        uint32_t start = clusters[c];
+        uint32_t misses = 0;
+
+        splitClusters.push_back(start);
+        time += cacheSize + 1; // Empty cache at the start of every cluster
+        for (uint32_t triangle = start; triangle < end; triangle++)
+        {
+            for (size_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t v = indices[triangle * 3 + corner];
+                if (time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time++;
+                    misses++;
+                }
+            }
+
+            uint32_t clusterTriangles = triangle + 1 - splitClusters.back();
+            if (triangle + 1 < end && misses <= meshAcmr * threshold * clusterTriangles)
+            {
+                splitClusters.push_back(triangle + 1);
+                misses = 0;
+                time += cacheSize + 1;
+            }
+        }
+    }
+
+    // Mesh centroid, weighted by triangle area
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        const glm::vec3 &a = vertices[indices[triangle * 3 + 0]].pos;
+        const glm::vec3 &b = vertices[indices[triangle * 3 + 1]].pos;
+        const glm::vec3 &c = vertices[indices[triangle * 3 + 2]].pos;
+
+        float area = glm::length(glm::cross(b - a, c - a));
+        meshCentroid += (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+    {
+        meshCentroid /= meshArea;
+    }
+
+    // Clusters facing away from the mesh centre are more likely to occlude the others, so they are drawn first
+    std::vector<float> sortKeys(splitClusters.size());
+    for (size_t c = 0; c < splitClusters.size(); c++)
+    {
+        uint32_t end = c + 1 < splitClusters.size() ? splitClusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f); // Sum of area weighted normals
+        float area = 0.0f;
+        for (uint32_t triangle = splitClusters[c]; triangle < end; triangle++)
+        {
+            const glm::vec3 &p0 = vertices[indices[triangle * 3 + 0]].pos;
+            const glm::vec3 &p1 = vertices[indices[triangle * 3 + 1]].pos;
+            const glm::vec3 &p2 = vertices[indices[triangle * 3 + 2]].pos;
+
+            glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(triangleNormal);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+        if (area > 0.0f)
+        {
+            centroid /= area;
+        }
+
+        float normalLength = glm::length(normal);
+        sortKeys[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+    }
+
+    std::vector<uint32_t> order(splitClusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b)
+                     { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t c : order)
+    {
+        uint32_t end = c + 1 < splitClusters.size() ? splitClusters[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + splitClusters[c] * 3, indices.begin() + end * 3);
+    }
+
+    return result;
+}
+
+std::vector<Vertex> MeshOptimizer::OptimizeVertexFetch(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    const uint32_t unused = UINT32_MAX;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = static_cast<uint32_t>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::GenerateStrips(const std::vector<uint32_t> &indices, uint32_t restartIndex)
+{
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    // Every directed edge (a to b, in winding order) with its triangle, sorted so a triangle across an edge is a binary search away
+    struct DirectedEdge
+    {
+        uint64_t key; // a << 32 | b
+        uint32_t triangle;
+    };
+    std::vector<DirectedEdge> edges(indices.size());
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+    {
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            uint64_t a = indices[triangle * 3 + corner];
+            uint64_t b = indices[triangle * 3 + (corner + 1) % 3];
+            edges[triangle * 3 + corner] = {a << 32 | b, triangle};
+        }
+    }
+    std::sort(edges.begin(), edges.end(), [](const DirectedEdge &lhs, const DirectedEdge &rhs)
+              { return lhs.key < rhs.key; });
+
+    std::vector<bool> used(triangleCount, false);
+
+    // Unused triangle holding the directed edge a to b, its third vertex in *opposite
+    auto findTriangle = [&](uint32_t a, uint32_t b, uint32_t *opposite) -> int64_t
+    {
+        uint64_t key = static_cast<uint64_t>(a) << 32 | b;
+        auto it = std::lower_bound(edges.begin(), edges.end(), key, [](const DirectedEdge &edge, uint64_t value)
+                                   { return edge.key < value; });
+        for (; it != edges.end() && it->key == key; ++it)
+        {
+            if (used[it->triangle])
+            {
+                continue;
+            }
+
+            const uint32_t *t = &indices[it->triangle * 3];
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                if (t[corner] == a && t[(corner + 1) % 3] == b)
+                {
+                    *opposite = t[(corner + 2) % 3];
+                    return it->triangle;
+                }
+            }
+        }
+        return -1;
+    };
+
+    std::vector<uint32_t> strips;
+    strips.reserve(indices.size());
+
+    for (uint32_t start = 0; start < triangleCount; start++)
+    {
+        if (used[start])
+        {
+            continue;
+        }
+
+        // Start with the rotation of the triangle whose last edge leads on to another triangle
+        const uint32_t *t = &indices[start * 3];
+        uint32_t rotation = 0;
+        for (uint32_t r = 0; r < 3; r++)
+        {
+            uint32_t opposite;
+            used[start] = true;
+            bool continues = findTriangle(t[(r + 2) % 3], t[(r + 1) % 3], &opposite) >= 0;
+            used[start] = false;
+            if (continues)
+            {
+                rotation = r;
+                break;
+            }
+        }
+
+        if (!strips.empty())
+        {
+            strips.push_back(restartIndex);
+        }
+
+        uint32_t p = t[(rotation + 1) % 3];
+        uint32_t q = t[(rotation + 2) % 3];
+        strips.push_back(t[rotation]);
+        strips.push_back(p);
+        strips.push_back(q);
+        used[start] = true;
+
+        // Strip triangle i is (v[i], v[i + 1], v[i + 2]) for even i and (v[i + 1], v[i], v[i + 2]) for odd i,
+        // so the next triangle has to hold the edge p to q after an even count and q to p after an odd count
+        for (uint32_t stripTriangles = 1;; stripTriangles++)
+        {
+            uint32_t next;
+            int64_t triangle = (stripTriangles % 2 == 0) ? findTriangle(p, q, &next) : findTriangle(q, p, &next);
+            if (triangle < 0)
+            {
+                break;
+            }
+
+            used[triangle] = true;
+            strips.push_back(next);
+            p = q;
+            q = next;
+        }
+    }
+
+    return strips;
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStatistics statistics;
+    if (indices.empty())
+    {
+        return statistics;
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    size_t usedCount = 0;
+
+    for (uint32_t index : indices)
+    {
+        if (time - cacheTime[index] > cacheSize)
+        {
+            cacheTime[index] = time++;
+            misses++;
+        }
+        if (!used[index])
+        {
+            used[index] = true;
+            usedCount++;
+        }
+    }
+
+    statistics.acmr = static_cast<double>(misses) / (indices.size() / 3);
+    statistics.atvr = static_cast<double>(misses) / usedCount;
+    return statistics;
+}
+
+// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix of the plane equations
+struct Quadric
+{
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+
+    void AddPlane(const glm::vec3 &normal, float distance)
+    {
+        double a = normal.x, b = normal.y, c = normal.z, d = distance;
+        a2 += a * a; ab += a * b; ac += a * c; ad += a * d;
+        b2 += b * b; bc += b * c; bd += b * d;
+        c2 += c * c; cd += c * d;
+        d2 += d * d;
+    }
+
+    void Add(const Quadric &other)
+    {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+    }
+
+    double Evaluate(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+                       b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                       c2 * z * z + 2 * cd * z +
+                       d2;
+        return error > 0.0 ? error : 0.0;
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+std::vector<uint32_t> MeshOptimizer::Simplify(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                              size_t targetTriangleCount, float *error)
+{
+    const size_t vertexCount = vertices.size();
+    std::vector<uint32_t> result = indices;
+    double maxCost = 0.0;
+
+    // Vertices sharing a position (UV seams) are locked, moving one of them would tear the surface
+    std::vector<uint32_t> positionOf(vertexCount);
+    {
+        std::vector<uint32_t> order(vertexCount);
+        std::iota(order.begin(), order.end(), 0);
+        auto positionLess = [&vertices](uint32_t a, uint32_t b)
+        {
+            const glm::vec3 &p = vertices[a].pos;
+            const glm::vec3 &q = vertices[b].pos;
+            return p.x != q.x ? p.x < q.x : (p.y != q.y ? p.y < q.y : p.z < q.z);
+        };
+        std::sort(order.begin(), order.end(), positionLess);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            bool samePosition = i > 0 && !positionLess(order[i - 1], order[i]) && !positionLess(order[i], order[i - 1]);
+            positionOf[order[i]] = samePosition ? positionOf[order[i - 1]] : order[i];
+        }
+    }
+
+    std::vector<uint32_t> positionUses(vertexCount, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        positionUses[positionOf[v]]++;
+    }
+    std::vector<bool> lockedPositions(vertexCount, false);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        lockedPositions[positionOf[v]] = lockedPositions[positionOf[v]] || positionUses[positionOf[v]] > 1;
+    }
+
+    // Border edges (used by one triangle only) lock both their vertices, so outlines and holes keep their shape
+    {
+        std::vector<uint64_t> edges;
+        edges.reserve(result.size());
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (size_t corner = 0; corner < 3; corner++)
+            {
+                uint64_t a = positionOf[result[i + corner]];
+                uint64_t b = positionOf[result[i + (corner + 1) % 3]];
+                edges.push_back(a < b ? (a << 32 | b) : (b << 32 | a));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for (size_t i = 0; i < edges.size();)
+        {
+            size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i])
+            {
+                j++;
+            }
+            if (j - i == 1)
+            {
+                lockedPositions[edges[i] >> 32] = true;
+                lockedPositions[edges[i] & 0xFFFFFFFF] = true;
+            }
+            i = j;
+        }
+    }
+
+    std::vector<bool> locked(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        locked[v] = lockedPositions[positionOf[v]];
+    }
+
+    // Planes of the triangles around each vertex, collapsed vertices hand theirs on to the vertex they moved to
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const glm::vec3 &p0 = vertices[result[i + 0]].pos;
+        const glm::vec3 &p1 = vertices[result[i + 1]].pos;
+        const glm::vec3 &p2 = vertices[result[i + 2]].pos;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length <= 0.0f)
+        {
+            continue;
+        }
+        normal /= length;
+
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            quadrics[result[i + corner]].AddPlane(normal, -glm::dot(normal, p0));
+        }
+    }
+
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<Collapse> collapses;
+
+    // Each pass collapses the cheapest edges whose neighbourhoods don't overlap, then rebuilds the triangle list
+    size_t triangleCount = result.size() / 3;
+    while (triangleCount > targetTriangleCount)
+    {
+        VertexAdjacency adjacency = BuildAdjacency(result, vertexCount);
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (size_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t from = result[i + corner];
+                uint32_t to = result[i + (corner + 1) % 3];
+                if (!locked[from])
+                {
+                    Quadric quadric = quadrics[from];
+                    quadric.Add(quadrics[to]);
+                    collapses.push_back({from, to, quadric.Evaluate(vertices[to].pos)});
+                }
+                if (!locked[to])
+                {
+                    Quadric quadric = quadrics[to];
+                    quadric.Add(quadrics[from]);
+                    collapses.push_back({to, from, quadric.Evaluate(vertices[from].pos)});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b)
+                  { return a.cost < b.cost; });
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t collapsed = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (triangleCount <= targetTriangleCount)
+            {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            // Moving the vertex must not flip any of the triangles that stay, or turn them by more than ~75 degrees
+            const glm::vec3 &target = vertices[collapse.to].pos;
+            bool flips = false;
+            size_t removed = 0;
+            for (uint32_t t = adjacency.offsets[collapse.from]; t < adjacency.offsets[collapse.from + 1] && !flips; t++)
+            {
+                const uint32_t *triangle = &result[adjacency.triangles[t] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    removed++;
+                    continue;
+                }
+
+                glm::vec3 p[3];
+                glm::vec3 moved[3];
+                for (size_t corner = 0; corner < 3; corner++)
+                {
+                    p[corner] = vertices[triangle[corner]].pos;
+                    moved[corner] = triangle[corner] == collapse.from ? target : p[corner];
+                }
+
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+            }
+            if (flips || removed == 0)
+            {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            maxCost = std::max(maxCost, collapse.cost);
+            triangleCount -= removed;
+            collapsed++;
+
+            // Triangles around the moved vertex changed, their other collapses are out of date until the next pass
+            for (uint32_t t = adjacency.offsets[collapse.from]; t < adjacency.offsets[collapse.from + 1]; t++)
+            {
+                const uint32_t *triangle = &result[adjacency.triangles[t] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+        }
+
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        // Apply collapses and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            uint32_t a = remap[result[i + 0]];
+            uint32_t b = remap[result[i + 1]];
+            uint32_t c = remap[result[i + 2]];
+            if (a != b && b != c && c != a)
+            {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+        triangleCount = result.size() / 3;
+    }
+
+    *error = static_cast<float>(std::sqrt(maxCost));
+    return result;
+}
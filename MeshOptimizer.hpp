@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Utilities.h"
+
+// Post transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStatistics
+{
+    double acmr = 0.0; // Average cache miss ratio: vertices transformed per triangle (0.5 at best, 3 at worst)
+    double atvr = 0.0; // Average transformed vertex ratio: vertices transformed per vertex used (1 at best)
+};
+
+// Result of optimizing one mesh
+struct MeshOptimizationStatistics
+{
+    uint32_t vertexCount = 0;
+    uint32_t triangleCount = 0;
+    VertexCacheStatistics before{};
+    VertexCacheStatistics after{};
+};
+
+// Reorders triangle lists for the GPU: Tipsify vertex cache ordering (Sander, Nehab and Barczak 2007), clusters of it
+// sorted so outward facing ones are drawn first (less overdraw), then vertices remapped into first use order (fetch locality).
+// Only the order of triangles and vertices changes, the mesh looks the same.
+class MeshOptimizer
+{
+public:
+    static constexpr uint32_t CACHE_SIZE = 16;          // FIFO entries optimized for and simulated
+    static constexpr float OVERDRAW_THRESHOLD = 1.05f;  // ACMR a cluster may reach (relative to the whole mesh) before it is split
+
+    // All three steps, vertices that no triangle uses are dropped
+    static MeshOptimizationStatistics Optimize(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+    // Tipsify, returns first triangle of every cluster (where the cache had to start over) in clusters
+    static std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize,
+                                                     std::vector<uint32_t> *clusters);
+    // Splits clusters further while they keep a low ACMR, then sorts them front to back on average
+    static std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t> &indices, const std::vector<Vertex> &vertices,
+                                                  const std::vector<uint32_t> &clusters, uint32_t cacheSize, float threshold);
+    // Rewrites indices in place, returns vertices in the order they are first used
+    static std::vector<Vertex> OptimizeVertexFetch(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+    // Triangle strips following the triangle order of a list, strips are separated by restartIndex (primitive restart).
+    // Winding is kept, so the strips draw the same front faces as the list.
+    static std::vector<uint32_t> GenerateStrips(const std::vector<uint32_t> &indices, uint32_t restartIndex);
+
+    // Quadric error edge collapse (Garland and Heckbert 1997). Vertices are only ever moved onto a neighbouring vertex,
+    // so the result indexes the same vertex buffer. Vertices on borders and UV seams stay in place.
+    // Stops at targetTriangleCount triangles, or when no collapse is left; *error is the distance the surface moved at most.
+    static std::vector<uint32_t> Simplify(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                          size_t targetTriangleCount, float *error);
+
+    static VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize);
+};
@@ -0,0 +1,422 @@
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include "SceneTree.hpp"
+
+static float SurfaceArea(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+    glm::vec3 size = boundsMax - boundsMin;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+SceneTree::SceneTree()
+{
+}
+
+int32_t SceneTree::CreateProxy(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, uint32_t userData)
+{
+    int32_t proxy = AllocateNode();
+
+    glm::vec3 size = boundsMax - boundsMin;
+    glm::vec3 margin(FAT_MARGIN * std::max({size.x, size.y, size.z}));
+    m_nodes[proxy].boundsMin = boundsMin - margin;
+    m_nodes[proxy].boundsMax = boundsMax + margin;
+    m_nodes[proxy].userData = userData;
+    m_nodes[proxy].height = 0;
+
+    InsertLeaf(proxy);
+    m_proxyCount++;
+
+    return proxy;
+}
+
+void SceneTree::DestroyProxy(int32_t proxy)
+{
+    if (proxy < 0 || proxy >= static_cast<int32_t>(m_nodes.size()) || !m_nodes[proxy].IsLeaf() || m_nodes[proxy].height != 0)
+    {
+        throw std::runtime_error("Attempted to destroy invalid Scene Tree proxy");
+    }
+
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    m_proxyCount--;
+}
+
+bool SceneTree::MoveProxy(int32_t proxy, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+    if (proxy < 0 || proxy >= static_cast<int32_t>(m_nodes.size()) || !m_nodes[proxy].IsLeaf() || m_nodes[proxy].height != 0)
+    {
+        throw std::runtime_error("Attempted to move invalid Scene Tree proxy");
+    }
+
+    // Still inside its grown box, nothing in the tree has to change
+    Node &node = m_nodes[proxy];
+    if (node.boundsMin.x <= boundsMin.x && node.boundsMin.y <= boundsMin.y && node.boundsMin.z <= boundsMin.z &&
+        boundsMax.x <= node.boundsMax.x && boundsMax.y <= node.boundsMax.y && boundsMax.z <= node.boundsMax.z)
+    {
+        return false;
+    }
+
+    RemoveLeaf(proxy);
+
+    glm::vec3 size = boundsMax - boundsMin;
+    glm::vec3 margin(FAT_MARGIN * std::max({size.x, size.y, size.z}));
+    m_nodes[proxy].boundsMin = boundsMin - margin;
+    m_nodes[proxy].boundsMax = boundsMax + margin;
+
+    InsertLeaf(proxy);
+    return true;
+}
+
+void SceneTree::QueryFrustum(const glm::vec4 planes[6], std::vector<uint32_t> &results)
+{
+    if (m_root == NULL_NODE)
+    {
+        return;
+    }
+
+    const uint32_t allPlanes = (1u << 6) - 1;
+    m_stack.clear();
+    m_stack.push_back({m_root, allPlanes});
+
+    while (!m_stack.empty())
+    {
+        int32_t index = m_stack.back().first;
+        uint32_t planeMask = m_stack.back().second;
+        m_stack.pop_back();
+
+        const Node &node = m_nodes[index];
+
+        // Test the box against the planes its parent straddles, planes it is entirely inside of don't concern its children
+        bool outside = false;
+        if (planeMask != 0)
+        {
+            glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+            glm::vec3 extent = (node.boundsMax - node.boundsMin) * 0.5f;
+            for (uint32_t i = 0; i < 6 && !outside; i++)
+            {
+                if ((planeMask & (1u << i)) == 0)
+                {
+                    continue;
+                }
+
+                const glm::vec4 &plane = planes[i];
+                float distance = center.x * plane.x + center.y * plane.y + center.z * plane.z + plane.w;
+                float radius = extent.x * std::abs(plane.x) + extent.y * std::abs(plane.y) + extent.z * std::abs(plane.z);
+                if (distance + radius < 0.0f)
+                {
+                    outside = true;
+                }
+                else if (distance - radius >= 0.0f)
+                {
+                    planeMask &= ~(1u << i);
+                }
+            }
+        }
+
+        if (outside)
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            results.push_back(node.userData);
+        }
+        else
+        {
+            m_stack.push_back({node.child1, planeMask});
+            m_stack.push_back({node.child2, planeMask});
+        }
+    }
+}
+
+size_t SceneTree::GetProxyCount() const
+{
+    return m_proxyCount;
+}
+
+int32_t SceneTree::GetHeight() const
+{
+    return m_root == NULL_NODE ? 0 : m_nodes[m_root].height;
+}
+
+SceneTree::~SceneTree()
+{
+}
+
+int32_t SceneTree::AllocateNode()
+{
+    int32_t node;
+    if (m_freeList != NULL_NODE)
+    {
+        node = m_freeList;
+        m_freeList = m_nodes[node].parent;
+    }
+    else
+    {
+        node = static_cast<int32_t>(m_nodes.size());
+        m_nodes.push_back({});
+    }
+
+    m_nodes[node] = {};
+    m_nodes[node].parent = NULL_NODE;
+    m_nodes[node].child1 = NULL_NODE;
+    m_nodes[node].child2 = NULL_NODE;
+    m_nodes[node].height = 0;
+    return node;
+}
+
+void SceneTree::FreeNode(int32_t node)
+{
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+void SceneTree::InsertLeaf(int32_t leaf)
+{
+    if (m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down to the sibling that makes the tree grow the least: a new parent costs its area, and every node above it
+    // grows by however much the leaf enlarges it
+    const glm::vec3 leafMin = m_nodes[leaf].boundsMin;
+    const glm::vec3 leafMax = m_nodes[leaf].boundsMax;
+    int32_t index = m_root;
+    while (!m_nodes[index].IsLeaf())
+    {
+        const Node &node = m_nodes[index];
+        float area = SurfaceArea(node.boundsMin, node.boundsMax);
+        float combinedArea = SurfaceArea(glm::min(node.boundsMin, leafMin), glm::max(node.boundsMax, leafMax));
+
+        // Cost of making a new parent for this node and the leaf, and the growth every level below here costs
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float childCosts[2];
+        int32_t children[2] = {node.child1, node.child2};
+        for (int i = 0; i < 2; i++)
+        {
+            const Node &child = m_nodes[children[i]];
+            float enlarged = SurfaceArea(glm::min(child.boundsMin, leafMin), glm::max(child.boundsMax, leafMax));
+            childCosts[i] = (child.IsLeaf() ? enlarged : enlarged - SurfaceArea(child.boundsMin, child.boundsMax)) + inheritanceCost;
+        }
+
+        if (cost < childCosts[0] && cost < childCosts[1])
+        {
+            break;
+        }
+
+        index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+    }
+
+    // New parent for sibling and leaf, in the sibling's place (allocating may move the nodes, so no references across it)
+    int32_t sibling = index;
+    int32_t oldParent = m_nodes[sibling].parent;
+    int32_t newParent = AllocateNode();
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].boundsMin = glm::min(m_nodes[sibling].boundsMin, leafMin);
+    m_nodes[newParent].boundsMax = glm::max(m_nodes[sibling].boundsMax, leafMax);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent != NULL_NODE)
+    {
+        if (m_nodes[oldParent].child1 == sibling)
+        {
+            m_nodes[oldParent].child1 = newParent;
+        }
+        else
+        {
+            m_nodes[oldParent].child2 = newParent;
+        }
+    }
+    else
+    {
+        m_root = newParent;
+    }
+
+    Refit(m_nodes[leaf].parent);
+}
+
+void SceneTree::RemoveLeaf(int32_t leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    // Sibling takes the place of the parent, which is freed
+    int32_t parent = m_nodes[leaf].parent;
+    int32_t grandParent = m_nodes[parent].parent;
+    int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grandParent != NULL_NODE)
+    {
+        if (m_nodes[grandParent].child1 == parent)
+        {
+            m_nodes[grandParent].child1 = sibling;
+        }
+        else
+        {
+            m_nodes[grandParent].child2 = sibling;
+        }
+        m_nodes[sibling].parent = grandParent;
+        FreeNode(parent);
+
+        Refit(grandParent);
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        FreeNode(parent);
+    }
+}
+
+int32_t SceneTree::Balance(int32_t iA)
+{
+    Node &a = m_nodes[iA];
+    if (a.IsLeaf() || a.height < 2)
+    {
+        return iA;
+    }
+
+    int32_t iB = a.child1;
+    int32_t iC = a.child2;
+    Node &b = m_nodes[iB];
+    Node &c = m_nodes[iC];
+
+    int32_t balance = c.height - b.height;
+
+    // Rotate C up
+    if (balance > 1)
+    {
+        int32_t iF = c.child1;
+        int32_t iG = c.child2;
+        Node &f = m_nodes[iF];
+        Node &g = m_nodes[iG];
+
+        // A becomes a child of C
+        c.child1 = iA;
+        c.parent = a.parent;
+        a.parent = iC;
+
+        if (c.parent != NULL_NODE)
+        {
+            if (m_nodes[c.parent].child1 == iA)
+            {
+                m_nodes[c.parent].child1 = iC;
+            }
+            else
+            {
+                m_nodes[c.parent].child2 = iC;
+            }
+        }
+        else
+        {
+            m_root = iC;
+        }
+
+        // Taller of C's children stays with C, the other moves to A
+        Node &kept = f.height > g.height ? f : g;
+        Node &moved = f.height > g.height ? g : f;
+        int32_t iKept = f.height > g.height ? iF : iG;
+        int32_t iMoved = f.height > g.height ? iG : iF;
+
+        c.child2 = iKept;
+        a.child2 = iMoved;
+        moved.parent = iA;
+
+        a.boundsMin = glm::min(b.boundsMin, moved.boundsMin);
+        a.boundsMax = glm::max(b.boundsMax, moved.boundsMax);
+        c.boundsMin = glm::min(a.boundsMin, kept.boundsMin);
+        c.boundsMax = glm::max(a.boundsMax, kept.boundsMax);
+
+        a.height = 1 + std::max(b.height, moved.height);
+        c.height = 1 + std::max(a.height, kept.height);
+
+        return iC;
+    }
+
+    // Rotate B up
+    if (balance < -1)
+    {
+        int32_t iD = b.child1;
+        int32_t iE = b.child2;
+        Node &d = m_nodes[iD];
+        Node &e = m_nodes[iE];
+
+        // A becomes a child of B
+        b.child1 = iA;
+        b.parent = a.parent;
+        a.parent = iB;
+
+        if (b.parent != NULL_NODE)
+        {
+            if (m_nodes[b.parent].child1 == iA)
+            {
+                m_nodes[b.parent].child1 = iB;
+            }
+            else
+            {
+                m_nodes[b.parent].child2 = iB;
+            }
+        }
+        else
+        {
+            m_root = iB;
+        }
+
+        // Taller of B's children stays with B, the other moves to A
+        Node &kept = d.height > e.height ? d : e;
+        Node &moved = d.height > e.height ? e : d;
+        int32_t iKept = d.height > e.height ? iD : iE;
+        int32_t iMoved = d.height > e.height ? iE : iD;
+
+        b.child2 = iKept;
+        a.child1 = iMoved;
+        moved.parent = iA;
+
+        a.boundsMin = glm::min(c.boundsMin, moved.boundsMin);
+        a.boundsMax = glm::max(c.boundsMax, moved.boundsMax);
+        b.boundsMin = glm::min(a.boundsMin, kept.boundsMin);
+        b.boundsMax = glm::max(a.boundsMax, kept.boundsMax);
+
+        a.height = 1 + std::max(c.height, moved.height);
+        b.height = 1 + std::max(a.height, kept.height);
+
+        return iB;
+    }
+
+    return iA;
+}
+
+void SceneTree::Refit(int32_t node)
+{
+    int32_t index = node;
+    while (index != NULL_NODE)
+    {
+        index = Balance(index);
+
+        Node &current = m_nodes[index];
+        const Node &child1 = m_nodes[current.child1];
+        const Node &child2 = m_nodes[current.child2];
+
+        current.height = 1 + std::max(child1.height, child2.height);
+        current.boundsMin = glm::min(child1.boundsMin, child2.boundsMin);
+        current.boundsMax = glm::max(child1.boundsMax, child2.boundsMax);
+
+        index = current.parent;
+    }
+}
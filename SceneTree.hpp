@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Dynamic bounding volume hierarchy over world space boxes, after the dynamic AABB tree of Box2D.
+// Leaves keep their box grown by a margin, so an object that moves a little leaves the tree as it is; only objects that
+// leave their grown box are removed and inserted again. Insertion picks the sibling adding the least surface area,
+// rotations keep the tree balanced. Frustum queries skip subtrees outside the frustum and take subtrees entirely inside
+// without testing them any further, so a query costs about as much as what it finds rather than the whole tree.
+class SceneTree
+{
+public:
+    static constexpr int32_t NULL_NODE = -1;
+    static constexpr float FAT_MARGIN = 0.1f; // Grown box margin on every side, relative to the largest extent of the box
+
+    SceneTree();
+
+    // Returns the proxy of the box, userData is what queries report for it
+    int32_t CreateProxy(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, uint32_t userData);
+    void DestroyProxy(int32_t proxy);
+    // Returns true if the box left its grown box and was inserted again
+    bool MoveProxy(int32_t proxy, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
+
+    // Appends userData of every proxy whose grown box is at least partly inside all six planes (normals point inwards)
+    void QueryFrustum(const glm::vec4 planes[6], std::vector<uint32_t> &results);
+
+    size_t GetProxyCount() const;
+    int32_t GetHeight() const;
+
+    ~SceneTree();
+
+private:
+    struct Node
+    {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        int32_t parent;     // Next free node while on the free list
+        int32_t child1;
+        int32_t child2;
+        int32_t height;     // Leaves are 0, free nodes -1
+        uint32_t userData;  // Leaves only
+
+        bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    std::vector<Node> m_nodes{};
+    int32_t m_root = NULL_NODE;
+    int32_t m_freeList = NULL_NODE;
+    size_t m_proxyCount = 0;
+
+    // Nodes left to visit by a query, with the planes their parent wasn't entirely inside of
+    std::vector<std::pair<int32_t, uint32_t>> m_stack{};
+
+    int32_t AllocateNode();
+    void FreeNode(int32_t node);
+
+    void InsertLeaf(int32_t leaf);
+    void RemoveLeaf(int32_t leaf);
+    // Rotates the taller child up if the children's heights differ by more than one, returns the node now in its place
+    int32_t Balance(int32_t node);
+    // Bounds and height of every node from node up to the root, balancing on the way
+    void Refit(int32_t node);
+};
@@ -1,2 +1,4 @@
 glslangValidator -V shader.vert
-glslangValidator -V shader.frag
\ No newline at end of file
+glslangValidator -V shader.frag
+glslangValidator -V shader_bindless.frag -o frag_bindless.spv
+glslangValidator -V cull.comp -o cull.spv
\ No newline at end of file
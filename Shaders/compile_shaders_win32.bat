@@ -1,2 +1,4 @@
 c:/VulkanSDK/1.2.135.0/Bin32/glslangValidator.exe -V shader.vert
 c:/VulkanSDK/1.2.135.0/Bin32/glslangValidator.exe -V shader.frag
+c:/VulkanSDK/1.2.135.0/Bin32/glslangValidator.exe -V shader_bindless.frag -o frag_bindless.spv
+c:/VulkanSDK/1.2.135.0/Bin32/glslangValidator.exe -V cull.comp -o cull.spv
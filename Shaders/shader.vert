@@ -1,7 +1,6 @@
 #version 450    // Use GLSL 4.5
 
 layout(location = 0) in vec3 pos;
-layout(location = 1) in vec3 col;
 layout(location = 2) in vec2 tex;
 
 layout(set = 0, binding = 0) uniform UBOViewProjection {
@@ -9,21 +8,63 @@ layout(set = 0, binding = 0) uniform UBOViewProjection {
     mat4 view;
 } uboViewProjection;
 
-// NOT IN USE, Left for reference
-layout(set = 0, binding = 1) uniform UBOModel {
-    mat4 model;
-} uboModel;
+// Read model transform from storage buffer (cached command buffers) instead of push constant
+layout(constant_id = 0) const bool USE_TRANSFORM_BUFFER = false;
+
+// Model transforms, then instance transforms, indexed by the draw's first instance
+layout(set = 0, binding = 1) readonly buffer ModelTransforms {
+    mat4 models[];
+} modelTransforms;
+
+// Draws were written by the cull pass (GPU-driven rendering), first instance is the index of the draw
+layout(constant_id = 1) const bool GPU_DRIVEN = false;
+
+// Draw of one mesh, same layout as in cull.comp
+struct Draw {
+    vec4 boundsCenter;
+    vec4 boundsExtent;
+    vec4 positionScale;
+    vec4 positionOffset;
+    uint modelIndex;
+    uint group;
+    uint firstCommand;
+    uint lodCount;
+    int vertexOffset;
+    uint textureIndex;
+    uint padding[2];
+    uint firstIndex[4];
+    uint indexCount[4];
+    float lodError[4];
+};
+
+layout(set = 0, binding = 2) readonly buffer Draws {
+    Draw draws[];
+} draws;
 
 layout(push_constant) uniform PushModel {
     mat4 model;
+    vec4 positionScale;     // Mesh dequantization, identity unless positions are quantized
+    vec4 positionOffset;
+    uint textureIndex;      // Bindless textures: element of the mesh's texture in the texture array
 } pushModel;
 
-layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTex;
+layout(location = 2) flat out uint fragTexIndex;
 
 void main() {
-    gl_Position = uboViewProjection.projection * uboViewProjection.view * pushModel.model * vec4(pos, 1.0);
+    mat4 model;
+    vec3 position;
+    if (GPU_DRIVEN) {
+        model = modelTransforms.models[draws.draws[gl_InstanceIndex].modelIndex];
+        position = pos * draws.draws[gl_InstanceIndex].positionScale.xyz + draws.draws[gl_InstanceIndex].positionOffset.xyz;
+    } else {
+        // Instanced draws start past the model transforms (never at 0) and always read from the storage buffer
+        model = USE_TRANSFORM_BUFFER || gl_InstanceIndex != 0 ? modelTransforms.models[gl_InstanceIndex] : pushModel.model;
+        position = pos * pushModel.positionScale.xyz + pushModel.positionOffset.xyz;
+    }
+
+    gl_Position = uboViewProjection.projection * uboViewProjection.view * model * vec4(position, 1.0);
 
-    fragColor = col;
     fragTex = tex;
+    fragTexIndex = GPU_DRIVEN ? draws.draws[gl_InstanceIndex].textureIndex : pushModel.textureIndex;
 }
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 450    // Use GLSL 4.5
+#extension GL_EXT_nonuniform_qualifier : require // Runtime sized texture array
+
+layout(location = 0) out vec4 outColor; // Final output color (must also have location)
+
+layout(location = 1) in vec2 fragTex;
+layout(location = 2) flat in uint fragTexIndex; // Same for every fragment of a draw
+
+// Every texture, indexed by texture id (elements of textures not created yet are never written)
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+void main() {
+    outColor = texture(textures[fragTexIndex], fragTex);
+}
\ No newline at end of file
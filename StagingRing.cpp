@@ -0,0 +1,146 @@
+#include <limits>
+#include <stdexcept>
+
+#include "StagingRing.hpp"
+#include "Utilities.h"
+
+StagingRing::StagingRing()
+{
+}
+
+void StagingRing::Init(DeviceMemoryAllocator *newAllocator, VkDeviceSize newSize)
+{
+    m_allocator = newAllocator;
+    m_device = newAllocator->GetDevice();
+    m_size = newSize;
+
+    // Host visible allocations are mapped by the allocator for their whole lifetime
+    CreateBuffer(m_allocator, m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &m_buffer, &m_memory);
+}
+
+bool StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment, VkFence fence, StagingRegion *region)
+{
+    if (size > m_size)
+    {
+        return false;
+    }
+
+    while (true)
+    {
+        // Align start, and skip to the beginning of the buffer if the region would run past its end
+        VkDeviceSize position = m_head % m_size;
+        VkDeviceSize start = m_head + (alignment - position % alignment) % alignment;
+        if (start % m_size + size > m_size || start % m_size < position)
+        {
+            start = m_head + (m_size - position);
+        }
+
+        if (start + size - m_tail <= m_size)
+        {
+            m_head = start + size;
+
+            // Extend the range of the batch if it reserved the previous region too
+            if (!m_inFlight.empty() && m_inFlight.back().fence == fence)
+            {
+                m_inFlight.back().end = m_head;
+            }
+            else
+            {
+                m_inFlight.push_back({fence, m_head, false});
+            }
+
+            region->buffer = m_buffer;
+            region->offset = start % m_size;
+            region->mapped = static_cast<char *>(m_memory.mapped) + region->offset;
+            return true;
+        }
+
+        // Free what is done already, otherwise wait for oldest submission
+        VkDeviceSize oldTail = m_tail;
+        Reclaim(false);
+        if (m_tail == oldTail)
+        {
+            // Oldest regions belong to a batch still being recorded (maybe this one), there is nothing to wait for
+            if (m_inFlight.empty() || !m_inFlight.front().submitted)
+            {
+                return false;
+            }
+            Reclaim(true);
+        }
+    }
+}
+
+void StagingRing::Submit(VkFence fence)
+{
+    for (InFlightRange &range : m_inFlight)
+    {
+        if (range.fence == fence)
+        {
+            range.submitted = true;
+        }
+    }
+}
+
+void StagingRing::Retire(VkFence fence)
+{
+    // Ranges ahead of it may still be in flight (other queue), so only forget the fence here
+    for (InFlightRange &range : m_inFlight)
+    {
+        if (range.fence == fence)
+        {
+            range.fence = VK_NULL_HANDLE;
+        }
+    }
+
+    Reclaim(false);
+}
+
+void StagingRing::Destroy()
+{
+    vkDestroyBuffer(m_device, m_buffer, nullptr);
+    m_buffer = VK_NULL_HANDLE;
+    m_allocator->Free(m_memory);
+
+    m_inFlight.clear();
+    m_head = m_tail = 0;
+}
+
+StagingRing::~StagingRing()
+{
+}
+
+void StagingRing::Reclaim(bool wait)
+{
+    // Ranges are freed in order, so stop at the first one still being read
+    while (!m_inFlight.empty())
+    {
+        InFlightRange &range = m_inFlight.front();
+        if (range.fence != VK_NULL_HANDLE)
+        {
+            if (!range.submitted)
+            {
+                break;
+            }
+            if (wait)
+            {
+                vkWaitForFences(m_device, 1, &range.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+                wait = false;
+            }
+            else if (vkGetFenceStatus(m_device, range.fence) != VK_SUCCESS)
+            {
+                break;
+            }
+        }
+
+        m_tail = range.end;
+        m_inFlight.pop_front();
+    }
+
+    // Ring is empty: start again from the front so large regions fit without wrapping
+    if (m_tail == m_head && m_inFlight.empty())
+    {
+        m_head = m_tail = 0;
+    }
+}
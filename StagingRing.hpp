@@ -0,0 +1,64 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <deque>
+
+#include "DeviceMemoryAllocator.hpp"
+
+// Part of the staging ring handed out for one upload
+struct StagingRegion
+{
+    VkBuffer buffer = VK_NULL_HANDLE; // Buffer to copy from
+    VkDeviceSize offset = 0;          // Offset of region in buffer (use as srcOffset/bufferOffset of copy)
+    void *mapped = nullptr;           // Host pointer to write upload data to
+};
+
+// Single persistently mapped host visible buffer every upload stages its data in.
+// Regions are handed out front to back and wrap around. Each region is tagged with the fence of the batch that reserved
+// it and reused once that fence has signalled, so several batches can be recorded at once and staging memory never grows
+// beyond the ring size.
+class StagingRing
+{
+public:
+    StagingRing();
+
+    void Init(DeviceMemoryAllocator *newAllocator, VkDeviceSize newSize);
+
+    // Region is read by the submission that will signal fence.
+    // Returns false if region can't fit (larger than ring, or space only frees up after a batch not yet submitted)
+    bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkFence fence, StagingRegion *region);
+    // Submission signalling this fence has been made, its regions can be waited on
+    void Submit(VkFence fence);
+    // Fence has signalled and is about to be destroyed
+    void Retire(VkFence fence);
+
+    void Destroy();
+
+    ~StagingRing();
+
+private:
+    // Consecutive regions of one batch, everything before end (in ring bytes written so far) is free once fence signals
+    struct InFlightRange
+    {
+        VkFence fence;  // Null once retired
+        VkDeviceSize end;
+        bool submitted; // Fence can only be waited on once its batch is submitted
+    };
+
+    DeviceMemoryAllocator *m_allocator = nullptr;
+    VkDevice m_device = nullptr;
+
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    MemoryAllocation m_memory{};
+    VkDeviceSize m_size = 0;
+
+    // Byte counters only ever grow, position in buffer is counter % m_size
+    VkDeviceSize m_head = 0; // Next byte to hand out
+    VkDeviceSize m_tail = 0; // Oldest byte still in use
+
+    std::deque<InFlightRange> m_inFlight{};
+
+    void Reclaim(bool wait);
+};
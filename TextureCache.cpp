@@ -0,0 +1,110 @@
+#include <stdexcept>
+
+#include "TextureCache.hpp"
+
+TextureCache::TextureCache()
+{
+}
+
+uint64_t TextureCache::HashContent(const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+    uint64_t hash = 14695981039346656037ull; // FNV offset basis
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull; // FNV prime
+    }
+
+    return hash;
+}
+
+int TextureCache::FindByPath(const std::string &path) const
+{
+    auto it = m_pathToTexture.find(path);
+    return it != m_pathToTexture.end() ? it->second : -1;
+}
+
+int TextureCache::FindByContent(uint64_t contentHash, int width, int height, VkFormat format, uint32_t mipLevels) const
+{
+    auto it = m_contentToTexture.find(contentHash);
+    if (it == m_contentToTexture.end())
+    {
+        return -1;
+    }
+
+    // Everything else describing the image has to match as well, cheap guard against hash collisions
+    const Entry &entry = m_entries.at(it->second);
+    bool same = entry.width == width && entry.height == height && entry.format == format && entry.mipLevels == mipLevels;
+    return same ? it->second : -1;
+}
+
+void TextureCache::Insert(int textureId, const std::string &path, uint64_t contentHash, int width, int height, VkFormat format,
+                          uint32_t mipLevels)
+{
+    m_entries[textureId] = {contentHash, width, height, format, mipLevels, 0, {path}};
+    m_pathToTexture[path] = textureId;
+    m_contentToTexture.emplace(contentHash, textureId);
+}
+
+void TextureCache::AddPath(int textureId, const std::string &path)
+{
+    m_entries.at(textureId).paths.push_back(path);
+    m_pathToTexture[path] = textureId;
+}
+
+void TextureCache::AddReference(int textureId)
+{
+    auto it = m_entries.find(textureId);
+    if (it == m_entries.end())
+    {
+        throw std::runtime_error("Attempted to reference a texture that is not cached");
+    }
+
+    it->second.referenceCount++;
+}
+
+bool TextureCache::Release(int textureId)
+{
+    auto it = m_entries.find(textureId);
+    if (it == m_entries.end() || it->second.referenceCount == 0)
+    {
+        throw std::runtime_error("Attempted to release a texture that is not referenced");
+    }
+
+    if (--it->second.referenceCount > 0)
+    {
+        return false;
+    }
+
+    // Last user gone, forget every way of finding this texture
+    for (const std::string &path : it->second.paths)
+    {
+        m_pathToTexture.erase(path);
+    }
+    // Only if the hash finds this texture, not another one that collided with it
+    auto content = m_contentToTexture.find(it->second.contentHash);
+    if (content != m_contentToTexture.end() && content->second == textureId)
+    {
+        m_contentToTexture.erase(content);
+    }
+    m_entries.erase(it);
+
+    return true;
+}
+
+uint32_t TextureCache::GetReferenceCount(int textureId) const
+{
+    auto it = m_entries.find(textureId);
+    return it != m_entries.end() ? it->second.referenceCount : 0;
+}
+
+size_t TextureCache::GetTextureCount() const
+{
+    return m_entries.size();
+}
+
+TextureCache::~TextureCache()
+{
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Keeps track of which texture ids are in use and by how many users (materials of loaded models).
+// Textures are found by resolved file path, or by a hash of their content (decoded pixels or baked blocks) when the same
+// image is stored under another name. Only bookkeeping lives here, creating and destroying the GPU resources is up to the renderer.
+class TextureCache
+{
+public:
+    TextureCache();
+
+    // FNV-1a 64 bit hash of texture content
+    static uint64_t HashContent(const void *data, size_t size);
+
+    // Return texture id, or -1 if not cached
+    int FindByPath(const std::string &path) const;
+    // Texture with the same hash is only returned if its dimensions, format and mip levels match as well
+    int FindByContent(uint64_t contentHash, int width, int height, VkFormat format, uint32_t mipLevels) const;
+
+    // New texture starts out with no references. A texture already found by the same hash keeps it (hash collision)
+    void Insert(int textureId, const std::string &path, uint64_t contentHash, int width, int height, VkFormat format, uint32_t mipLevels);
+    // Another path resolving to an already cached texture
+    void AddPath(int textureId, const std::string &path);
+
+    void AddReference(int textureId);
+    // Returns true if that was the last reference, texture is then forgotten and should be destroyed
+    bool Release(int textureId);
+
+    uint32_t GetReferenceCount(int textureId) const;
+    size_t GetTextureCount() const;
+
+    ~TextureCache();
+
+private:
+    struct Entry
+    {
+        uint64_t contentHash;
+        int width;
+        int height;
+        VkFormat format;
+        uint32_t mipLevels;
+        uint32_t referenceCount;
+        std::vector<std::string> paths; // Every path resolving to this texture
+    };
+
+    std::unordered_map<int, Entry> m_entries{};
+    std::unordered_map<std::string, int> m_pathToTexture{};
+    std::unordered_map<uint64_t, int> m_contentToTexture{};
+};
@@ -0,0 +1,112 @@
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool()
+{
+}
+
+void ThreadPool::Init(size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    m_stopping = false;
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+        m_activeTasks++;
+    }
+    m_taskAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_tasksDone.wait(lock, [this]
+                     { return m_activeTasks == 0; });
+
+    if (m_firstError)
+    {
+        std::exception_ptr error = m_firstError;
+        m_firstError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+    return m_workers.size();
+}
+
+void ThreadPool::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_taskAvailable.notify_all();
+
+    for (std::thread &worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+ThreadPool::~ThreadPool()
+{
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskAvailable.wait(lock, [this]
+                                 { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        std::exception_ptr error = nullptr;
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (error && !m_firstError)
+            {
+                m_firstError = error;
+            }
+            m_activeTasks--;
+            if (m_activeTasks == 0)
+            {
+                m_tasksDone.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+// Fixed set of worker threads running queued CPU work (asset decoding, mesh conversion).
+// Tasks must not touch Vulkan objects that need external synchronisation, GPU work stays on the calling thread.
+class ThreadPool
+{
+public:
+    ThreadPool();
+
+    // threadCount 0: one worker per hardware thread
+    void Init(size_t threadCount = 0);
+
+    void Enqueue(std::function<void()> task);
+    // Block until every queued task has finished, rethrows the first exception thrown by a task
+    void Wait();
+
+    size_t GetThreadCount() const;
+
+    void Destroy();
+
+    ~ThreadPool();
+
+private:
+    std::vector<std::thread> m_workers{};
+    std::deque<std::function<void()>> m_tasks{};
+
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailable; // Signalled when a task is queued or the pool stops
+    std::condition_variable m_tasksDone;     // Signalled when the last running task finishes
+
+    size_t m_activeTasks = 0;          // Queued or running tasks
+    std::exception_ptr m_firstError{}; // First exception thrown by a task since last Wait
+    bool m_stopping = false;
+
+    void WorkerLoop();
+};
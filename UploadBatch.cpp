@@ -0,0 +1,410 @@
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+#include "UploadBatch.hpp"
+#include "Utilities.h"
+
+UploadBatch::UploadBatch()
+{
+}
+
+UploadBatch::UploadBatch(DeviceMemoryAllocator *newAllocator, StagingRing *newStagingRing, const UploadQueue &newTransfer, const UploadQueue &newGraphics)
+    : m_allocator(newAllocator),
+      m_stagingRing(newStagingRing),
+      m_device(newAllocator->GetDevice()),
+      m_transfer(newTransfer),
+      m_graphics(newGraphics),
+      m_ownershipTransfer(newTransfer.familyIndex != newGraphics.familyIndex)
+{
+    // Start recording, every upload of the batch goes into this command buffer
+    m_commandBuffer = BeginCommandBuffer(m_device, m_transfer.commandPool);
+
+    // Staging ring regions are tagged with the fence as they are reserved, so it exists before anything is submitted
+    CreateFence();
+}
+
+void *UploadBatch::ReserveBuffer(VkBuffer dstBuffer, VkDeviceSize size, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask,
+                                 VkDeviceSize dstOffset)
+{
+    StagingRegion staging = AllocateStaging(size);
+
+    RecordCopyBuffer(m_commandBuffer, staging.buffer, dstBuffer, size, staging.offset, dstOffset);
+
+    // Barrier is recorded once for all buffers when the batch is submitted
+    VkBufferMemoryBarrier bufferBarrier = {};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;  // Copy must finish writing...
+    bufferBarrier.dstAccessMask = dstAccessMask;                 // ...before buffer is read this way
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // Queue family to transfer ownership from (set on submit)
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // Queue family to transfer ownership to (set on submit)
+    bufferBarrier.buffer = dstBuffer;                            // Buffer written by copy
+    bufferBarrier.offset = dstOffset;                            // Start of range written
+    bufferBarrier.size = size;                                   // Size of range written
+
+    m_bufferBarriers.push_back(bufferBarrier);
+    m_dstStages |= dstStageMask;
+
+    return staging.mapped;
+}
+
+void *UploadBatch::ReserveImage(VkImage dstImage, VkDeviceSize size, uint32_t width, uint32_t height)
+{
+    return ReserveImage(dstImage, size, {{0, size, width, height}});
+}
+
+void *UploadBatch::ReserveImage(VkImage dstImage, VkDeviceSize size, const std::vector<ImageLevel> &levels)
+{
+    StagingRegion staging = AllocateStaging(size);
+    uint32_t mipLevels = static_cast<uint32_t>(levels.size());
+
+    // Transition image to be DST for copy operation and copy every level
+    RecordImageLayoutTransition(m_commandBuffer, dstImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+    for (uint32_t i = 0; i < mipLevels; i++)
+    {
+        RecordCopyImageBuffer(m_commandBuffer, staging.buffer, dstImage, levels[i].width, levels[i].height,
+                              staging.offset + levels[i].offset, i);
+    }
+
+    // Transition to be readable by shaders is recorded with the buffer barriers on submit
+    AddShaderReadBarrier(dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0, mipLevels);
+
+    return staging.mapped;
+}
+
+void UploadBatch::UploadImageAndGenerateMipmaps(VkImage dstImage, const void *data, VkDeviceSize size, uint32_t width, uint32_t height,
+                                                uint32_t mipLevels)
+{
+    StagingRegion staging = AllocateStaging(size);
+    memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+    // Copy full size image into level 0, every level starts out as a transfer destination
+    RecordImageLayoutTransition(m_commandBuffer, dstImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+    RecordCopyImageBuffer(m_commandBuffer, staging.buffer, dstImage, width, height, staging.offset);
+
+    // Each level is filtered down from the one before it
+    int32_t levelWidth = static_cast<int32_t>(width);
+    int32_t levelHeight = static_cast<int32_t>(height);
+    for (uint32_t i = 1; i < mipLevels; i++)
+    {
+        // Previous level has been written (copy or blit), make it the blit source
+        VkImageMemoryBarrier sourceBarrier = {};
+        sourceBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        sourceBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        sourceBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        sourceBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        sourceBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        sourceBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        sourceBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        sourceBarrier.image = dstImage;
+        sourceBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1, 0, 1};
+
+        vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &sourceBarrier);
+
+        int32_t nextWidth = std::max(levelWidth / 2, 1);
+        int32_t nextHeight = std::max(levelHeight / 2, 1);
+
+        VkImageBlit blit = {};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, 1};
+        blit.srcOffsets[1] = {levelWidth, levelHeight, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+        blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+
+        vkCmdBlitImage(m_commandBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit, VK_FILTER_LINEAR);
+
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+
+    // Blit sources were only read, last level was written by the last blit (or the copy when there is only one level)
+    if (mipLevels > 1)
+    {
+        AddShaderReadBarrier(dstImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, 0, mipLevels - 1);
+    }
+    AddShaderReadBarrier(dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, mipLevels - 1, 1);
+}
+
+void UploadBatch::UploadBuffer(VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask,
+                               VkDeviceSize dstOffset)
+{
+    memcpy(ReserveBuffer(dstBuffer, size, dstAccessMask, dstStageMask, dstOffset), data, static_cast<size_t>(size));
+}
+
+void UploadBatch::UploadImage(VkImage dstImage, const void *data, VkDeviceSize size, uint32_t width, uint32_t height)
+{
+    memcpy(ReserveImage(dstImage, size, width, height), data, static_cast<size_t>(size));
+}
+
+void UploadBatch::UploadImage(VkImage dstImage, const void *data, const std::vector<ImageLevel> &levels)
+{
+    // Pack levels into staging, each starting on a 16 byte boundary (copy offsets must be a multiple of the texel block size)
+    std::vector<ImageLevel> stagingLevels(levels);
+    VkDeviceSize size = 0;
+    for (ImageLevel &level : stagingLevels)
+    {
+        level.offset = (size + 15) & ~static_cast<VkDeviceSize>(15);
+        size = level.offset + level.size;
+    }
+
+    char *staging = static_cast<char *>(ReserveImage(dstImage, size, stagingLevels));
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        memcpy(staging + stagingLevels[i].offset, static_cast<const char *>(data) + levels[i].offset, static_cast<size_t>(levels[i].size));
+    }
+}
+
+void UploadBatch::Submit()
+{
+    if (m_ownershipTransfer)
+    {
+        SubmitWithOwnershipTransfer();
+        return;
+    }
+
+    if (!m_bufferBarriers.empty() || !m_imageBarriers.empty())
+    {
+        vkCmdPipelineBarrier(
+            m_commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, m_dstStages,                             // Pipeline stages (match to src and dst AccessMasks)
+            0,                                                                       // Dependency flags
+            0, nullptr,                                                              // Memory barrier count & data
+            static_cast<uint32_t>(m_bufferBarriers.size()), m_bufferBarriers.data(), // Buffer memory barrier count & data
+            static_cast<uint32_t>(m_imageBarriers.size()), m_imageBarriers.data()    // Image memory barrier count & data
+        );
+    }
+
+    VkResult result = vkEndCommandBuffer(m_commandBuffer);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record upload Command Buffer");
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_commandBuffer;
+
+    // Submit without waiting, later submissions on the queue are ordered after it by the barriers above
+    result = vkQueueSubmit(m_transfer.queue, 1, &submitInfo, m_fence);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit upload Command Buffer");
+    }
+
+    m_stagingRing->Submit(m_fence);
+}
+
+bool UploadBatch::IsComplete()
+{
+    return vkGetFenceStatus(m_device, m_fence) == VK_SUCCESS;
+}
+
+void UploadBatch::Wait()
+{
+    vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+}
+
+void UploadBatch::Release()
+{
+    // Only call once the fence has signalled
+    for (StagingBuffer &staging : m_stagingBuffers)
+    {
+        vkDestroyBuffer(m_device, staging.buffer, nullptr);
+        m_allocator->Free(staging.memory);
+    }
+    m_stagingBuffers.clear();
+
+    vkFreeCommandBuffers(m_device, m_transfer.commandPool, 1, &m_commandBuffer);
+    m_commandBuffer = nullptr;
+
+    if (m_ownershipTransfer)
+    {
+        vkFreeCommandBuffers(m_device, m_graphics.commandPool, 1, &m_acquireCommandBuffer);
+        m_acquireCommandBuffer = nullptr;
+
+        vkDestroySemaphore(m_device, m_transferComplete, nullptr);
+        m_transferComplete = nullptr;
+    }
+
+    // Ring regions of this batch can be reused
+    m_stagingRing->Retire(m_fence);
+
+    vkDestroyFence(m_device, m_fence, nullptr);
+    m_fence = nullptr;
+}
+
+UploadBatch::~UploadBatch()
+{
+}
+
+void UploadBatch::AddShaderReadBarrier(VkImage image, VkImageLayout oldLayout, VkAccessFlags srcAccessMask, uint32_t baseMipLevel, uint32_t levelCount)
+{
+    VkImageMemoryBarrier imageBarrier = {};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = srcAccessMask;                           // Transfer must finish with image...
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;               // ...before shaders sample image
+    imageBarrier.oldLayout = oldLayout;                                   // Layout to transition from
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;    // Layout to transition to
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;           // Queue family to transfer ownership from (set on submit)
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;           // Queue family to transfer ownership to (set on submit)
+    imageBarrier.image = image;                                           // Image being accessed and modified as part of barrier
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; // Aspect of image being altered
+    imageBarrier.subresourceRange.baseMipLevel = baseMipLevel;            // First mip level to start alterations on
+    imageBarrier.subresourceRange.levelCount = levelCount;                // Number of mip levels to alter starting from baseMipLevel
+    imageBarrier.subresourceRange.baseArrayLayer = 0;                     // First layer to start alterations on
+    imageBarrier.subresourceRange.layerCount = 1;                         // Number of layers to alter starting from baseArrayLayer
+
+    m_imageBarriers.push_back(imageBarrier);
+    m_dstStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+}
+
+StagingRegion UploadBatch::AllocateStaging(VkDeviceSize size)
+{
+    // 16 bytes keeps buffer to image copies aligned for any texel (or compressed block) size
+    StagingRegion region = {};
+    if (m_stagingRing->Allocate(size, 16, m_fence, &region))
+    {
+        return region;
+    }
+
+    // Doesn't fit in the ring, use a temporary buffer kept until the batch completes
+    StagingBuffer staging = {};
+    CreateBuffer(m_allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &staging.buffer, &staging.memory);
+    m_stagingBuffers.push_back(staging);
+
+    // Host visible allocations are already mapped
+    region.buffer = staging.buffer;
+    region.offset = 0;
+    region.mapped = staging.memory.mapped;
+
+    return region;
+}
+
+void UploadBatch::SubmitWithOwnershipTransfer()
+{
+    // Exclusive resources written on the transfer family must be handed over to the graphics family:
+    // a release barrier on the transfer queue and a matching acquire barrier (same families and layouts) on the graphics queue
+    for (VkBufferMemoryBarrier &barrier : m_bufferBarriers)
+    {
+        barrier.srcQueueFamilyIndex = m_transfer.familyIndex;
+        barrier.dstQueueFamilyIndex = m_graphics.familyIndex;
+    }
+    for (VkImageMemoryBarrier &barrier : m_imageBarriers)
+    {
+        barrier.srcQueueFamilyIndex = m_transfer.familyIndex;
+        barrier.dstQueueFamilyIndex = m_graphics.familyIndex;
+    }
+
+    // RELEASE: destination access is ignored on the releasing queue
+    std::vector<VkBufferMemoryBarrier> releaseBufferBarriers = m_bufferBarriers;
+    std::vector<VkImageMemoryBarrier> releaseImageBarriers = m_imageBarriers;
+    for (VkBufferMemoryBarrier &barrier : releaseBufferBarriers)
+    {
+        barrier.dstAccessMask = 0;
+    }
+    for (VkImageMemoryBarrier &barrier : releaseImageBarriers)
+    {
+        barrier.dstAccessMask = 0;
+    }
+
+    vkCmdPipelineBarrier(
+        m_commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0, nullptr,
+        static_cast<uint32_t>(releaseBufferBarriers.size()), releaseBufferBarriers.data(),
+        static_cast<uint32_t>(releaseImageBarriers.size()), releaseImageBarriers.data());
+
+    VkResult result = vkEndCommandBuffer(m_commandBuffer);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record upload Command Buffer");
+    }
+
+    // ACQUIRE: source access is ignored on the acquiring queue
+    std::vector<VkBufferMemoryBarrier> acquireBufferBarriers = m_bufferBarriers;
+    std::vector<VkImageMemoryBarrier> acquireImageBarriers = m_imageBarriers;
+    for (VkBufferMemoryBarrier &barrier : acquireBufferBarriers)
+    {
+        barrier.srcAccessMask = 0;
+    }
+    for (VkImageMemoryBarrier &barrier : acquireImageBarriers)
+    {
+        barrier.srcAccessMask = 0;
+    }
+
+    VkPipelineStageFlags acquireStages = m_dstStages != 0 ? m_dstStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+    m_acquireCommandBuffer = BeginCommandBuffer(m_device, m_graphics.commandPool);
+    vkCmdPipelineBarrier(
+        m_acquireCommandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, acquireStages,
+        0,
+        0, nullptr,
+        static_cast<uint32_t>(acquireBufferBarriers.size()), acquireBufferBarriers.data(),
+        static_cast<uint32_t>(acquireImageBarriers.size()), acquireImageBarriers.data());
+
+    result = vkEndCommandBuffer(m_acquireCommandBuffer);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record upload acquire Command Buffer");
+    }
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    result = vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &m_transferComplete);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create upload semaphore");
+    }
+
+    // Copies run on the transfer queue, next to whatever the graphics queue is rendering
+    VkSubmitInfo transferSubmitInfo = {};
+    transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    transferSubmitInfo.commandBufferCount = 1;
+    transferSubmitInfo.pCommandBuffers = &m_commandBuffer;
+    transferSubmitInfo.signalSemaphoreCount = 1;
+    transferSubmitInfo.pSignalSemaphores = &m_transferComplete;
+
+    result = vkQueueSubmit(m_transfer.queue, 1, &transferSubmitInfo, VK_NULL_HANDLE);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit upload Command Buffer");
+    }
+
+    // Acquire only holds up the stages reading the resources, the fence covers both submissions
+    VkSubmitInfo acquireSubmitInfo = {};
+    acquireSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    acquireSubmitInfo.waitSemaphoreCount = 1;
+    acquireSubmitInfo.pWaitSemaphores = &m_transferComplete;
+    acquireSubmitInfo.pWaitDstStageMask = &acquireStages;
+    acquireSubmitInfo.commandBufferCount = 1;
+    acquireSubmitInfo.pCommandBuffers = &m_acquireCommandBuffer;
+
+    result = vkQueueSubmit(m_graphics.queue, 1, &acquireSubmitInfo, m_fence);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit upload acquire Command Buffer");
+    }
+
+    m_stagingRing->Submit(m_fence);
+}
+
+void UploadBatch::CreateFence()
+{
+    // Fence tells when staging memory is no longer read by the GPU
+    VkFenceCreateInfo fenceCreateInfo = {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkResult result = vkCreateFence(m_device, &fenceCreateInfo, nullptr, &m_fence);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create upload fence");
+    }
+}
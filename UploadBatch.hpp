@@ -0,0 +1,93 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+#include "DeviceMemoryAllocator.hpp"
+#include "StagingRing.hpp"
+
+// Queue (and pool to record for it) taking part in an upload
+struct UploadQueue
+{
+    VkQueue queue = nullptr;
+    VkCommandPool commandPool = nullptr;
+    uint32_t familyIndex = 0;
+};
+
+// Mip level of an uploaded image, offset is into the data (or staging memory) of the whole image
+struct ImageLevel
+{
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// Records every copy and layout transition of an import into a single command buffer.
+// Data is staged in the shared staging ring (one-off staging buffers only for data that doesn't fit),
+// the batch is submitted once with a fence and staging memory is only reused after that fence has signalled.
+// When the transfer queue belongs to another family than the graphics queue, copies run on the transfer queue
+// and ownership of every resource is released there and acquired on the graphics queue (synchronised by a semaphore).
+class UploadBatch
+{
+public:
+    UploadBatch();
+    UploadBatch(DeviceMemoryAllocator *newAllocator, StagingRing *newStagingRing, const UploadQueue &newTransfer, const UploadQueue &newGraphics);
+
+    // Record copy into device local buffer (at dstOffset) and return staging memory to write its data to before Submit
+    // dstAccessMask/dstStageMask describe how the buffer is read afterwards
+    void *ReserveBuffer(VkBuffer dstBuffer, VkDeviceSize size, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask,
+                        VkDeviceSize dstOffset = 0);
+    // Record copy into image (leaving it in SHADER_READ_ONLY_OPTIMAL layout) and return staging memory to write its data to before Submit
+    void *ReserveImage(VkImage dstImage, VkDeviceSize size, uint32_t width, uint32_t height);
+    // Same with every mip level of the image (levels[0] full size), level offsets are into the returned staging memory
+    void *ReserveImage(VkImage dstImage, VkDeviceSize size, const std::vector<ImageLevel> &levels);
+
+    // Same as above, for data that already sits in memory
+    void UploadBuffer(VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask,
+                      VkDeviceSize dstOffset = 0);
+    void UploadImage(VkImage dstImage, const void *data, VkDeviceSize size, uint32_t width, uint32_t height);
+    void UploadImage(VkImage dstImage, const void *data, const std::vector<ImageLevel> &levels);
+    // Upload full size image and fill the other mip levels by blitting each from the previous one.
+    // Needs a queue that supports blits (graphics), a format with linear filtered blits and an image with TRANSFER_SRC usage
+    void UploadImageAndGenerateMipmaps(VkImage dstImage, const void *data, VkDeviceSize size, uint32_t width, uint32_t height,
+                                       uint32_t mipLevels);
+
+    void Submit();
+    bool IsComplete();
+    void Wait();
+    void Release();
+
+    ~UploadBatch();
+
+private:
+    struct StagingBuffer
+    {
+        VkBuffer buffer;
+        MemoryAllocation memory;
+    };
+
+    DeviceMemoryAllocator *m_allocator = nullptr;
+    StagingRing *m_stagingRing = nullptr;
+    VkDevice m_device = nullptr;
+    UploadQueue m_transfer{};                // Queue the copies are recorded for
+    UploadQueue m_graphics{};                // Queue the resources are used on
+    bool m_ownershipTransfer = false;        // Transfer and graphics queue are from different families
+
+    VkCommandBuffer m_commandBuffer = nullptr;        // Copies (and release of ownership) on transfer queue
+    VkCommandBuffer m_acquireCommandBuffer = nullptr; // Acquire of ownership on graphics queue
+    VkSemaphore m_transferComplete = nullptr;         // Signalled by transfer submission, waited on by acquire submission
+    VkFence m_fence = nullptr;                        // Signalled by last submission of the batch
+
+    std::vector<StagingBuffer> m_stagingBuffers{}; // One-off staging buffers for uploads too large for the ring
+    std::vector<VkBufferMemoryBarrier> m_bufferBarriers{}; // Make uploaded buffers visible to their readers once all copies are done
+    std::vector<VkImageMemoryBarrier> m_imageBarriers{};   // Move uploaded images to SHADER_READ_ONLY once all copies are done
+    VkPipelineStageFlags m_dstStages = 0;                  // Stages reading the uploaded resources
+
+    StagingRegion AllocateStaging(VkDeviceSize size);
+    void AddShaderReadBarrier(VkImage image, VkImageLayout oldLayout, VkAccessFlags srcAccessMask, uint32_t baseMipLevel, uint32_t levelCount);
+    void SubmitWithOwnershipTransfer();
+    void CreateFence();
+};
@@ -7,8 +7,12 @@
 
 #include <glm/glm.hpp>
 
+#include "DeviceMemoryAllocator.hpp"
+
 constexpr int MAX_FRAME_DRAWS = 2;
-constexpr int MAX_OBJECTS = 20;
+constexpr int MAX_MODELS = 1024;    // Model transforms held by the transform storage buffer
+constexpr int MAX_INSTANCES = 8192; // Instance transforms held by the transform storage buffer, after the model transforms
+constexpr uint32_t MAX_BINDLESS_TEXTURES = 4096; // Size of the bindless texture array, lowered to the device limits
 
 const std::vector<const char *> gDeviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -21,11 +25,53 @@ struct Vertex
     glm::vec2 tex; // Texture Coords (u, v)
 };
 
+// Layouts vertices are stored in on the GPU, chosen when a model is imported (color is always white, so compact layouts drop it)
+enum class VertexFormat : uint32_t
+{
+    Full,      // Vertex, 32 bytes
+    Compact,   // CompactVertex, 16 bytes
+    Quantized, // QuantizedVertex, 12 bytes
+};
+constexpr size_t VERTEX_FORMAT_COUNT = 3;
+
+struct CompactVertex
+{
+    glm::vec3 pos; // Vertex Position (x, y, z)
+    uint32_t tex;  // Texture Coords (u, v) as half floats
+};
+
+struct QuantizedVertex
+{
+    int16_t pos[4]; // Vertex Position (x, y, z) as snorm16 across the mesh bounds, w is padding
+    uint32_t tex;   // Texture Coords (u, v) as half floats
+};
+
+// Pushed per mesh, vertex shader computes position = pos * scale + offset (identity unless positions are quantized)
+struct MeshDequantization
+{
+    glm::vec4 positionScale = glm::vec4(1.0f);
+    glm::vec4 positionOffset = glm::vec4(0.0f);
+};
+
+static uint32_t GetVertexSize(VertexFormat format)
+{
+    switch (format)
+    {
+    case VertexFormat::Compact:
+        return sizeof(CompactVertex);
+    case VertexFormat::Quantized:
+        return sizeof(QuantizedVertex);
+    default:
+        return sizeof(Vertex);
+    }
+}
+
 // Indices (locations) of Queue Families (if they exist at all)
 struct QueueFamilyIndices
 {
     int graphicsFamily = -1;     // Locaiton of Graphics Queue Family
     int presentationFamily = -1; // Location of Presentation Queue Family
+    int transferFamily = -1;     // Location of dedicated Transfer Queue Family (optional, uploads use graphics queue without it)
 
     // Check if Queue families are valid
     bool IsValid()
@@ -76,30 +122,11 @@ static std::vector<char> ReadFile(const std::string &fileName)
     return fileBuffer;
 }
 
-static uint32_t FindMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags properties)
+static void CreateBuffer(DeviceMemoryAllocator *allocator, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsageFlags,
+                         VkMemoryPropertyFlags bufferProperties, VkBuffer *buffer, MemoryAllocation *bufferMemory)
 {
-    // Get propeties of physical device memory
-    VkPhysicalDeviceMemoryProperties memProperties = {};
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-    {
-        // Index of memory type must match corresponding bit in allowedTypes
-        // AND
-        // Desired property bit flags are part of memory type's property
-        if ((allowedTypes & (1 << i)) && ((memProperties.memoryTypes[i].propertyFlags & properties) == properties))
-        {
-            // This memory type is valid, so return it's value
-            return i;
-        }
-    }
-
-    throw std::runtime_error("Failed to find memory type index");
-}
+    VkDevice device = allocator->GetDevice();
 
-static void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsageFlags,
-                         VkMemoryPropertyFlags bufferProperties, VkBuffer *buffer, VkDeviceMemory *bufferMemory)
-{
     // CREATE VERTEX BUFFER
     // Information to create a buffer
     VkBufferCreateInfo bufferInfo = {};
@@ -119,23 +146,13 @@ static void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDev
     vkGetBufferMemoryRequirements(device, *buffer, &memRequirements);
 
     // ALLOCATE MEMORY TO BUFFER
-    VkMemoryAllocateInfo memAllocInfo = {};
-    memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memAllocInfo.allocationSize = memRequirements.size;
-    memAllocInfo.memoryTypeIndex = FindMemoryTypeIndex(physicalDevice,
-                                                       memRequirements.memoryTypeBits, // Index of memory type on Physical Device that has required bit flags
-                                                       bufferProperties);              // VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT    : CPU can interact with memory
-                                                                                       // VK_MEMORY_PROPERTY_HOST_COHERENT_BIT   : Allows placement of data straight into buffer after mapping (otherwise would have to specify manually)
-
-    // Allocate memory to VkDeviceMemory
-    result = vkAllocateMemory(device, &memAllocInfo, nullptr, bufferMemory);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to allocate device memory");
-    }
+    // Sub-allocate from a pooled block of a memory type that has required bit flags
+    // VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT    : CPU can interact with memory (allocation comes back already mapped)
+    // VK_MEMORY_PROPERTY_HOST_COHERENT_BIT   : Allows placement of data straight into buffer after mapping (otherwise would have to specify manually)
+    *bufferMemory = allocator->Allocate(memRequirements, bufferProperties, true);
 
     // Allocate memory to given vertex buffer
-    vkBindBufferMemory(device, *buffer, *bufferMemory, 0);
+    vkBindBufferMemory(device, *buffer, bufferMemory->memory, bufferMemory->offset);
 }
 
 static VkCommandBuffer BeginCommandBuffer(VkDevice device, VkCommandPool commandPool)
@@ -182,54 +199,65 @@ static void EndAndSubmitCommandBuffer(VkDevice device, VkCommandPool commandPool
     vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
-static void CopyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
-                       VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize)
+static void RecordCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize,
+                             VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0)
 {
-    // Create buffer
-    VkCommandBuffer transferCommandBuffer = BeginCommandBuffer(device, transferCommandPool);
-
     // Region of data to copy from and to
     VkBufferCopy bufferCopyRegion = {};
-    bufferCopyRegion.srcOffset = 0;
-    bufferCopyRegion.dstOffset = 0;
+    bufferCopyRegion.srcOffset = srcOffset;
+    bufferCopyRegion.dstOffset = dstOffset;
     bufferCopyRegion.size = bufferSize;
 
     // Command to copy src buffer to dst buffer
-    vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, 1, &bufferCopyRegion);
-
-    // End and submit the buffer
-    EndAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, transferCommandBuffer);
+    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &bufferCopyRegion);
 }
 
-static void CopyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
-                            VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height)
+static void CopyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
+                       VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize)
 {
     // Create buffer
     VkCommandBuffer transferCommandBuffer = BeginCommandBuffer(device, transferCommandPool);
 
+    RecordCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, bufferSize);
+
+    // End and submit the buffer
+    EndAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, transferCommandBuffer);
+}
+
+static void RecordCopyImageBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height,
+                                  VkDeviceSize srcOffset = 0, uint32_t mipLevel = 0)
+{
     VkBufferImageCopy imageRegion = {};
-    imageRegion.bufferOffset = 0;                                        // Offset into data
+    imageRegion.bufferOffset = srcOffset;                                // Offset into data
     imageRegion.bufferRowLength = 0;                                     // Row length of data to calculate data spacing
     imageRegion.bufferImageHeight = 0;                                   // Image height to calculate data spacing
     imageRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; // Which aspect of image to copy
-    imageRegion.imageSubresource.mipLevel = 0;                           // Mipmap level to copy
+    imageRegion.imageSubresource.mipLevel = mipLevel;                    // Mipmap level to copy
     imageRegion.imageSubresource.baseArrayLayer = 0;                     // Starting array layer(if any)
     imageRegion.imageSubresource.layerCount = 1;                         // No of layers to copy starting at baseArrayLayer
     imageRegion.imageOffset = {0, 0, 0};                                 // Offset into image (as opposed to raw data in buffer)
     imageRegion.imageExtent = {width, height, 1};                        // Size of region to copy as (x, y, z) values
 
     // Copy buffer to given image
-    vkCmdCopyBufferToImage(transferCommandBuffer, srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageRegion);
+    vkCmdCopyBufferToImage(commandBuffer, srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageRegion);
+}
+
+static void CopyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
+                            VkBuffer srcBuffer, VkImage dstImage, uint32_t width, uint32_t height,
+                            VkDeviceSize srcOffset = 0, uint32_t mipLevel = 0)
+{
+    // Create buffer
+    VkCommandBuffer transferCommandBuffer = BeginCommandBuffer(device, transferCommandPool);
+
+    RecordCopyImageBuffer(transferCommandBuffer, srcBuffer, dstImage, width, height, srcOffset, mipLevel);
 
     // End and submit the buffer
     EndAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, transferCommandBuffer);
 }
 
-static void TransitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout)
+static void RecordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout,
+                                        uint32_t mipLevels = 1)
 {
-    // Create buffer
-    VkCommandBuffer commandBuffer = BeginCommandBuffer(device, commandPool);
-
     VkImageMemoryBarrier imageMemoryBarrier = {};
     imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     imageMemoryBarrier.oldLayout = currentLayout;                               // Layout to transition from
@@ -239,7 +267,7 @@ static void TransitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool
     imageMemoryBarrier.image = image;                                           // Image being accessed and modified as part of barrier
     imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; // Aspect of image being altered
     imageMemoryBarrier.subresourceRange.baseMipLevel = 0;                       // First mip level to start alteration on
-    imageMemoryBarrier.subresourceRange.levelCount = 1;                         // Number of mip levels to alter starting from baseMipLevel
+    imageMemoryBarrier.subresourceRange.levelCount = mipLevels;                 // Number of mip levels to alter starting from baseMipLevel
     imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;                     // First layer to start alterations on
     imageMemoryBarrier.subresourceRange.layerCount = 1;                         // Number of layer to alter starting from baseArrayLayer
 
@@ -278,6 +306,15 @@ static void TransitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool
         0, nullptr,            // Buffer memory barrier count & data
         1, &imageMemoryBarrier // Image memory barrier count & data
     );
+}
+
+static void TransitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout,
+                                  uint32_t mipLevels = 1)
+{
+    // Create buffer
+    VkCommandBuffer commandBuffer = BeginCommandBuffer(device, commandPool);
+
+    RecordImageLayoutTransition(commandBuffer, image, currentLayout, newLayout, mipLevels);
 
     // End and submit the buffer
     EndAndSubmitCommandBuffer(device, commandPool, queue, commandBuffer);
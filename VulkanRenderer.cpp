@@ -1,7 +1,33 @@
 #include <cstring>
 #include <array>
+#include <chrono>
+#include <filesystem>
 
 #include "VulkanRenderer.h"
+#include "Ktx2File.hpp"
+#include "BlockCompression.hpp"
+
+// Milliseconds elapsed since given time point
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Release CPU copy of a texture's data (decoded or baked)
+static void FreeTextureData(TextureData &texture)
+{
+    stbi_image_free(texture.pixels);
+    texture.pixels = nullptr;
+
+    texture.levelData.clear();
+    texture.levelData.shrink_to_fit();
+}
+
+// Location of a texture file named by a material (also the key it is cached under)
+static std::string TexturePath(const std::string &fileName)
+{
+    return "Textures/" + fileName;
+}
 
 VulkanRenderer::VulkanRenderer()
 {
@@ -11,31 +37,73 @@ VulkanRenderer::~VulkanRenderer()
 {
 }
 
-int VulkanRenderer::Init(GLFWwindow *newWindow)
+int VulkanRenderer::Init(GLFWwindow *newWindow, const RendererSettings &settings)
 {
     m_window = newWindow;
+    m_headless = false;
+    m_settings = settings;
+
+    return InitRenderer();
+}
+
+int VulkanRenderer::InitHeadless(uint32_t width, uint32_t height, const RendererSettings &settings)
+{
+    // No window, surface or swapchain: frames are rendered into offscreen images of the given size
+    m_window = nullptr;
+    m_headless = true;
+    m_settings = settings;
+    m_swapChainExtent = {width, height};
+
+    return InitRenderer();
+}
 
+int VulkanRenderer::InitRenderer()
+{
     try
     {
         CreateInstance();
         CreateDebugCallback();
-        CreateSurface();
+        if (!m_headless)
+        {
+            CreateSurface();
+        }
         GetPhysicalDevice();
         CreateLogicalDevice();
-        CreateSwapChain();
+        m_memoryAllocator.Init(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice);
+        m_stagingRing.Init(&m_memoryAllocator, m_settings.stagingRingSize);
+        m_threadPool.Init(m_settings.importThreads);
+        if (m_gpuDriven)
+        {
+            // What a GPU-driven frame draws only changes with the models, so it is recorded once like cached command
+            // buffers (transforms are read from the storage buffer). Every mesh goes into the geometry pool
+            m_settings.cacheCommandBuffers = true;
+            m_geometryPool.Init(&m_memoryAllocator, GetVertexSize(m_settings.vertexFormat), m_settings.geometryPoolSize);
+        }
+        if (m_headless)
+        {
+            CreateOffscreenTargets();
+        }
+        else
+        {
+            CreateSwapChain();
+        }
         CreateRenderPass();
         CreateDescriptorSetLayout();
         CreatePushConstantRange();
         CreateGraphicsPipeline();
+        CreateCullPipeline();
         CreateDepthBufferImage();
         CreateFrameBuffers();
         CreateCommandPool();
         CreateCommandBuffers();
         CreateTextureSampler();
-        // AllocateDynamicBufferTransferSpace();
         CreateUniformBuffers();
         CreateDescriptorPool();
         CreateDescriptorSets();
+        for (size_t i = 0; i < m_swapChainImages.size(); i++)
+        {
+            CreateDrawBuffers(i, MAX_MODELS, 64); // Grown by UpdateDraws once the meshes or textures don't fit
+        }
         CreateSynchronization();
 
         {
@@ -43,8 +111,10 @@ int VulkanRenderer::Init(GLFWwindow *newWindow)
             m_uboViewProjection.view = glm::lookAt(glm::vec3(10.f, 0.0f, 20.0f), glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(0.0f, 1.0f, 0.0f));
             m_uboViewProjection.projection[1][1] *= -1; // Vulkan Considers Y-axis negative to
 
-            // Create default no texture
-            CreateTexture("plain.jpg");
+            // Create default no texture (reference is held until clean up)
+            UploadBatch upload = CreateUploadBatch();
+            AcquireTexture("plain.jpg", &upload);
+            SubmitUpload(upload);
         }
     }
     catch (std::runtime_error &e)
@@ -58,39 +128,106 @@ int VulkanRenderer::Init(GLFWwindow *newWindow)
 
 void VulkanRenderer::Draw()
 {
+    m_frameTimings = {};
+    auto stageStart = std::chrono::steady_clock::now();
+
+    // Hand back staging memory of uploads the GPU has finished with
+    ReleaseCompletedUploads();
+
     // -- GET NEXT IMAGE --
     // Wait for given fence to signal (open) from last draw before continuing
     vkWaitForFences(m_mainDevice.logicalDevice, 1, &m_drawFences[m_currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
     // Manually reset (close) fences
     vkResetFences(m_mainDevice.logicalDevice, 1, &m_drawFences[m_currentFrame]);
+    m_frameTimings.fenceWait = ElapsedMs(stageStart);
 
     // Get index of next image to be drawn to, and signal semaphore when ready to be drawn to
     uint32_t imageIndex;
-    vkAcquireNextImageKHR(m_mainDevice.logicalDevice, m_swapchain, std::numeric_limits<uint64_t>::max(), m_imageAvailable[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
+    if (m_headless)
+    {
+        // One offscreen target per frame in flight, so the fence above already guarantees it is free
+        imageIndex = static_cast<uint32_t>(m_currentFrame);
+    }
+    else
+    {
+        stageStart = std::chrono::steady_clock::now();
+        vkAcquireNextImageKHR(m_mainDevice.logicalDevice, m_swapchain, std::numeric_limits<uint64_t>::max(), m_imageAvailable[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
+        m_frameTimings.acquire = ElapsedMs(stageStart);
+    }
+
+    // Image may still be in use by an earlier frame (more images than frames in flight), wait until it is free
+    if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE && m_imagesInFlight[imageIndex] != m_drawFences[m_currentFrame])
+    {
+        stageStart = std::chrono::steady_clock::now();
+        vkWaitForFences(m_mainDevice.logicalDevice, 1, &m_imagesInFlight[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+        m_frameTimings.fenceWait += ElapsedMs(stageStart);
+    }
+    m_imagesInFlight[imageIndex] = m_drawFences[m_currentFrame];
+
+    // GPU-driven rendering culls and selects LODs in the cull pass, the draws it reads must be up to date before
+    // the frame's cull data (holding their count) is written. Otherwise culling comes first as well, it decides
+    // which instance transforms the frame's data holds
+    if (m_gpuDriven)
+    {
+        stageStart = std::chrono::steady_clock::now();
+        UpdateDraws(imageIndex);
+        m_frameTimings.cullMeshes = ElapsedMs(stageStart);
+    }
+    else
+    {
+        stageStart = std::chrono::steady_clock::now();
+        CullMeshes();
+        m_frameTimings.cullMeshes = ElapsedMs(stageStart);
+
+        stageStart = std::chrono::steady_clock::now();
+        SelectLods();
+        m_frameTimings.selectLods = ElapsedMs(stageStart);
+    }
 
-    RecordCommands(imageIndex);
+    // Fill this frame's transient data before recording, recording needs the dynamic offsets it ended up at
+    stageStart = std::chrono::steady_clock::now();
     UpdateUniformBuffers(imageIndex);
+    m_frameTimings.updateUniformBuffers = ElapsedMs(stageStart);
+
+    // Cached command buffers are only re-recorded when what they draw has changed
+    if (!m_settings.cacheCommandBuffers || m_commandBufferDirty[imageIndex])
+    {
+        stageStart = std::chrono::steady_clock::now();
+        RecordCommands(imageIndex);
+        m_frameTimings.recordCommands = ElapsedMs(stageStart);
+
+        m_commandBufferDirty[imageIndex] = false;
+    }
 
     // -- SUBMIT COMMAND BUFFER TO RENDER
     // Queue submission information
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;                              // Number of semaphores to wait on
+    submitInfo.waitSemaphoreCount = m_headless ? 0 : 1;             // Number of semaphores to wait on (nothing to acquire when headless)
     submitInfo.pWaitSemaphores = &m_imageAvailable[m_currentFrame]; // List of semaphores to wait on
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
     submitInfo.pWaitDstStageMask = waitStages;                        // Stages to check semaphores at
     submitInfo.commandBufferCount = 1;                                // Number of command buffers to submit
     submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];       // Command buffer to submit
-    submitInfo.signalSemaphoreCount = 1;                              // Number of semaphores to signal
+    submitInfo.signalSemaphoreCount = m_headless ? 0 : 1;             // Number of semaphores to signal (nothing to present when headless)
     submitInfo.pSignalSemaphores = &m_renderFinished[m_currentFrame]; // Semaphores to signal when command buffer finishes
 
     // Submit command buffer to queue
+    stageStart = std::chrono::steady_clock::now();
     VkResult result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_drawFences[m_currentFrame]);
+    m_frameTimings.queueSubmit = ElapsedMs(stageStart);
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to submit Command Buffer to Queue");
     }
 
+    if (m_headless)
+    {
+        // Rendered image stays in its offscreen target, nothing to present
+        m_currentFrame = (m_currentFrame + 1) % MAX_FRAME_DRAWS;
+        return;
+    }
+
     // -- PRESENT RENDERED IMAGE TO SCREEN --
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -101,7 +238,9 @@ void VulkanRenderer::Draw()
     presentInfo.pImageIndices = &imageIndex;                         // Index of images in Swapchains to present
 
     // Present image
+    stageStart = std::chrono::steady_clock::now();
     result = vkQueuePresentKHR(m_presentationQueue, &presentInfo);
+    m_frameTimings.present = ElapsedMs(stageStart);
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to present image");
@@ -111,19 +250,76 @@ void VulkanRenderer::Draw()
     m_currentFrame = (m_currentFrame + 1) % MAX_FRAME_DRAWS;
 }
 
+const FrameTimings &VulkanRenderer::GetFrameTimings() const
+{
+    return m_frameTimings;
+}
+
+const ImportStatistics &VulkanRenderer::GetImportStatistics() const
+{
+    return m_importStatistics;
+}
+
+const CullStatistics &VulkanRenderer::GetCullStatistics() const
+{
+    return m_cullStatistics;
+}
+
+const BindStatistics &VulkanRenderer::GetBindStatistics() const
+{
+    return m_bindStatistics;
+}
+
+MemoryStatistics VulkanRenderer::GetMemoryStatistics() const
+{
+    return m_memoryAllocator.GetStatistics();
+}
+
 void VulkanRenderer::CleanUP()
 {
     // Wait until no actions being run on device before destoying
     vkDeviceWaitIdle(m_mainDevice.logicalDevice);
 
-    // free(m_modelTransferSpace);
+    // Device is idle, every upload has completed
+    for (auto &upload : m_pendingUploads)
+    {
+        upload.Release();
+    }
+    m_pendingUploads.clear();
+    m_stagingRing.Destroy();
+    m_threadPool.Destroy();
 
     for (auto &meshModel : m_meshModels)
     {
         meshModel.DestroyModel();
     }
+    m_geometryPool.Destroy();
+    for (size_t i = 0; i < m_drawBuffers.size(); i++)
+    {
+        DestroyDrawBuffers(i);
+    }
 
-    vkDestroyDescriptorPool(m_mainDevice.logicalDevice, m_samplerDescriptorPool, nullptr);
+    if (m_gpuDriven)
+    {
+        vkDestroyDescriptorPool(m_mainDevice.logicalDevice, m_cullDescriptorPool, nullptr);
+        m_cullDescriptorPool = nullptr;
+
+        vkDestroyPipeline(m_mainDevice.logicalDevice, m_cullPipeline, nullptr);
+        m_cullPipeline = nullptr;
+
+        vkDestroyPipelineLayout(m_mainDevice.logicalDevice, m_cullPipelineLayout, nullptr);
+        m_cullPipelineLayout = nullptr;
+
+        vkDestroyDescriptorSetLayout(m_mainDevice.logicalDevice, m_cullSetLayout, nullptr);
+        m_cullSetLayout = nullptr;
+    }
+
+    m_samplerDescriptorAllocator.Destroy();
+    if (m_bindless)
+    {
+        vkDestroyDescriptorPool(m_mainDevice.logicalDevice, m_bindlessDescriptorPool, nullptr);
+        m_bindlessDescriptorPool = nullptr;
+    }
     vkDestroyDescriptorSetLayout(m_mainDevice.logicalDevice, m_samplerSetLayout, nullptr);
 
     vkDestroySampler(m_mainDevice.logicalDevice, m_textureSampler, nullptr);
@@ -137,16 +333,14 @@ void VulkanRenderer::CleanUP()
         vkDestroyImage(m_mainDevice.logicalDevice, m_textureImages[i], nullptr);
         m_textureImages[i] = nullptr;
 
-        vkFreeMemory(m_mainDevice.logicalDevice, m_textureImageMemorys[i], nullptr);
-        m_textureImageMemorys[i] = nullptr;
+        m_memoryAllocator.Free(m_textureImageMemorys[i]);
     }
 
     vkDestroyImageView(m_mainDevice.logicalDevice, m_depthBufferImageView, nullptr);
     m_depthBufferImageView = nullptr;
     vkDestroyImage(m_mainDevice.logicalDevice, m_depthBufferImage, nullptr);
     m_depthBufferImage = nullptr;
-    vkFreeMemory(m_mainDevice.logicalDevice, m_depthBufferImageMemory, nullptr);
-    m_depthBufferImageMemory = nullptr;
+    m_memoryAllocator.Free(m_depthBufferImageMemory);
 
     vkDestroyDescriptorPool(m_mainDevice.logicalDevice, m_descriptorPool, nullptr);
     m_descriptorPool = nullptr;
@@ -154,19 +348,9 @@ void VulkanRenderer::CleanUP()
     vkDestroyDescriptorSetLayout(m_mainDevice.logicalDevice, m_descriptorSetLayout, nullptr);
     m_descriptorSetLayout = nullptr;
 
-    for (size_t i = 0; i < m_swapChainImages.size(); i++)
+    for (auto &frameAllocator : m_frameAllocators)
     {
-        vkDestroyBuffer(m_mainDevice.logicalDevice, m_vpUniformBuffer[i], nullptr);
-        m_vpUniformBuffer[i] = nullptr;
-
-        vkFreeMemory(m_mainDevice.logicalDevice, m_vpUniformBufferMemory[i], nullptr);
-        m_vpUniformBufferMemory[i] = nullptr;
-
-        // vkDestroyBuffer(m_mainDevice.logicalDevice, m_modelDynUniformBuffer[i], nullptr);
-        // m_modelDynUniformBuffer[i] = nullptr;
-
-        // vkFreeMemory(m_mainDevice.logicalDevice, m_modelDynUniformBufferMemory[i], nullptr);
-        // m_modelDynUniformBufferMemory[i] = nullptr;
+        frameAllocator.Destroy();
     }
 
     for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
@@ -184,14 +368,23 @@ void VulkanRenderer::CleanUP()
     vkDestroyCommandPool(m_mainDevice.logicalDevice, m_graphicsCommandPool, nullptr);
     m_graphicsCommandPool = nullptr;
 
+    if (m_transferCommandPool != nullptr)
+    {
+        vkDestroyCommandPool(m_mainDevice.logicalDevice, m_transferCommandPool, nullptr);
+        m_transferCommandPool = nullptr;
+    }
+
     for (auto &frameBuffer : m_swapChainFrameBuffers)
     {
         vkDestroyFramebuffer(m_mainDevice.logicalDevice, frameBuffer, nullptr);
         frameBuffer = nullptr;
     }
 
-    vkDestroyPipeline(m_mainDevice.logicalDevice, m_graphicsPipeline, nullptr);
-    m_graphicsPipeline = nullptr;
+    for (VkPipeline &graphicsPipeline : m_graphicsPipelines)
+    {
+        vkDestroyPipeline(m_mainDevice.logicalDevice, graphicsPipeline, nullptr);
+        graphicsPipeline = nullptr;
+    }
 
     vkDestroyPipelineLayout(m_mainDevice.logicalDevice, m_pipelineLayout, nullptr);
     m_pipelineLayout = nullptr;
@@ -205,11 +398,25 @@ void VulkanRenderer::CleanUP()
         image.imageView = 0;
     }
 
-    vkDestroySwapchainKHR(m_mainDevice.logicalDevice, m_swapchain, nullptr);
-    m_swapchain = 0;
+    if (m_headless)
+    {
+        // Offscreen targets are owned by us, not by a swapchain
+        for (size_t i = 0; i < m_swapChainImages.size(); i++)
+        {
+            vkDestroyImage(m_mainDevice.logicalDevice, m_swapChainImages[i].image, nullptr);
+            m_swapChainImages[i].image = nullptr;
+
+            m_memoryAllocator.Free(m_offscreenImageMemory[i]);
+        }
+    }
+    else
+    {
+        vkDestroySwapchainKHR(m_mainDevice.logicalDevice, m_swapchain, nullptr);
+        m_swapchain = 0;
 
-    vkDestroySurfaceKHR(m_vkInstance, m_surface, nullptr);
-    m_surface = 0;
+        vkDestroySurfaceKHR(m_vkInstance, m_surface, nullptr);
+        m_surface = 0;
+    }
 
     if (gEnableValidationLayers)
     {
@@ -219,6 +426,9 @@ void VulkanRenderer::CleanUP()
         m_callback = 0;
     }
 
+    // Release pooled memory blocks, every resource using them is destroyed by now
+    m_memoryAllocator.Destroy();
+
     vkDestroyDevice(m_mainDevice.logicalDevice, nullptr);
     m_mainDevice.logicalDevice = nullptr;
 
@@ -252,11 +462,14 @@ void VulkanRenderer::CreateInstance()
     // Create list to hold instance extensions
     std::vector<const char *> instanceExtensions = std::vector<const char *>();
 
-    uint32_t glfwExtensionCount = 0; // GLFW may require multiple extensions
-    const char **glfwExtensions;     // Extensions passed as array of cstrings, so need ptr to ptr
+    uint32_t glfwExtensionCount = 0;       // GLFW may require multiple extensions
+    const char **glfwExtensions = nullptr; // Extensions passed as array of cstrings, so need ptr to ptr
 
-    // Get GLFW extensions
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    // Get GLFW extensions (surface extensions are not needed when rendering headless)
+    if (!m_headless)
+    {
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    }
 
     // Add GLFW extensions to list of extensions
     for (size_t i = 0; i < glfwExtensionCount; i++)
@@ -270,6 +483,25 @@ void VulkanRenderer::CreateInstance()
         instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    // Descriptor indexing features can only be queried through VK_KHR_get_physical_device_properties2 (core since Vulkan 1.1)
+    m_physicalDeviceProperties2 = false;
+    if (m_settings.bindlessTextures)
+    {
+        uint32_t extensionsCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionsCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensions.data());
+        for (const auto &extension : extensions)
+        {
+            if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+            {
+                instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+                m_physicalDeviceProperties2 = true;
+                break;
+            }
+        }
+    }
+
     // Checking if requested extensions are supported
     if (!CheckInstanceExtensionsSupport(instanceExtensions))
     {
@@ -328,6 +560,13 @@ void VulkanRenderer::CreateLogicalDevice()
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     // Set for Family Indices
     std::set<int> queueFamilyIndices = {m_indices.graphicsFamily, m_indices.presentationFamily};
+    if (m_indices.transferFamily >= 0)
+    {
+        queueFamilyIndices.insert(m_indices.transferFamily);
+    }
+
+    // Must outlive the create infos pointing at it
+    float priority = 1.0f;
 
     for (const int queFamilyIndex : queueFamilyIndices)
     {
@@ -336,7 +575,6 @@ void VulkanRenderer::CreateLogicalDevice()
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queFamilyIndex; // The index of the family to create a queue from
         queueCreateInfo.queueCount = 1;                    // No of queues to create
-        float priority = 1.0f;
         queueCreateInfo.pQueuePriorities = &priority; // Vulkan needs to know how to handle multiple queues, so declare priority (1 - highest)
 
         queueCreateInfos.push_back(queueCreateInfo);
@@ -347,15 +585,51 @@ void VulkanRenderer::CreateLogicalDevice()
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());   // Number of Queue Create Infos
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();                             // List of queue create infos so device can create required
-    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(gDeviceExtensions.size()); // Number of Logical Device extensions
-    deviceCreateInfo.ppEnabledExtensionNames = gDeviceExtensions.data();                      // List of enabled logical device extensions
+
+    // No swapchain when headless, draw counts of the cull pass when the device has the extension
+    std::vector<const char *> deviceExtensions;
+    if (!m_headless)
+    {
+        deviceExtensions = gDeviceExtensions;
+    }
+    if (m_drawIndirectCount)
+    {
+        deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+    if (m_descriptorUpdateTemplates)
+    {
+        deviceExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    }
+    if (m_bindless)
+    {
+        deviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    }
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()); // Number of Logical Device extensions
+    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();                      // List of enabled logical device extensions
 
     // Physical Device Features the logical device will be using
     VkPhysicalDeviceFeatures deviceFeatures = {};
-    deviceFeatures.samplerAnisotropy = VK_TRUE; // Enabling Anisotropy
+    deviceFeatures.samplerAnisotropy = VK_TRUE;                                              // Enabling Anisotropy
+    deviceFeatures.textureCompressionBC = m_textureCompressionBC ? VK_TRUE : VK_FALSE;       // Sample baked BC1/BC3/BC7 textures directly
+    deviceFeatures.multiDrawIndirect = m_gpuDriven ? VK_TRUE : VK_FALSE;                     // A group of draws with one indirect command each
+    deviceFeatures.drawIndirectFirstInstance = m_gpuDriven ? VK_TRUE : VK_FALSE;             // First instance of an indirect draw selects its GpuDraw
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = m_bindless ? VK_TRUE : VK_FALSE; // Bindless textures index the texture array per draw
 
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures; // Physical Device features logical device will use
 
+    // Bindless textures: a runtime sized sampler array, not every element written, new ones written while frames are in flight
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (m_bindless)
+    {
+        indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        deviceCreateInfo.pNext = &indexingFeatures;
+    }
+
     VkResult result = vkCreateDevice(m_mainDevice.physicalDevice, &deviceCreateInfo, nullptr, &m_mainDevice.logicalDevice);
     if (result != VK_SUCCESS)
     {
@@ -367,6 +641,33 @@ void VulkanRenderer::CreateLogicalDevice()
     // From given logical device, of given Queue Family, of given Queue Index (0 since only one queue), place reference in given VkQueue
     vkGetDeviceQueue(m_mainDevice.logicalDevice, m_indices.graphicsFamily, 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_mainDevice.logicalDevice, m_indices.presentationFamily, 0, &m_presentationQueue);
+    if (m_indices.transferFamily >= 0)
+    {
+        vkGetDeviceQueue(m_mainDevice.logicalDevice, m_indices.transferFamily, 0, &m_transferQueue);
+    }
+
+    if (m_drawIndirectCount)
+    {
+        m_cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_mainDevice.logicalDevice,
+                                                                                                  "vkCmdDrawIndexedIndirectCountKHR");
+        m_drawIndirectCount = m_cmdDrawIndexedIndirectCount != nullptr;
+    }
+
+    if (m_descriptorUpdateTemplates)
+    {
+        m_descriptorTemplateFunctions.create = (PFN_vkCreateDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(m_mainDevice.logicalDevice,
+                                                                                                          "vkCreateDescriptorUpdateTemplateKHR");
+        m_descriptorTemplateFunctions.destroy = (PFN_vkDestroyDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(m_mainDevice.logicalDevice,
+                                                                                                            "vkDestroyDescriptorUpdateTemplateKHR");
+        m_descriptorTemplateFunctions.update = (PFN_vkUpdateDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(m_mainDevice.logicalDevice,
+                                                                                                           "vkUpdateDescriptorSetWithTemplateKHR");
+        m_descriptorUpdateTemplates = m_descriptorTemplateFunctions.create != nullptr && m_descriptorTemplateFunctions.destroy != nullptr &&
+                                      m_descriptorTemplateFunctions.update != nullptr;
+        if (!m_descriptorUpdateTemplates)
+        {
+            m_descriptorTemplateFunctions = {};
+        }
+    }
 }
 
 void VulkanRenderer::CreateSurface()
@@ -466,6 +767,27 @@ void VulkanRenderer::CreateSwapChain()
     }
 }
 
+void VulkanRenderer::CreateOffscreenTargets()
+{
+    // Pick a color format usable as attachment, extent was already set by InitHeadless
+    m_swapChainImageFormat = ChooseSupportedFormat({VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM},
+                                                   VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+
+    // One color target per frame in flight, stored alongside swapchain images so framebuffers, command buffers
+    // and uniform buffers are created the same way for both paths
+    m_offscreenImageMemory.resize(MAX_FRAME_DRAWS);
+    for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
+    {
+        SwapchainImage offscreenImage = {};
+        offscreenImage.image = CreateImage(m_swapChainExtent.width, m_swapChainExtent.height, m_swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+                                           VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           &m_offscreenImageMemory[i]);
+        offscreenImage.imageView = CreateImageView(offscreenImage.image, m_swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+
+        m_swapChainImages.push_back(offscreenImage);
+    }
+}
+
 void VulkanRenderer::CreateRenderPass()
 {
     // ATTACHMENTS
@@ -480,8 +802,9 @@ void VulkanRenderer::CreateRenderPass()
 
     // Framebuffer data will be stored as an image, but images can be given different data layouts
     // to give optimal use for certain operations
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;     // Image data layout before render pass starts
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Image data layout after render pass (to change to)
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // Image data layout before render pass starts
+    colorAttachment.finalLayout = m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL   // Image data layout after render pass (to change to)
+                                             : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;       // Offscreen targets are read back instead of presented
 
     // Depth attachment of render pass
     VkAttachmentDescription depthAttachment = {};
@@ -565,20 +888,28 @@ void VulkanRenderer::CreateDescriptorSetLayout()
     // VP Binding info
     VkDescriptorSetLayoutBinding vpLayoutBinding = {};
     vpLayoutBinding.binding = 0;                                        // Binding point in shader (designated by binding number in shader)
-    vpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Type of decriptor (uniform, dynamic uniform, image sampler, etc)
-    vpLayoutBinding.descriptorCount = 1;                                // Number of descriptors for binding
-    vpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;            // Shader to stage to bind to
-    vpLayoutBinding.pImmutableSamplers = nullptr;                       // For Texture: Can make sampler data unchangeable (immutable) by specifying in layout
-
-    // // MODEL Binding info
-    // VkDescriptorSetLayoutBinding modelLayoutBinding = {};
-    // modelLayoutBinding.binding = 1;
-    // modelLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    // modelLayoutBinding.descriptorCount = 1;
-    // modelLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    // modelLayoutBinding.pImmutableSamplers = nullptr;
-
-    std::vector<VkDescriptorSetLayoutBinding> layoutBindings = {vpLayoutBinding};
+    vpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Type of decriptor (uniform, dynamic uniform, image sampler, etc)
+    vpLayoutBinding.descriptorCount = 1;                                        // Number of descriptors for binding
+    vpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;                    // Shader to stage to bind to
+    vpLayoutBinding.pImmutableSamplers = nullptr;                               // For Texture: Can make sampler data unchangeable (immutable) by specifying in layout
+
+    // MODEL TRANSFORMS Binding info (read when command buffers are cached)
+    VkDescriptorSetLayoutBinding modelLayoutBinding = {};
+    modelLayoutBinding.binding = 1;
+    modelLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    modelLayoutBinding.descriptorCount = 1;
+    modelLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    modelLayoutBinding.pImmutableSamplers = nullptr;
+
+    // DRAWS Binding info (read in GPU-driven rendering, written by the cull pass)
+    VkDescriptorSetLayoutBinding drawLayoutBinding = {};
+    drawLayoutBinding.binding = 2;
+    drawLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    drawLayoutBinding.descriptorCount = 1;
+    drawLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    drawLayoutBinding.pImmutableSamplers = nullptr;
+
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings = {vpLayoutBinding, modelLayoutBinding, drawLayoutBinding};
 
     // Create Descriptor Set Layout with given bindings
     VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
@@ -594,11 +925,11 @@ void VulkanRenderer::CreateDescriptorSetLayout()
     }
 
     // SAMPLER DESCRIPTOR SET LAYTOUT
-    // Texture Bindinig info
+    // Texture Bindinig info (bindless textures: every texture, indexed by texture id)
     VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
     samplerLayoutBinding.binding = 0;
     samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.descriptorCount = 1;
+    samplerLayoutBinding.descriptorCount = m_bindless ? m_bindlessTextureCount : 1;
     samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     samplerLayoutBinding.pImmutableSamplers = nullptr;
 
@@ -608,6 +939,19 @@ void VulkanRenderer::CreateDescriptorSetLayout()
     textureLayoutCreateInfo.bindingCount = 1;
     textureLayoutCreateInfo.pBindings = &samplerLayoutBinding;
 
+    // Elements of textures not created yet are never written, new textures are written while frames using the set are in flight
+    VkDescriptorBindingFlagsEXT bindlessFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+                                                VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCreateInfo = {};
+    bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsCreateInfo.bindingCount = 1;
+    bindingFlagsCreateInfo.pBindingFlags = &bindlessFlags;
+    if (m_bindless)
+    {
+        textureLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+        textureLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+    }
+
     // Create Descriptor Set Layout
     result = vkCreateDescriptorSetLayout(m_mainDevice.logicalDevice, &textureLayoutCreateInfo, nullptr, &m_samplerSetLayout);
     if (result != VK_SUCCESS)
@@ -620,19 +964,40 @@ void VulkanRenderer::CreateGraphicsPipeline()
 {
     // Read in SPIR-V code of shaders
     std::vector<char> vertShaderCode = ReadFile("Shaders/vert.spv");
-    std::vector<char> fragShaderCode = ReadFile("Shaders/frag.spv");
+    std::vector<char> fragShaderCode = ReadFile(m_bindless ? "Shaders/frag_bindless.spv" : "Shaders/frag.spv");
 
     // Create Shader Modules
     VkShaderModule vertShaderModule = CreateShaderModule(vertShaderCode);
     VkShaderModule fragShaderModule = CreateShaderModule(fragShaderCode);
 
+    // -- SPECIALIZATION CONSTANTS --
+    // Vertex shader reads model transform from the storage buffer instead of push constants when command buffers are cached,
+    // and everything else it needs from the draw's GpuDraw in GPU-driven rendering
+    std::array<VkBool32, 2> specializationData = {m_settings.cacheCommandBuffers ? VK_TRUE : VK_FALSE,
+                                                  m_gpuDriven ? VK_TRUE : VK_FALSE};
+
+    std::array<VkSpecializationMapEntry, 2> specializationEntries = {};
+    for (uint32_t i = 0; i < specializationEntries.size(); i++)
+    {
+        specializationEntries[i].constantID = i;                // constant_id in shader
+        specializationEntries[i].offset = i * sizeof(VkBool32); // Offset of value in specialization data
+        specializationEntries[i].size = sizeof(VkBool32);       // Size of value
+    }
+
+    VkSpecializationInfo vertexSpecializationInfo = {};
+    vertexSpecializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+    vertexSpecializationInfo.pMapEntries = specializationEntries.data();
+    vertexSpecializationInfo.dataSize = sizeof(specializationData);
+    vertexSpecializationInfo.pData = specializationData.data();
+
     // -- SHADER STAGE CREATION INFORMATION --
     // Vertex Stage creation information
     VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
     vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT; // Shader Stage name
-    vertexShaderCreateInfo.module = vertShaderModule;          // Shader module to be used by stage
-    vertexShaderCreateInfo.pName = "main";                     // Entry point into shader
+    vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;              // Shader Stage name
+    vertexShaderCreateInfo.module = vertShaderModule;                       // Shader module to be used by stage
+    vertexShaderCreateInfo.pName = "main";                                  // Entry point into shader
+    vertexShaderCreateInfo.pSpecializationInfo = &vertexSpecializationInfo; // Constant values baked into shader
 
     // Fragment Stage creation information
     VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
@@ -645,47 +1010,77 @@ void VulkanRenderer::CreateGraphicsPipeline()
     // Graphics Pipeline creation info requires array of shader stage creates
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertexShaderCreateInfo, fragmentShaderCreateInfo};
 
-    // How the data for a single vertex (including info such as position, color, texture coord, normals etc) is as a whole
-    VkVertexInputBindingDescription bindingDescription = {};
-    bindingDescription.binding = 0;                             // Can bind multiple streams of data
-    bindingDescription.stride = sizeof(Vertex);                 // Size of single vertex object
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // How to move between data after each vertex
-                                                                // VK_VERTEX_INPUT_RATE_VERTEX      : Move on to the next vertex
-                                                                // VK_VERTEX_INPUT_RATE_INSTANCE    : Move to a vertex next instance
-    // How the data for an attibute is defined within a vertex
-    std::array<VkVertexInputAttributeDescription, 3> attributeDescription;
-
-    // Position attribute
-    attributeDescription[0].binding = 0;                         // Which binding the data is at (should be same as above)
-    attributeDescription[0].location = 0;                        // Location in shader where data will be read from
-    attributeDescription[0].format = VK_FORMAT_R32G32B32_SFLOAT; // Format the data will take (also helps define size of data)
-    attributeDescription[0].offset = offsetof(Vertex, pos);      // Where this attibute is defined in the data for a single vertex
-
-    // Color attribute
-    attributeDescription[1].binding = 0;                         // Which binding the data is at (should be same as above)
-    attributeDescription[1].location = 1;                        // Location in shader where data will be read from
-    attributeDescription[1].format = VK_FORMAT_R32G32B32_SFLOAT; // Format the data will take (also helps define size of data)
-    attributeDescription[1].offset = offsetof(Vertex, col);      // Where this attibute is defined in the data for a single vertex
-
-    // Texture attribute
-    attributeDescription[2].binding = 0;                      // Which binding the data is at (should be same as above)
-    attributeDescription[2].location = 2;                     // Location in shader where data will be read from
-    attributeDescription[2].format = VK_FORMAT_R32G32_SFLOAT; // Format the data will take (also helps define size of data)
-    attributeDescription[2].offset = offsetof(Vertex, tex);   // Where this attibute is defined in the data for a single vertex
-
-    // -- VERTEX INPUT --
-    VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
-    vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-    vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;                                     // List of Vertex Binding Descriptions (data spacing/stride info)
-    vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size()); //
-    vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescription.data();                           // List of Vertex Attribute Descriptions (data format and where to bind to/from)
+    // One pipeline per vertex format, they only differ in how vertex data is laid out
+    std::array<VkVertexInputBindingDescription, VERTEX_FORMAT_COUNT> bindingDescriptions;
+    std::array<std::array<VkVertexInputAttributeDescription, 2>, VERTEX_FORMAT_COUNT> attributeDescriptions;
+    std::array<VkPipelineVertexInputStateCreateInfo, VERTEX_FORMAT_COUNT> vertexInputCreateInfos;
+
+    for (size_t i = 0; i < VERTEX_FORMAT_COUNT; i++)
+    {
+        VertexFormat format = static_cast<VertexFormat>(i);
+
+        // How the data for a single vertex (including info such as position, color, texture coord, normals etc) is as a whole
+        VkVertexInputBindingDescription &bindingDescription = bindingDescriptions[i];
+        bindingDescription.binding = 0;                             // Can bind multiple streams of data
+        bindingDescription.stride = GetVertexSize(format);          // Size of single vertex object
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // How to move between data after each vertex
+                                                                    // VK_VERTEX_INPUT_RATE_VERTEX      : Move on to the next vertex
+                                                                    // VK_VERTEX_INPUT_RATE_INSTANCE    : Move to a vertex next instance
+        // How the data for an attibute is defined within a vertex (color is always white and not read by the shader)
+        std::array<VkVertexInputAttributeDescription, 2> &attributeDescription = attributeDescriptions[i];
+
+        // Position attribute
+        attributeDescription[0].binding = 0;  // Which binding the data is at (should be same as above)
+        attributeDescription[0].location = 0; // Location in shader where data will be read from
+
+        // Texture attribute
+        attributeDescription[1].binding = 0;  // Which binding the data is at (should be same as above)
+        attributeDescription[1].location = 2; // Location in shader where data will be read from
+
+        // Format the data will take (also helps define size of data), and where it is defined in the data for a single vertex
+        switch (format)
+        {
+        case VertexFormat::Compact:
+            attributeDescription[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attributeDescription[0].offset = offsetof(CompactVertex, pos);
+            attributeDescription[1].format = VK_FORMAT_R16G16_SFLOAT;
+            attributeDescription[1].offset = offsetof(CompactVertex, tex);
+            break;
+        case VertexFormat::Quantized:
+            attributeDescription[0].format = VK_FORMAT_R16G16B16A16_SNORM; // Dequantized with the mesh's push constants
+            attributeDescription[0].offset = offsetof(QuantizedVertex, pos);
+            attributeDescription[1].format = VK_FORMAT_R16G16_SFLOAT;
+            attributeDescription[1].offset = offsetof(QuantizedVertex, tex);
+            break;
+        default:
+            attributeDescription[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attributeDescription[0].offset = offsetof(Vertex, pos);
+            attributeDescription[1].format = VK_FORMAT_R32G32_SFLOAT;
+            attributeDescription[1].offset = offsetof(Vertex, tex);
+            break;
+        }
+
+        // -- VERTEX INPUT --
+        VkPipelineVertexInputStateCreateInfo &vertexInputCreateInfo = vertexInputCreateInfos[i];
+        vertexInputCreateInfo = {};
+        vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
+        vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;                                     // List of Vertex Binding Descriptions (data spacing/stride info)
+        vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size()); //
+        vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescription.data();                           // List of Vertex Attribute Descriptions (data format and where to bind to/from)
+    }
 
     // -- INPUT ASSEMBLY --
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; // Primitive type to assemble into
-    inputAssembly.primitiveRestartEnable = VK_FALSE;              // Allow overriding of "strip" topology to start new primitives
+    // Meshes are drawn as triangle lists, or as strips split by the restart index (largest value of the index type)
+    std::array<VkPipelineInputAssemblyStateCreateInfo, 2> inputAssemblies = {};
+    std::array<VkPrimitiveTopology, 2> topologies = {VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP};
+    for (size_t i = 0; i < topologies.size(); i++)
+    {
+        VkPipelineInputAssemblyStateCreateInfo &inputAssembly = inputAssemblies[i];
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = topologies[i];                                                                         // Primitive type to assemble into
+        inputAssembly.primitiveRestartEnable = topologies[i] == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP ? VK_TRUE : VK_FALSE; // Allow overriding of "strip" topology to start new primitives
+    }
 
     // -- VIEWPORT & SCISSOR --
     // Create a viewport info struct
@@ -801,8 +1196,8 @@ void VulkanRenderer::CreateGraphicsPipeline()
     pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineCreateInfo.stageCount = 2;                             // Number of shader stages
     pipelineCreateInfo.pStages = shaderStages;                     // List of shader stages
-    pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo; // All the fixed function pipeline states
-    pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+    pipelineCreateInfo.pVertexInputState = nullptr;                // All the fixed function pipeline states (vertex input set per format below)
+    pipelineCreateInfo.pInputAssemblyState = nullptr; // Set per topology below
     pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
     pipelineCreateInfo.pDynamicState = nullptr;
     pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
@@ -817,8 +1212,33 @@ void VulkanRenderer::CreateGraphicsPipeline()
     pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE; // Existing pipeline to derive from
     pipelineCreateInfo.basePipelineIndex = -1;              // or index of pipeline being created to derive from (in case creating multiple at one)
 
-    // Create Graphics Pipeline
-    result = vkCreateGraphicsPipelines(m_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_graphicsPipeline);
+    // Every other pipeline derives from the full format triangle list pipeline, created in the same call
+    std::array<VkGraphicsPipelineCreateInfo, VERTEX_FORMAT_COUNT * 2> pipelineCreateInfos;
+    for (size_t i = 0; i < VERTEX_FORMAT_COUNT; i++)
+    {
+        for (size_t j = 0; j < topologies.size(); j++)
+        {
+            size_t pipelineIndex = GetPipelineIndex(static_cast<VertexFormat>(i), topologies[j]);
+
+            VkGraphicsPipelineCreateInfo &createInfo = pipelineCreateInfos[pipelineIndex];
+            createInfo = pipelineCreateInfo;
+            createInfo.pVertexInputState = &vertexInputCreateInfos[i];
+            createInfo.pInputAssemblyState = &inputAssemblies[j];
+            if (pipelineIndex == 0)
+            {
+                createInfo.flags = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+            }
+            else
+            {
+                createInfo.flags = VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+                createInfo.basePipelineIndex = 0;
+            }
+        }
+    }
+
+    // Create Graphics Pipelines
+    result = vkCreateGraphicsPipelines(m_mainDevice.logicalDevice, VK_NULL_HANDLE, static_cast<uint32_t>(pipelineCreateInfos.size()),
+                                       pipelineCreateInfos.data(), nullptr, m_graphicsPipelines.data());
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create a Graphics Pipeline");
@@ -829,6 +1249,80 @@ void VulkanRenderer::CreateGraphicsPipeline()
     vkDestroyShaderModule(m_mainDevice.logicalDevice, vertShaderModule, nullptr);
 }
 
+void VulkanRenderer::CreateCullPipeline()
+{
+    // Only GPU-driven rendering culls on the GPU
+    if (!m_gpuDriven)
+    {
+        return;
+    }
+
+    // CULL DESCRIPTOR SET LAYOUT
+    // Cull data and model transforms are slices of the frame allocator, the rest are buffers of their own
+    std::array<VkDescriptorType, 5> descriptorTypes = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,  // CullData
+                                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,  // Model transforms
+                                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          // Draws
+                                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,          // Indirect commands
+                                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};         // Draw counts
+
+    std::array<VkDescriptorSetLayoutBinding, 5> layoutBindings = {};
+    for (uint32_t i = 0; i < layoutBindings.size(); i++)
+    {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = descriptorTypes[i];
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        layoutBindings[i].pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+    layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutCreateInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    layoutCreateInfo.pBindings = layoutBindings.data();
+
+    VkResult result = vkCreateDescriptorSetLayout(m_mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &m_cullSetLayout);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to Create Cull Descriptor Set Layout");
+    }
+
+    // -- PIPELINE LAYOUT --
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &m_cullSetLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+    pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+
+    result = vkCreatePipelineLayout(m_mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_cullPipelineLayout);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create Cull Pipeline Layout");
+    }
+
+    // -- COMPUTE PIPELINE CREATION --
+    std::vector<char> cullShaderCode = ReadFile("Shaders/cull.spv");
+    VkShaderModule cullShaderModule = CreateShaderModule(cullShaderCode);
+
+    VkComputePipelineCreateInfo pipelineCreateInfo = {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineCreateInfo.stage.module = cullShaderModule;
+    pipelineCreateInfo.stage.pName = "main";
+    pipelineCreateInfo.layout = m_cullPipelineLayout;
+    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineCreateInfo.basePipelineIndex = -1;
+
+    result = vkCreateComputePipelines(m_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_cullPipeline);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create Cull Pipeline");
+    }
+
+    vkDestroyShaderModule(m_mainDevice.logicalDevice, cullShaderModule, nullptr);
+}
+
 void VulkanRenderer::GetPhysicalDevice()
 {
     // Get no of available vulkan capable physical devices
@@ -853,10 +1347,6 @@ void VulkanRenderer::GetPhysicalDevice()
         }
     }
 
-    VkPhysicalDeviceProperties deviceProperties;
-    vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
-
-    // m_minUniformBufferOffset = deviceProperties.limits.minUniformBufferOffsetAlignment;
 }
 
 bool VulkanRenderer::CheckInstanceExtensionsSupport(std::vector<const char *> checkExtensions)
@@ -906,13 +1396,108 @@ bool VulkanRenderer::CheckDeviceSuitable(VkPhysicalDevice device)
     VkPhysicalDeviceFeatures deviceFeatures;
     vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
+    // Baked textures can stay block compressed on the GPU if the device samples BC formats
+    m_textureCompressionBC = deviceFeatures.textureCompressionBC == VK_TRUE;
+
     // Check if queues are supported
     m_indices = GetQueueFamilies(device);
 
-    bool extensionsSupported = CheckDeviceExtensionsSupport(device);
+    // Blits need a graphics queue, so mip levels are only blitted when uploads don't go through a transfer only queue
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(device, VK_FORMAT_R8G8B8A8_UNORM, &formatProperties);
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    m_blitMipmaps = m_indices.transferFamily < 0 && (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
+    // GPU-driven rendering draws a group of indirect commands at once, each selecting its draw data by first instance,
+    // and runs the cull pass on the graphics queue. Without those the meshes are culled and drawn by the CPU
+    m_gpuDriven = false;
+    m_drawIndirectCount = false;
+    if (m_settings.gpuDrivenRendering && m_indices.graphicsFamily >= 0 &&
+        deviceFeatures.multiDrawIndirect && deviceFeatures.drawIndirectFirstInstance)
+    {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyList.data());
+        m_gpuDriven = (queueFamilyList[m_indices.graphicsFamily].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+    }
+
+    // Optional device extensions
+    m_descriptorUpdateTemplates = false;
+    bool descriptorIndexing = false;
+    bool maintenance3 = false;
+    uint32_t extensionsCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionsCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensions.data());
+    for (const auto &extension : extensions)
+    {
+        // Survivors are only counted on the GPU, drawing that count needs VK_KHR_draw_indirect_count (core since Vulkan 1.2).
+        // Without it every command of a group is drawn, the ones of culled meshes are left empty
+        if (m_gpuDriven && strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0)
+        {
+            m_drawIndirectCount = true;
+        }
+        // Descriptor sets written in one call from a struct (core since Vulkan 1.1), otherwise with a list of writes
+        if (strcmp(extension.extensionName, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME) == 0)
+        {
+            m_descriptorUpdateTemplates = true;
+        }
+        // Bindless textures (core since Vulkan 1.2), VK_EXT_descriptor_indexing depends on VK_KHR_maintenance3
+        if (strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0)
+        {
+            descriptorIndexing = true;
+        }
+        if (strcmp(extension.extensionName, VK_KHR_MAINTENANCE3_EXTENSION_NAME) == 0)
+        {
+            maintenance3 = true;
+        }
+    }
+
+    // Bindless textures need a partially bound sampler array that can be written while command buffers using it are pending.
+    // Without it every texture has a set of its own, bound before each draw of a mesh using it
+    m_bindless = false;
+    m_bindlessTextureCount = 0;
+    if (m_settings.bindlessTextures && m_physicalDeviceProperties2 && descriptorIndexing && maintenance3)
+    {
+        auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(m_vkInstance, "vkGetPhysicalDeviceFeatures2KHR");
+        auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(m_vkInstance, "vkGetPhysicalDeviceProperties2KHR");
+        if (getFeatures2 != nullptr && getProperties2 != nullptr)
+        {
+            VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+            indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+            VkPhysicalDeviceFeatures2KHR features2 = {};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+            features2.pNext = &indexingFeatures;
+            getFeatures2(device, &features2);
+
+            VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+            indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+            VkPhysicalDeviceProperties2KHR properties2 = {};
+            properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+            properties2.pNext = &indexingProperties;
+            getProperties2(device, &properties2);
+
+            // The fragment shader indexes the texture array with the draw's texture index (dynamically uniform)
+            m_bindless = deviceFeatures.shaderSampledImageArrayDynamicIndexing &&
+                         indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+                         indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+                         indexingFeatures.descriptorBindingUpdateUnusedWhilePending;
+
+            // Combined image samplers count against both the sampler and the sampled image limits
+            m_bindlessTextureCount = std::min({MAX_BINDLESS_TEXTURES,
+                                               indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                               indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                               indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+                                               indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages});
+        }
+    }
+
+    // Headless rendering needs neither the swapchain extension nor a surface
+    bool extensionsSupported = m_headless || CheckDeviceExtensionsSupport(device);
 
-    bool swapChainValid = false;
-    if (extensionsSupported)
+    bool swapChainValid = m_headless;
+    if (extensionsSupported && !m_headless)
     {
         SwapChainDetails swapChainDetails = GetSwapChainDetails(device);
         swapChainValid = !swapChainDetails.presentationModes.empty() && !swapChainDetails.formats.empty();
@@ -1019,7 +1604,15 @@ QueueFamilyIndices VulkanRenderer::GetQueueFamilies(VkPhysicalDevice device)
 
         // Check if Queue Family supports presentation
         VkBool32 presentationSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentationSupport);
+        if (m_headless)
+        {
+            // Nothing is presented, so the graphics family stands in for presentation
+            presentationSupport = (indices.graphicsFamily == i);
+        }
+        else
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentationSupport);
+        }
         // Check if queue is Presentation type (can be both GraphicsFamily and Presentation)
         if (queueFamily.queueCount > 0 && presentationSupport)
         {
@@ -1034,6 +1627,25 @@ QueueFamilyIndices VulkanRenderer::GetQueueFamilies(VkPhysicalDevice device)
         i++;
     }
 
+    // Look for a transfer family without graphics (ideally without compute too), those map to the copy engines.
+    // The geometry pool is drawn from while meshes are copied into other ranges of it, so it stays on the graphics queue
+    if (m_settings.useTransferQueue && !m_settings.gpuDrivenRendering)
+    {
+        for (i = 0; i < static_cast<int>(queueFamilyList.size()); i++)
+        {
+            VkQueueFlags flags = queueFamilyList[i].queueFlags;
+            if (queueFamilyList[i].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+            {
+                continue;
+            }
+
+            if (indices.transferFamily < 0 || !(flags & VK_QUEUE_COMPUTE_BIT))
+            {
+                indices.transferFamily = i;
+            }
+        }
+    }
+
     return indices;
 }
 
@@ -1056,6 +1668,11 @@ void VulkanRenderer::CreateDebugCallback()
     }
 }
 
+size_t VulkanRenderer::GetPipelineIndex(VertexFormat vertexFormat, VkPrimitiveTopology topology)
+{
+    return static_cast<size_t>(vertexFormat) * 2 + (topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP ? 1 : 0);
+}
+
 SwapChainDetails VulkanRenderer::GetSwapChainDetails(VkPhysicalDevice device)
 {
     SwapChainDetails swapChainDetails;
@@ -1153,7 +1770,7 @@ VkExtent2D VulkanRenderer::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &surf
     }
 }
 
-VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
 {
     VkImageViewCreateInfo viewCreateInfo{};
     viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1168,7 +1785,7 @@ VkImageView VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkIm
     // Subresources allow the view to view only
     viewCreateInfo.subresourceRange.aspectMask = aspectFlags; // Which aspect of image to view (e.g. COLOR_BIT for viewing color
     viewCreateInfo.subresourceRange.baseMipLevel = 0;         // Start mipmap level to view from
-    viewCreateInfo.subresourceRange.levelCount = 1;           // Number of mipmap levels to view
+    viewCreateInfo.subresourceRange.levelCount = mipLevels;   // Number of mipmap levels to view
     viewCreateInfo.subresourceRange.baseArrayLayer = 0;       // Start array level to view from
     viewCreateInfo.subresourceRange.layerCount = 1;           // Number of array levels to view
 
@@ -1240,12 +1857,26 @@ void VulkanRenderer::CreateCommandPool()
     {
         throw std::runtime_error("Failed to Create Graphics Command Pool");
     }
-}
 
-void VulkanRenderer::CreateCommandBuffers()
-{
-    // Resize command buffer count to have one for each framebuffer
-    m_commandBuffers.resize(m_swapChainFrameBuffers.size());
+    if (m_indices.transferFamily >= 0)
+    {
+        // Upload command buffers are short lived, recorded once and freed after their batch completes
+        poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolCreateInfo.queueFamilyIndex = m_indices.transferFamily;
+
+        // Create a Transfer Queue Family Command Pool
+        result = vkCreateCommandPool(m_mainDevice.logicalDevice, &poolCreateInfo, nullptr, &m_transferCommandPool);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to Create Transfer Command Pool");
+        }
+    }
+}
+
+void VulkanRenderer::CreateCommandBuffers()
+{
+    // Resize command buffer count to have one for each framebuffer
+    m_commandBuffers.resize(m_swapChainFrameBuffers.size());
 
     VkCommandBufferAllocateInfo commandBuffAllocInfo = {};
     commandBuffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1260,6 +1891,40 @@ void VulkanRenderer::CreateCommandBuffers()
     {
         throw std::runtime_error("Failed to allocate command buffers");
     }
+
+    // Nothing recorded yet
+    m_commandBufferDirty.assign(m_commandBuffers.size(), true);
+}
+
+void VulkanRenderer::BuildDrawList()
+{
+    // Every mesh is opaque, so draws sharing a pipeline and texture are drawn front to back by view depth of their bounds center.
+    // Meshes have buffers of their own, so there is no run of draws sharing buffers to sort by.
+    // Instanced models are sorted by the depth of the model itself, their copies are drawn with a single draw
+    m_drawList.Clear();
+    for (uint32_t modelID : m_visibleModels)
+    {
+        MeshModel &model = m_meshModels[modelID];
+        glm::mat4 modelView = m_uboViewProjection.view * model.GetModel();
+
+        for (uint32_t i = 0; i < model.GetMeshCount(); i++)
+        {
+            Mesh *mesh = model.GetMesh(i);
+            if (!mesh->IsVisible())
+            {
+                continue;
+            }
+
+            glm::vec3 center = (mesh->GetBoundsMin() + mesh->GetBoundsMax()) * 0.5f;
+            float depth = -(modelView * glm::vec4(center, 1.0f)).z; // View space looks down -z
+
+            uint32_t pipeline = static_cast<uint32_t>(GetPipelineIndex(mesh->GetVertexFormat(), mesh->GetTopology()));
+            uint32_t texture = static_cast<uint32_t>(mesh->GetTexId());
+            m_drawList.Add(DrawList::MakeKey(pipeline, texture, depth), modelID, i);
+        }
+    }
+
+    m_drawList.Sort();
 }
 
 void VulkanRenderer::RecordCommands(uint32_t currentImage)
@@ -1292,47 +1957,99 @@ void VulkanRenderer::RecordCommands(uint32_t currentImage)
     }
 
     {
+        // Culling writes the indirect commands, so it has to run before the render pass
+        if (m_gpuDriven)
+        {
+            RecordCullPass(currentImage);
+        }
+
         // Begin Render Pass
         vkCmdBeginRenderPass(m_commandBuffers[currentImage], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        {
-            // Bind Pipeline to be used in render pass
-            vkCmdBindPipeline(m_commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+        // Nothing is bound at the start of a command buffer
+        m_commandRecorder.Begin(m_commandBuffers[currentImage], m_pipelineLayout);
 
-            for (size_t j = 0; j < m_meshModels.size(); j++)
+        if (m_gpuDriven)
+        {
+            RecordIndirectDraws(currentImage);
+        }
+        else
+        {
+            // Every visible mesh, sorted so draws sharing a pipeline, texture and buffers follow each other
+            BuildDrawList();
+
+            // Dynamic offsets select this frame's slices of the frame allocator. Bindless textures: the texture set is
+            // bound once as well, each draw pushes the index of its texture instead
+            const std::array<uint32_t, 2> &dynamicOffsets = m_frameOffsets[currentImage];
+            m_commandRecorder.BindDescriptorSet(0, m_descriptorSets[currentImage], static_cast<uint32_t>(dynamicOffsets.size()),
+                                                dynamicOffsets.data());
+            if (m_bindless)
             {
-                MeshModel thisModel = m_meshModels[j];
+                m_commandRecorder.BindDescriptorSet(1, m_bindlessDescriptorSet);
+            }
 
-                // Push Constants to given shader stage directly (no buffer)
-                vkCmdPushConstants(m_commandBuffers[currentImage], m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
-                                   0, sizeof(Model), thisModel.GetModelPtr());
+            // Model whose transform was pushed last, draws of a model aren't next to each other once sorted
+            uint32_t pushedModel = UINT32_MAX;
 
-                for (uint32_t k = 0; k < thisModel.GetMeshCount(); k++)
-                {
-                    VkBuffer vertexBuffers[] = {thisModel.GetMesh(k)->GetVertexBuffer()}; // Buffers to bind
-                    VkDeviceSize offsets[] = {0};                                 // Offsests into buffers being bound
+            for (size_t i = 0; i < m_drawList.GetCount(); i++)
+            {
+                const DrawItem &item = m_drawList.GetItem(i);
 
-                    vkCmdBindVertexBuffers(m_commandBuffers[currentImage], 0, 1, vertexBuffers, offsets);
+                // Reference, copying the model would copy its mesh list on every frame
+                MeshModel &thisModel = m_meshModels[item.model];
+                Mesh *thisMesh = thisModel.GetMesh(item.mesh);
 
-                    // Bind mesh index buffer, with 0 offset and using the uint32_t type
-                    vkCmdBindIndexBuffer(m_commandBuffers[currentImage], thisModel.GetMesh(k)->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+                // First instance is the model's slot in the transform storage buffer
+                uint32_t firstInstance = item.model;
+                uint32_t instanceCount = 1;
+                if (!m_modelInstances[item.model].empty())
+                {
+                    // Every visible copy in one draw, their transforms are a range after the model transforms
+                    firstInstance = static_cast<uint32_t>(m_meshModels.size()) + m_instanceRanges[item.model].first;
+                    instanceCount = m_instanceRanges[item.model].count;
+                }
+                else if (!m_settings.cacheCommandBuffers)
+                {
+                    // Push Constants to given shader stage directly (no buffer), first instance 0 selects them in the shader
+                    if (item.model != pushedModel)
+                    {
+                        vkCmdPushConstants(m_commandBuffers[currentImage], m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                                           0, sizeof(Model), thisModel.GetModelPtr());
+                        pushedModel = item.model;
+                    }
+                    firstInstance = 0;
+                }
 
-                    // Dynamic Offset Amount
-                    // uint32_t dynamicOffset = static_cast<uint32_t>(m_modelUniformAlignment) * j;
+                m_commandRecorder.BindPipeline(m_graphicsPipelines[GetPipelineIndex(thisMesh->GetVertexFormat(), thisMesh->GetTopology())]);
 
-                    //
-                    std::array<VkDescriptorSet, 2> descriptorSetGroup = {m_descriptorSets[currentImage], m_samplerDescriptorSets[thisModel.GetMesh(k)->GetTexId()]};
+                // Mesh dequantization never changes, so it is pushed even into cached command buffers
+                vkCmdPushConstants(m_commandBuffers[currentImage], m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                                   sizeof(Model), sizeof(MeshDequantization), thisMesh->GetDequantizationPtr());
 
-                    // Bind Descriptor Sets
-                    vkCmdBindDescriptorSets(m_commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
-                                            0, static_cast<uint32_t>(descriptorSetGroup.size()), descriptorSetGroup.data(), 0, nullptr);
+                // Bind mesh vertex buffer, and index buffer using the mesh's index type (uint16_t when its vertices fit)
+                m_commandRecorder.BindVertexBuffer(thisMesh->GetVertexBuffer(), 0);
+                m_commandRecorder.BindIndexBuffer(thisMesh->GetIndexBuffer(), 0, thisMesh->GetIndexType());
 
-                    // Execute Pipepline
-                    vkCmdDrawIndexed(m_commandBuffers[currentImage], thisModel.GetMesh(k)->GetIndexCount(), 1, 0, 0, 0);
+                if (m_bindless)
+                {
+                    uint32_t textureIndex = static_cast<uint32_t>(thisMesh->GetTexId());
+                    vkCmdPushConstants(m_commandBuffers[currentImage], m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                                       sizeof(Model) + sizeof(MeshDequantization), sizeof(uint32_t), &textureIndex);
                 }
+                else
+                {
+                    m_commandRecorder.BindDescriptorSet(1, m_samplerDescriptorSets[thisMesh->GetTexId()].set);
+                }
+
+                // Execute Pipepline for the LOD chosen this frame
+                const MeshLod &lod = thisMesh->GetLod(thisMesh->GetSelectedLod());
+                vkCmdDrawIndexed(m_commandBuffers[currentImage], lod.indexCount, instanceCount, thisMesh->GetFirstIndex() + lod.firstIndex,
+                                 thisMesh->GetVertexOffset(), firstInstance);
             }
         }
 
+        m_bindStatistics = m_commandRecorder.GetStatistics();
+
         // End Rendere Pass
         vkCmdEndRenderPass(m_commandBuffers[currentImage]);
     }
@@ -1345,11 +2062,144 @@ void VulkanRenderer::RecordCommands(uint32_t currentImage)
     }
 }
 
+void VulkanRenderer::RecordCullPass(uint32_t currentImage)
+{
+    VkCommandBuffer commandBuffer = m_commandBuffers[currentImage];
+
+    // Counters start at zero. Without draw counts every command is drawn, so culled ones must be left empty
+    vkCmdFillBuffer(commandBuffer, m_drawCountBuffers[currentImage], 0, VK_WHOLE_SIZE, 0);
+    if (!m_drawIndirectCount)
+    {
+        vkCmdFillBuffer(commandBuffer, m_indirectCommandBuffers[currentImage], 0, VK_WHOLE_SIZE, 0);
+    }
+
+    // Clears must finish before the cull pass counts and writes commands
+    VkMemoryBarrier clearBarrier = {};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    // One invocation per draw, cull data and model transforms are this frame's slices of the frame allocator
+    std::array<uint32_t, 2> dynamicOffsets = {m_cullDataOffsets[currentImage], m_frameOffsets[currentImage][1]};
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &m_cullDescriptorSets[currentImage],
+                            static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+    vkCmdDispatch(commandBuffer, (m_drawCount + 63) / 64, 1, 1);
+
+    // Commands and counts must be written before the draws read them
+    VkMemoryBarrier cullBarrier = {};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+                         1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+    // Counts are read back by UpdateDraws once the frame's fence signals, the fence alone doesn't make them visible to the host
+    VkMemoryBarrier readbackBarrier = {};
+    readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    readbackBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &readbackBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanRenderer::RecordIndirectDraws(uint32_t currentImage)
+{
+    VkCommandBuffer commandBuffer = m_commandBuffers[currentImage];
+
+    // Every mesh is a triangle list in the geometry pool, in the vertex format of the renderer
+    m_commandRecorder.BindPipeline(m_graphicsPipelines[GetPipelineIndex(m_settings.vertexFormat, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)]);
+    m_commandRecorder.BindVertexBuffer(m_geometryPool.GetVertexBuffer(), 0);
+    m_commandRecorder.BindIndexBuffer(m_geometryPool.GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+    const std::array<uint32_t, 2> &dynamicOffsets = m_frameOffsets[currentImage];
+    m_commandRecorder.BindDescriptorSet(0, m_descriptorSets[currentImage], static_cast<uint32_t>(dynamicOffsets.size()),
+                                        dynamicOffsets.data());
+    if (m_bindless)
+    {
+        m_commandRecorder.BindDescriptorSet(1, m_bindlessDescriptorSet);
+    }
+
+    // One indirect call per texture, however many meshes use it (a single call for every mesh with bindless textures)
+    const VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+    for (uint32_t i = 0; i < m_drawGroups.size(); i++)
+    {
+        const DrawGroup &group = m_drawGroups[i];
+        if (group.drawCount == 0)
+        {
+            continue;
+        }
+
+        if (!m_bindless)
+        {
+            m_commandRecorder.BindDescriptorSet(1, m_samplerDescriptorSets[i].set);
+        }
+
+        if (m_drawIndirectCount)
+        {
+            m_cmdDrawIndexedIndirectCount(commandBuffer, m_indirectCommandBuffers[currentImage], stride * group.firstCommand,
+                                          m_drawCountBuffers[currentImage], sizeof(uint32_t) * i, group.drawCount,
+                                          static_cast<uint32_t>(stride));
+        }
+        else
+        {
+            vkCmdDrawIndexedIndirect(commandBuffer, m_indirectCommandBuffers[currentImage], stride * group.firstCommand,
+                                     group.drawCount, static_cast<uint32_t>(stride));
+        }
+    }
+}
+
+void VulkanRenderer::InvalidateCommandBuffers()
+{
+    // Everything recorded so far refers to outdated state
+    std::fill(m_commandBufferDirty.begin(), m_commandBufferDirty.end(), true);
+}
+
+UploadBatch VulkanRenderer::CreateUploadBatch()
+{
+    UploadQueue graphics = {m_graphicsQueue, m_graphicsCommandPool, static_cast<uint32_t>(m_indices.graphicsFamily)};
+
+    // Without a dedicated transfer family the graphics queue records and submits the copies itself
+    if (m_indices.transferFamily < 0)
+    {
+        return UploadBatch(&m_memoryAllocator, &m_stagingRing, graphics, graphics);
+    }
+
+    UploadQueue transfer = {m_transferQueue, m_transferCommandPool, static_cast<uint32_t>(m_indices.transferFamily)};
+    return UploadBatch(&m_memoryAllocator, &m_stagingRing, transfer, graphics);
+}
+
+void VulkanRenderer::SubmitUpload(UploadBatch &upload)
+{
+    // Draws are submitted to the same queue after this, the batch's barriers make the data visible to them
+    upload.Submit();
+    m_pendingUploads.push_back(upload);
+}
+
+void VulkanRenderer::ReleaseCompletedUploads()
+{
+    for (size_t i = 0; i < m_pendingUploads.size();)
+    {
+        if (m_pendingUploads[i].IsComplete())
+        {
+            m_pendingUploads[i].Release();
+            m_pendingUploads.erase(m_pendingUploads.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
 void VulkanRenderer::CreateSynchronization()
 {
     m_imageAvailable.resize(MAX_FRAME_DRAWS);
     m_renderFinished.resize(MAX_FRAME_DRAWS);
     m_drawFences.resize(MAX_FRAME_DRAWS);
+    m_imagesInFlight.assign(m_swapChainImages.size(), VK_NULL_HANDLE);
 
     // Semaphore creation information
     VkSemaphoreCreateInfo semaphoreCreateInfo = {};
@@ -1372,26 +2222,34 @@ void VulkanRenderer::CreateSynchronization()
 
 void VulkanRenderer::CreateUniformBuffers()
 {
-    // View Projection Buffer size
-    VkDeviceSize vpBufferSize = sizeof(UBOViewProjection);
+    // Slices are bound as dynamic uniform and storage buffers, so must satisfy both offset alignments
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
+    VkDeviceSize alignment = std::max(deviceProperties.limits.minUniformBufferOffsetAlignment,
+                                      deviceProperties.limits.minStorageBufferOffsetAlignment);
 
-    // Model buffer size
-    // VkDeviceSize modelBufferSize = m_modelUniformAlignment * MAX_OBJECTS;
+    // Only the live transforms are allocated each frame, but the transform descriptors cover room for every model and
+    // instance after the view projection, so that window must fit in the buffer
+    VkDeviceSize frameSize = (sizeof(UBOViewProjection) + alignment - 1) / alignment * alignment + sizeof(Model) * (MAX_MODELS + MAX_INSTANCES);
+    if (m_gpuDriven)
+    {
+        // And the cull pass's data after them
+        frameSize = (frameSize + alignment - 1) / alignment * alignment + sizeof(CullData);
+    }
+    if (m_settings.frameAllocatorSize < frameSize)
+    {
+        throw std::runtime_error("Frame allocator size too small for per-frame uniform data");
+    }
 
-    // One uniform buffer for each image (and by extension, command buffer)
-    m_vpUniformBuffer.resize(m_swapChainImages.size());
-    m_vpUniformBufferMemory.resize(m_swapChainImages.size());
-    // m_modelDynUniformBuffer.resize(m_swapChainImages.size());
-    // m_modelDynUniformBufferMemory.resize(m_swapChainImages.size());
+    // One frame allocator for each image (and by extension, command buffer)
+    m_frameAllocators.resize(m_swapChainImages.size());
+    m_frameOffsets.assign(m_swapChainImages.size(), {0, 0});
+    m_cullDataOffsets.assign(m_swapChainImages.size(), 0);
 
-    // Create Uniform Buffers
     for (size_t i = 0; i < m_swapChainImages.size(); i++)
     {
-        CreateBuffer(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, vpBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_vpUniformBuffer[i], &m_vpUniformBufferMemory[i]);
-
-        // CreateBuffer(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, modelBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        //              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_modelDynUniformBuffer[i], &m_modelDynUniformBufferMemory[i]);
+        m_frameAllocators[i].Init(&m_memoryAllocator, m_settings.frameAllocatorSize, alignment,
+                                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
     }
 }
 
@@ -1400,15 +2258,20 @@ void VulkanRenderer::CreateDescriptorPool()
     // CREATE UNIFORM DESCRIPTOR POOL
     // Type of decriptors + how many DESCRIPTORS, not Descriptor Sets (combined makes the pool size)
     VkDescriptorPoolSize vpPoolSize = {};
-    vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    vpPoolSize.descriptorCount = static_cast<uint32_t>(m_vpUniformBuffer.size());
+    vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    vpPoolSize.descriptorCount = static_cast<uint32_t>(m_frameAllocators.size());
 
-    // // Model Pool (DYNAMIC)
-    // VkDescriptorPoolSize modelPoolSize = {};
-    // modelPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    // modelPoolSize.descriptorCount = static_cast<uint32_t>(m_modelDynUniformBuffer.size());
+    // Model transforms Pool
+    VkDescriptorPoolSize modelPoolSize = {};
+    modelPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    modelPoolSize.descriptorCount = static_cast<uint32_t>(m_frameAllocators.size());
 
-    std::vector<VkDescriptorPoolSize> descriptorPoolSizes = {vpPoolSize};
+    // Draws Pool
+    VkDescriptorPoolSize drawPoolSize = {};
+    drawPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    drawPoolSize.descriptorCount = static_cast<uint32_t>(m_frameAllocators.size());
+
+    std::vector<VkDescriptorPoolSize> descriptorPoolSizes = {vpPoolSize, modelPoolSize, drawPoolSize};
 
     // Data to create Descriptor Pool
     VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
@@ -1424,22 +2287,85 @@ void VulkanRenderer::CreateDescriptorPool()
         throw std::runtime_error("Failed to create Descriptor Pool");
     }
 
-    // CREATE SAMPLER DESCRIPTOR POOL
-    // Texture Sampler Pool
-    VkDescriptorPoolSize samplerPoolSize = {};
-    samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerPoolSize.descriptorCount = MAX_OBJECTS;
+    if (m_bindless)
+    {
+        // CREATE BINDLESS TEXTURE DESCRIPTOR POOL
+        // Holds the one texture set, an element is written as each texture is created
+        VkDescriptorPoolSize bindlessPoolSize = {};
+        bindlessPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindlessPoolSize.descriptorCount = m_bindlessTextureCount;
+
+        VkDescriptorPoolCreateInfo bindlessPoolCreateInfo = {};
+        bindlessPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        bindlessPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT; // Set layout is update after bind
+        bindlessPoolCreateInfo.maxSets = 1;
+        bindlessPoolCreateInfo.poolSizeCount = 1;
+        bindlessPoolCreateInfo.pPoolSizes = &bindlessPoolSize;
+
+        result = vkCreateDescriptorPool(m_mainDevice.logicalDevice, &bindlessPoolCreateInfo, nullptr, &m_bindlessDescriptorPool);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create Bindless Texture Descriptor Pool");
+        }
+
+        VkDescriptorSetAllocateInfo bindlessAllocInfo = {};
+        bindlessAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        bindlessAllocInfo.descriptorPool = m_bindlessDescriptorPool;
+        bindlessAllocInfo.descriptorSetCount = 1;
+        bindlessAllocInfo.pSetLayouts = &m_samplerSetLayout;
+
+        result = vkAllocateDescriptorSets(m_mainDevice.logicalDevice, &bindlessAllocInfo, &m_bindlessDescriptorSet);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate Bindless Texture Descriptor Set");
+        }
+    }
+    else
+    {
+        // CREATE SAMPLER DESCRIPTOR ALLOCATOR
+        // One combined image sampler per texture set, written from a single VkDescriptorImageInfo
+        VkDescriptorPoolSize samplerSetSize = {};
+        samplerSetSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        samplerSetSize.descriptorCount = 1;
+
+        VkDescriptorUpdateTemplateEntry samplerEntry = {};
+        samplerEntry.dstBinding = 0;
+        samplerEntry.dstArrayElement = 0;
+        samplerEntry.descriptorCount = 1;
+        samplerEntry.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        samplerEntry.offset = 0;
+        samplerEntry.stride = sizeof(VkDescriptorImageInfo);
+
+        // First pool holds 64 textures, each one added after it twice as many as the one before
+        m_samplerDescriptorAllocator.Init(m_mainDevice.logicalDevice, m_samplerSetLayout, {samplerSetSize}, {samplerEntry}, 64,
+                                          m_descriptorTemplateFunctions);
+    }
+
+    if (!m_gpuDriven)
+    {
+        return;
+    }
+
+    // CREATE CULL DESCRIPTOR POOL
+    // Per image: cull data, model transforms, then draws, indirect commands and draw counts
+    std::array<VkDescriptorPoolSize, 3> cullPoolSizes = {};
+    cullPoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    cullPoolSizes[0].descriptorCount = static_cast<uint32_t>(m_swapChainImages.size());
+    cullPoolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    cullPoolSizes[1].descriptorCount = static_cast<uint32_t>(m_swapChainImages.size());
+    cullPoolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    cullPoolSizes[2].descriptorCount = static_cast<uint32_t>(m_swapChainImages.size()) * 3;
 
-    VkDescriptorPoolCreateInfo samplerPoolCreateInfo = {};
-    samplerPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    samplerPoolCreateInfo.maxSets = MAX_OBJECTS;
-    samplerPoolCreateInfo.poolSizeCount = 1;
-    samplerPoolCreateInfo.pPoolSizes = &samplerPoolSize;
+    VkDescriptorPoolCreateInfo cullPoolCreateInfo = {};
+    cullPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    cullPoolCreateInfo.maxSets = static_cast<uint32_t>(m_swapChainImages.size());
+    cullPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(cullPoolSizes.size());
+    cullPoolCreateInfo.pPoolSizes = cullPoolSizes.data();
 
-    result = vkCreateDescriptorPool(m_mainDevice.logicalDevice, &samplerPoolCreateInfo, nullptr, &m_samplerDescriptorPool);
+    result = vkCreateDescriptorPool(m_mainDevice.logicalDevice, &cullPoolCreateInfo, nullptr, &m_cullDescriptorPool);
     if (result != VK_SUCCESS)
     {
-        throw std::runtime_error("Failed to create Sampler Descriptor Pool");
+        throw std::runtime_error("Failed to create Cull Descriptor Pool");
     }
 }
 
@@ -1470,266 +2396,1046 @@ void VulkanRenderer::CreateDescriptorSets()
         // VIEW PROJECTION DESCRIPTOR
         // Buffer info and offset info
         VkDescriptorBufferInfo vpBufferInfo = {};
-        vpBufferInfo.buffer = m_vpUniformBuffer[i];     // Buffer to get data from
-        vpBufferInfo.offset = 0;                        // Position of start of data
-        vpBufferInfo.range = sizeof(UBOViewProjection); // Size of data
+        vpBufferInfo.buffer = m_frameAllocators[i].GetBuffer(); // Buffer to get data from
+        vpBufferInfo.offset = 0;                                // Position of start of data (dynamic offset is added when binding)
+        vpBufferInfo.range = sizeof(UBOViewProjection);         // Size of data
 
         // Data about connection between binding and buffer
         VkWriteDescriptorSet vpSetWrite = {};
         vpSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        vpSetWrite.dstSet = m_descriptorSets[i];                       // Descriptor Set to update
-        vpSetWrite.dstBinding = 0;                                     // Binding to update (matches with binding on layout/shader)
-        vpSetWrite.dstArrayElement = 0;                                // Index in array to update
-        vpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Type of descriptor
-        vpSetWrite.descriptorCount = 1;                                // Amount to update
-        vpSetWrite.pBufferInfo = &vpBufferInfo;                        // Information about buffer data to bind
-
-        // // MODEL DESCRIPTOR
-        // // Model Buffer Binding info
-        // VkDescriptorBufferInfo modelBufferInfo = {};
-        // modelBufferInfo.buffer = m_modelDynUniformBuffer[i];
-        // modelBufferInfo.offset = 0;
-        // modelBufferInfo.range = m_modelUniformAlignment;
-
-        // VkWriteDescriptorSet modelSetWrite = {};
-        // modelSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        // modelSetWrite.dstSet = m_descriptorSets[i];
-        // modelSetWrite.dstBinding = 1;
-        // modelSetWrite.dstArrayElement = 0;
-        // modelSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-        // modelSetWrite.descriptorCount = 1;
-        // modelSetWrite.pBufferInfo = &modelBufferInfo;
+        vpSetWrite.dstSet = m_descriptorSets[i];                               // Descriptor Set to update
+        vpSetWrite.dstBinding = 0;                                             // Binding to update (matches with binding on layout/shader)
+        vpSetWrite.dstArrayElement = 0;                                        // Index in array to update
+        vpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Type of descriptor
+        vpSetWrite.descriptorCount = 1;                                        // Amount to update
+        vpSetWrite.pBufferInfo = &vpBufferInfo;                                // Information about buffer data to bind
+
+        // MODEL TRANSFORMS DESCRIPTOR
+        // Model Buffer Binding info
+        VkDescriptorBufferInfo modelBufferInfo = {};
+        modelBufferInfo.buffer = m_frameAllocators[i].GetBuffer();
+        modelBufferInfo.offset = 0;
+        modelBufferInfo.range = sizeof(Model) * (MAX_MODELS + MAX_INSTANCES);
+
+        VkWriteDescriptorSet modelSetWrite = {};
+        modelSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        modelSetWrite.dstSet = m_descriptorSets[i];
+        modelSetWrite.dstBinding = 1;
+        modelSetWrite.dstArrayElement = 0;
+        modelSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        modelSetWrite.descriptorCount = 1;
+        modelSetWrite.pBufferInfo = &modelBufferInfo;
 
         // List of Descriptor Set Writes
-        std::vector<VkWriteDescriptorSet> setWrites = {vpSetWrite};
+        std::vector<VkWriteDescriptorSet> setWrites = {vpSetWrite, modelSetWrite};
 
         // Update the descirptor sets with new buffer/binding info
         vkUpdateDescriptorSets(m_mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
     }
-}
 
-void VulkanRenderer::UpdateUniformBuffers(uint32_t imageIndex)
-{
-    // Copy VP data
-    void *data;
-    vkMapMemory(m_mainDevice.logicalDevice, m_vpUniformBufferMemory[imageIndex], 0, sizeof(UBOViewProjection), 0, &data);
-    memcpy(data, &m_uboViewProjection, sizeof(UBOViewProjection));
-    vkUnmapMemory(m_mainDevice.logicalDevice, m_vpUniformBufferMemory[imageIndex]);
+    if (!m_gpuDriven)
+    {
+        return;
+    }
+
+    // Cull sets read the same frame allocator slices (draw bindings are written with the draw buffers)
+    m_cullDescriptorSets.resize(m_swapChainImages.size());
 
-#if 0 // Dynamic Uniform Buffer, Using Push constants instead
-    // Copy Model data
-    for (size_t i = 0; i < m_meshList.size(); i++)
+    std::vector<VkDescriptorSetLayout> cullSetLayouts(m_swapChainImages.size(), m_cullSetLayout);
+
+    VkDescriptorSetAllocateInfo cullSetAllocInfo = {};
+    cullSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    cullSetAllocInfo.descriptorPool = m_cullDescriptorPool;
+    cullSetAllocInfo.descriptorSetCount = static_cast<uint32_t>(m_swapChainImages.size());
+    cullSetAllocInfo.pSetLayouts = cullSetLayouts.data();
+
+    result = vkAllocateDescriptorSets(m_mainDevice.logicalDevice, &cullSetAllocInfo, m_cullDescriptorSets.data());
+    if (result != VK_SUCCESS)
     {
-        Model *thisModel = (Model *)((uint64_t)m_modelTransferSpace + (i * m_modelUniformAlignment));
-        *thisModel = m_meshList[i].GetModel();
+        throw std::runtime_error("Failed to allocate Cull Descriptor Sets");
     }
 
-    // Map the list of model data
-    vkMapMemory(m_mainDevice.logicalDevice, m_modelDynUniformBufferMemory[imageIndex], 0, m_modelUniformAlignment * m_meshList.size(), 0, &data);
-    memcpy(data, m_modelTransferSpace, m_modelUniformAlignment * m_meshList.size());
-    vkUnmapMemory(m_mainDevice.logicalDevice, m_modelDynUniformBufferMemory[imageIndex]);
-#endif
+    for (size_t i = 0; i < m_swapChainImages.size(); i++)
+    {
+        std::array<VkDescriptorBufferInfo, 2> bufferInfos = {};
+        bufferInfos[0].buffer = m_frameAllocators[i].GetBuffer();
+        bufferInfos[0].offset = 0;
+        bufferInfos[0].range = sizeof(CullData);
+        bufferInfos[1].buffer = m_frameAllocators[i].GetBuffer();
+        bufferInfos[1].offset = 0;
+        bufferInfos[1].range = sizeof(Model) * (MAX_MODELS + MAX_INSTANCES);
+
+        std::array<VkWriteDescriptorSet, 2> setWrites = {};
+        for (uint32_t j = 0; j < setWrites.size(); j++)
+        {
+            setWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            setWrites[j].dstSet = m_cullDescriptorSets[i];
+            setWrites[j].dstBinding = j;
+            setWrites[j].dstArrayElement = 0;
+            setWrites[j].descriptorType = j == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+            setWrites[j].descriptorCount = 1;
+            setWrites[j].pBufferInfo = &bufferInfos[j];
+        }
+
+        vkUpdateDescriptorSets(m_mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+    }
 }
 
-void VulkanRenderer::UpdateModel(size_t modelID, glm::mat4 newModel)
+void VulkanRenderer::CreateDrawBuffers(size_t imageIndex, uint32_t drawCapacity, uint32_t groupCapacity)
 {
-    if (modelID < m_meshModels.size())
+    // Every buffer here is only used by the image's own frames
+    size_t imageCount = m_swapChainImages.size();
+    m_drawBuffers.resize(imageCount);
+    m_drawBufferMemorys.resize(imageCount);
+    m_drawCapacities.resize(imageCount);
+    m_groupCapacities.resize(imageCount);
+    m_drawsDirty.resize(imageCount);
+
+    m_drawCapacities[imageIndex] = drawCapacity;
+    m_groupCapacities[imageIndex] = groupCapacity;
+    m_drawsDirty[imageIndex] = true;
+
+    // Draws are only rewritten once the image's last frame has finished (see UpdateDraws), host visible memory is enough.
+    // The vertex shader's set always binds them, they are only read in GPU-driven rendering
+    CreateBuffer(&m_memoryAllocator, sizeof(GpuDraw) * drawCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &m_drawBuffers[imageIndex], &m_drawBufferMemorys[imageIndex]);
+
+    VkDescriptorBufferInfo drawBufferInfo = {};
+    drawBufferInfo.buffer = m_drawBuffers[imageIndex];
+    drawBufferInfo.offset = 0;
+    drawBufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet drawSetWrite = {};
+    drawSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    drawSetWrite.dstSet = m_descriptorSets[imageIndex];
+    drawSetWrite.dstBinding = 2;
+    drawSetWrite.dstArrayElement = 0;
+    drawSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    drawSetWrite.descriptorCount = 1;
+    drawSetWrite.pBufferInfo = &drawBufferInfo;
+
+    vkUpdateDescriptorSets(m_mainDevice.logicalDevice, 1, &drawSetWrite, 0, nullptr);
+
+    if (!m_gpuDriven)
     {
-        m_meshModels[modelID].SetModel(newModel);
+        return;
     }
-}
 
-void VulkanRenderer::AllocateDynamicBufferTransferSpace()
-{
-#if 0 // Dynamic Uniform Buffers are not used anymore, using push constants instead
-    // Calculate allignment of model data
-    m_modelUniformAlignment = (sizeof(Model) + m_minUniformBufferOffset - 1) & ~(m_minUniformBufferOffset - 1);
+    // Written by the cull pass and read by the indirect draws of the same frame
+    m_indirectCommandBuffers.resize(imageCount);
+    m_indirectCommandBufferMemorys.resize(imageCount);
+    m_drawCountBuffers.resize(imageCount);
+    m_drawCountBufferMemorys.resize(imageCount);
 
-    // Create space in memory to hold dynamic buffer that is aligned to our required alignement and hold MAX_OBJECTS
-    m_modelTransferSpace = (Model *)aligned_alloc(m_modelUniformAlignment, m_modelUniformAlignment * MAX_OBJECTS);
-#endif
-}
+    // TRANSFER_DST: cleared before each cull pass
+    CreateBuffer(&m_memoryAllocator, sizeof(VkDrawIndexedIndirectCommand) * drawCapacity,
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 &m_indirectCommandBuffers[imageIndex], &m_indirectCommandBufferMemorys[imageIndex]);
 
-void VulkanRenderer::CreatePushConstantRange()
-{
-    // Define Push Constant values (no 'create' needed!)
-    m_pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // Shader stage push constant will go to
-    m_pushConstantRange.offset = 0;                              // Offset into given data to push constant
-    m_pushConstantRange.size = sizeof(Model);                    // Size of data being passed
-}
+    // Host visible so the survivors can be counted for statistics once the frame has finished
+    CreateBuffer(&m_memoryAllocator, sizeof(uint32_t) * groupCapacity,
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &m_drawCountBuffers[imageIndex], &m_drawCountBufferMemorys[imageIndex]);
+    memset(m_drawCountBufferMemorys[imageIndex].mapped, 0, sizeof(uint32_t) * groupCapacity);
 
-void VulkanRenderer::CreateDepthBufferImage()
-{
-    // Get supported format for depth buffer
-    m_depthFormat = ChooseSupportedFormat({VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT},
-                                          VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    std::array<VkDescriptorBufferInfo, 3> bufferInfos = {};
+    bufferInfos[0].buffer = m_drawBuffers[imageIndex];
+    bufferInfos[1].buffer = m_indirectCommandBuffers[imageIndex];
+    bufferInfos[2].buffer = m_drawCountBuffers[imageIndex];
 
-    // Create Depth Buffer Image
-    m_depthBufferImage = CreateImage(m_swapChainExtent.width, m_swapChainExtent.height, m_depthFormat, VK_IMAGE_TILING_OPTIMAL,
-                                     VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_depthBufferImageMemory);
+    std::array<VkWriteDescriptorSet, 3> setWrites = {};
+    for (uint32_t j = 0; j < setWrites.size(); j++)
+    {
+        bufferInfos[j].offset = 0;
+        bufferInfos[j].range = VK_WHOLE_SIZE;
 
-    m_depthBufferImageView = CreateImageView(m_depthBufferImage, m_depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+        setWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        setWrites[j].dstSet = m_cullDescriptorSets[imageIndex];
+        setWrites[j].dstBinding = 2 + j;
+        setWrites[j].dstArrayElement = 0;
+        setWrites[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        setWrites[j].descriptorCount = 1;
+        setWrites[j].pBufferInfo = &bufferInfos[j];
+    }
+
+    vkUpdateDescriptorSets(m_mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
 }
 
-VkImage VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
-                                    VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propFlags,
-                                    VkDeviceMemory *imageMemory)
+void VulkanRenderer::DestroyDrawBuffers(size_t imageIndex)
 {
-    // CREATE IMAGE
-    // Image Create Info
-    VkImageCreateInfo imageCreateInfo = {};
-    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;              // Type of Image (1D, 2D or 3D)
-    imageCreateInfo.extent.width = width;                      // Width of Image extent
-    imageCreateInfo.extent.height = height;                    // Height of Image extent
-    imageCreateInfo.extent.depth = 1;                          // Depth of Image (just 1, no 3D aspect)
-    imageCreateInfo.mipLevels = 1;                             // No of mipmap levels
-    imageCreateInfo.arrayLayers = 1;                           //No of levels in large array
-    imageCreateInfo.format = format;                           // Format type of image
-    imageCreateInfo.tiling = tiling;                           // How large data should be "tiled" (arranged for optimal reading speed)
-    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // Layout for imgage data on creation
-    imageCreateInfo.usage = usageFlags;                        // Bit flags defining what image will be used for
-    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;           // No of samples for multi-sampling
-    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;   // Whether the image can be shared between queues
+    vkDestroyBuffer(m_mainDevice.logicalDevice, m_drawBuffers[imageIndex], nullptr);
+    m_drawBuffers[imageIndex] = nullptr;
+    m_memoryAllocator.Free(m_drawBufferMemorys[imageIndex]);
 
-    // CREATE MEMORY FOR IMAGE
-    VkImage image;
-    VkResult result = vkCreateImage(m_mainDevice.logicalDevice, &imageCreateInfo, nullptr, &image);
-    if (result != VK_SUCCESS)
+    if (imageIndex < m_indirectCommandBuffers.size())
     {
-        throw std::runtime_error("Failed to create an image");
+        vkDestroyBuffer(m_mainDevice.logicalDevice, m_indirectCommandBuffers[imageIndex], nullptr);
+        m_indirectCommandBuffers[imageIndex] = nullptr;
+        m_memoryAllocator.Free(m_indirectCommandBufferMemorys[imageIndex]);
+
+        vkDestroyBuffer(m_mainDevice.logicalDevice, m_drawCountBuffers[imageIndex], nullptr);
+        m_drawCountBuffers[imageIndex] = nullptr;
+        m_memoryAllocator.Free(m_drawCountBufferMemorys[imageIndex]);
     }
+}
 
-    // CREATE MEMORY FOR IMAGE
+void VulkanRenderer::UpdateUniformBuffers(uint32_t imageIndex)
+{
+    // Frame that last drew to this image has finished (waited on in Draw), its data can be overwritten
+    FrameAllocator &frameAllocator = m_frameAllocators[imageIndex];
+    frameAllocator.Reset();
 
-    // Get memory requirements for a type of image
-    VkMemoryRequirements memoryRequirements;
-    vkGetImageMemoryRequirements(m_mainDevice.logicalDevice, image, &memoryRequirements);
+    // Copy VP data (frame allocator stays mapped)
+    FrameAllocation vpAllocation = frameAllocator.Allocate(sizeof(UBOViewProjection));
+    memcpy(vpAllocation.mapped, &m_uboViewProjection, sizeof(UBOViewProjection));
 
-    VkMemoryAllocateInfo memoryAllocInfo = {};
-    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memoryAllocInfo.allocationSize = memoryRequirements.size;
-    memoryAllocInfo.memoryTypeIndex = FindMemoryTypeIndex(m_mainDevice.physicalDevice, memoryRequirements.memoryTypeBits, propFlags);
+    // Transforms of the live model slots, then the instance transforms. Only that much is allocated, the rest of the
+    // descriptor's range is never read. Draws reading past the model slots are baked into recorded command buffers and
+    // the draw buffer, both are rewritten when a model is created
+    size_t modelCount = m_meshModels.size();
+    size_t instanceCount = m_gpuDriven ? m_instances.size() : m_instanceTransforms.size();
+    FrameAllocation modelAllocation = frameAllocator.Allocate(sizeof(Model) * (modelCount + instanceCount));
+    Model *models = static_cast<Model *>(modelAllocation.mapped);
 
-    result = vkAllocateMemory(m_mainDevice.logicalDevice, &memoryAllocInfo, nullptr, imageMemory);
-    if (result != VK_SUCCESS)
+    // Copy Model transforms, slot j is read by the draws of model j (push constants are used instead without cached
+    // command buffers, but instanced draws still find their model's transform here)
+    for (size_t i = 0; i < modelCount; i++)
     {
-        throw std::runtime_error("Failed to allocate memory for image");
+        models[i].model = m_meshModels[i].GetModel();
     }
 
-    // Connect memory to image
-    vkBindImageMemory(m_mainDevice.logicalDevice, image, *imageMemory, 0);
-
-    return image;
-}
-
-VkFormat VulkanRenderer::ChooseSupportedFormat(const std::vector<VkFormat> &formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags)
-{
-    // Loop through options and find compatible one
-    for (VkFormat format : formats)
+    if (m_gpuDriven)
     {
-        // Get properties for given format on this device
-        VkFormatProperties properties;
-        vkGetPhysicalDeviceFormatProperties(m_mainDevice.physicalDevice, format, &properties);
-
-        // Depending on tiling choice, need to check for different feature flags
-        if ((tiling == VK_IMAGE_TILING_LINEAR) && (properties.linearTilingFeatures & featureFlags))
+        // Every instance has draws of its own, reading the slot of its id past the model slots
+        for (size_t i = 0; i < instanceCount; i++)
         {
-            return format;
+            models[modelCount + i].model = m_instances[i].transform;
         }
-        else if ((tiling == VK_IMAGE_TILING_OPTIMAL) && (properties.optimalTilingFeatures & featureFlags))
+    }
+    else
+    {
+        // Visible copies of instanced models, in the ranges culling put them in
+        for (size_t i = 0; i < instanceCount; i++)
         {
-            return format;
+            models[modelCount + i].model = m_instanceTransforms[i];
         }
     }
 
-    throw std::runtime_error("Failed to find a matching format");
-}
-
-stbi_uc *VulkanRenderer::LoadTexture(const std::string filename, int *width, int *height, VkDeviceSize *imageSize)
-{
-    // Number of channels image uses
-    int channels;
-
-    // Load pixel data for image
-    const std::string fileLoc = "Textures/" + filename;
-    stbi_uc *image = stbi_load(fileLoc.c_str(), width, height, &channels, STBI_rgb_alpha);
-    if (image == nullptr)
+    // Offsets are baked into recorded command buffers, re-record if they moved
+    std::array<uint32_t, 2> frameOffsets = {vpAllocation.offset, modelAllocation.offset};
+    if (frameOffsets != m_frameOffsets[imageIndex])
     {
-        throw std::runtime_error("Failed to load a Texture file! (" + filename + ")");
+        m_frameOffsets[imageIndex] = frameOffsets;
+        m_commandBufferDirty[imageIndex] = true;
     }
 
-    // Calculate image size using given and known data
-    *imageSize = *width * *height * 4;
+    if (m_gpuDriven)
+    {
+        // View frustum and camera of this frame for the cull pass
+        FrameAllocation cullAllocation = frameAllocator.Allocate(sizeof(CullData));
+        CullData *cullData = static_cast<CullData *>(cullAllocation.mapped);
+        FrustumCuller::ExtractPlanes(m_uboViewProjection.projection * m_uboViewProjection.view, cullData->planes);
+        cullData->cameraPosition = glm::vec4(glm::vec3(glm::inverse(m_uboViewProjection.view)[3]),
+                                             std::abs(m_uboViewProjection.projection[1][1]) * 0.5f * m_swapChainExtent.height);
+        cullData->lodErrorPixels = m_settings.lodErrorPixels;
+        cullData->drawCount = m_drawCount;
+        cullData->frustumCulling = m_settings.frustumCulling ? 1 : 0;
 
-    return image;
+        if (cullAllocation.offset != m_cullDataOffsets[imageIndex])
+        {
+            m_cullDataOffsets[imageIndex] = cullAllocation.offset;
+            m_commandBufferDirty[imageIndex] = true;
+        }
+    }
 }
 
-int VulkanRenderer::CreateTextureImage(const std::string fileName)
+void VulkanRenderer::CullMeshes()
 {
-    // Load image file
-    int width, height;
-    VkDeviceSize imageSize;
+    // Visible models, then instances, in slot order, so cached command buffers only need recording again when the set changes
+    std::swap(m_visibleProxies, m_lastVisibleProxies);
+    m_visibleProxies.clear();
 
-    stbi_uc *imageData = LoadTexture(fileName, &width, &height, &imageSize);
+    if (m_settings.frustumCulling)
+    {
+        glm::vec4 planes[6];
+        FrustumCuller::ExtractPlanes(m_uboViewProjection.projection * m_uboViewProjection.view, planes);
+        m_sceneTree.QueryFrustum(planes, m_visibleProxies);
+        std::sort(m_visibleProxies.begin(), m_visibleProxies.end());
+    }
+    else
+    {
+        for (size_t i = 0; i < m_modelProxies.size(); i++)
+        {
+            if (m_modelProxies[i] != SceneTree::NULL_NODE)
+            {
+                m_visibleProxies.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        for (size_t i = 0; i < m_instances.size(); i++)
+        {
+            if (m_instances[i].proxy != SceneTree::NULL_NODE)
+            {
+                m_visibleProxies.push_back(INSTANCE_PROXY_BIT | static_cast<uint32_t>(i));
+            }
+        }
+    }
 
-    // Create staging buffer to hold loaded data, ready to copy to device
-    VkBuffer imageStagingBuffer;
-    VkDeviceMemory imageStagingBufferMemory;
-    CreateBuffer(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &imageStagingBuffer, &imageStagingBufferMemory);
+    bool changed = m_visibleProxies != m_lastVisibleProxies;
 
-    // Copy image data to staging buffer
-    void *data;
-    vkMapMemory(m_mainDevice.logicalDevice, imageStagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, imageData, static_cast<size_t>(imageSize));
-    vkUnmapMemory(m_mainDevice.logicalDevice, imageStagingBufferMemory);
+    // A model is drawn if it or one of its instances is visible, count the visible copies of each
+    m_instanceRanges.assign(m_meshModels.size(), {});
+    for (uint32_t proxy : m_visibleProxies)
+    {
+        size_t modelID = (proxy & INSTANCE_PROXY_BIT) ? m_instances[proxy & ~INSTANCE_PROXY_BIT].modelID : proxy;
+        m_instanceRanges[modelID].count++;
+    }
 
-    // Free original image data
-    stbi_image_free(imageData);
+    // Instanced models get a range of the instance transforms for their copies
+    m_visibleModels.clear();
+    uint32_t instanceTransformCount = 0;
+    for (size_t i = 0; i < m_instanceRanges.size(); i++)
+    {
+        if (m_instanceRanges[i].count == 0)
+        {
+            continue;
+        }
 
-    // Create image to hold final texture
-    VkImage texImage;
-    VkDeviceMemory texImageMemory;
-    texImage = CreateImage(width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-                           VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texImageMemory);
+        m_visibleModels.push_back(static_cast<uint32_t>(i));
+        if (!m_modelInstances[i].empty())
+        {
+            m_instanceRanges[i].first = instanceTransformCount;
+            instanceTransformCount += m_instanceRanges[i].count;
+            m_instanceRanges[i].count = 0;
+        }
+    }
 
-    // COPY DATA TO IMAGE
-    // Transition image to be DST for copy operation
-    TransitionImageLayout(m_mainDevice.logicalDevice, m_graphicsQueue, m_graphicsCommandPool, texImage,
-                          VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    // Models come before instances, so the model itself (if visible) is the first copy of its range
+    m_instanceTransforms.resize(instanceTransformCount);
+    for (uint32_t proxy : m_visibleProxies)
+    {
+        if (proxy & INSTANCE_PROXY_BIT)
+        {
+            const ModelInstance &instance = m_instances[proxy & ~INSTANCE_PROXY_BIT];
+            InstanceRange &range = m_instanceRanges[instance.modelID];
+            m_instanceTransforms[range.first + range.count++] = instance.transform;
+        }
+        else if (!m_modelInstances[proxy].empty())
+        {
+            InstanceRange &range = m_instanceRanges[proxy];
+            m_instanceTransforms[range.first + range.count++] = m_meshModels[proxy].GetModel();
+        }
+    }
+
+    // Meshes of the visible models only, storage only grows with their count so this doesn't allocate from frame to frame.
+    // Instanced models draw every mesh for all their visible copies, so their meshes aren't culled one by one
+    size_t meshCount = 0;
+    uint32_t visibleCount = 0;
+    for (uint32_t modelID : m_visibleModels)
+    {
+        MeshModel &model = m_meshModels[modelID];
+        if (m_modelInstances[modelID].empty())
+        {
+            meshCount += model.GetMeshCount();
+            continue;
+        }
+
+        visibleCount += model.GetMeshCount() * m_instanceRanges[modelID].count;
+        for (uint32_t i = 0; i < model.GetMeshCount(); i++)
+        {
+            Mesh *mesh = model.GetMesh(i);
+            if (!mesh->IsVisible())
+            {
+                mesh->SetVisible(true);
+                changed = true;
+            }
+        }
+    }
+
+    if (!m_settings.frustumCulling)
+    {
+        visibleCount += static_cast<uint32_t>(meshCount);
+    }
+    else
+    {
+        m_frustumCuller.Resize(meshCount);
 
-    // Copy image data
-    CopyImageBuffer(m_mainDevice.logicalDevice, m_graphicsQueue, m_graphicsCommandPool, imageStagingBuffer, texImage, width, height);
+        size_t box = 0;
+        for (uint32_t modelID : m_visibleModels)
+        {
+            MeshModel &model = m_meshModels[modelID];
+            if (!m_modelInstances[modelID].empty())
+            {
+                continue;
+            }
+
+            glm::mat4 transform = model.GetModel();
+            for (uint32_t i = 0; i < model.GetMeshCount(); i++)
+            {
+                Mesh *mesh = model.GetMesh(i);
+                m_frustumCuller.SetBox(box++, transform, mesh->GetBoundsMin(), mesh->GetBoundsMax());
+            }
+        }
 
-    TransitionImageLayout(m_mainDevice.logicalDevice, m_graphicsQueue, m_graphicsCommandPool, texImage,
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        visibleCount += m_frustumCuller.Cull(m_uboViewProjection.projection * m_uboViewProjection.view);
+
+        box = 0;
+        for (uint32_t modelID : m_visibleModels)
+        {
+            MeshModel &model = m_meshModels[modelID];
+            if (!m_modelInstances[modelID].empty())
+            {
+                continue;
+            }
+
+            for (uint32_t i = 0; i < model.GetMeshCount(); i++)
+            {
+                Mesh *mesh = model.GetMesh(i);
+                bool visible = m_frustumCuller.IsVisible(box++);
+                if (visible != mesh->IsVisible())
+                {
+                    mesh->SetVisible(visible);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    m_cullStatistics.visibleModels = static_cast<uint32_t>(m_visibleProxies.size());
+    m_cullStatistics.culledModels = static_cast<uint32_t>(m_sceneTree.GetProxyCount() - m_visibleProxies.size());
+    m_cullStatistics.visibleMeshes = visibleCount;
+    m_cullStatistics.culledMeshes = static_cast<uint32_t>(m_meshCount) - visibleCount;
+
+    // Draws are recorded only for visible models and meshes
+    if (changed && m_settings.cacheCommandBuffers)
+    {
+        InvalidateCommandBuffers();
+    }
+}
+
+void VulkanRenderer::SelectLods()
+{
+    // Pixels covered by one unit at distance one, vertically
+    const float pixelsPerUnit = std::abs(m_uboViewProjection.projection[1][1]) * 0.5f * m_swapChainExtent.height;
+    bool changed = false;
+
+    for (uint32_t modelID : m_visibleModels)
+    {
+        MeshModel &model = m_meshModels[modelID];
+
+        // Copies of an instanced model are drawn together, so at the level the closest of them needs
+        glm::mat4 modelTransform = model.GetModel();
+        const glm::mat4 *transforms = &modelTransform;
+        uint32_t transformCount = 1;
+        if (!m_modelInstances[modelID].empty())
+        {
+            transforms = &m_instanceTransforms[m_instanceRanges[modelID].first];
+            transformCount = m_instanceRanges[modelID].count;
+        }
+
+        for (uint32_t i = 0; i < model.GetMeshCount(); i++)
+        {
+            Mesh *mesh = model.GetMesh(i);
+            glm::vec4 sphere = mesh->GetBoundingSphere();
+            if (!mesh->IsVisible() || mesh->GetLodCount() <= 1 || sphere.w <= 0.0f)
+            {
+                continue;
+            }
 
-    // Add texture data to vector for reference
-    m_textureImages.push_back(texImage);
-    m_textureImageMemorys.push_back(texImageMemory);
+            uint32_t selected = mesh->GetLodCount() - 1;
+            for (uint32_t t = 0; t < transformCount && selected > 0; t++)
+            {
+                glm::mat4 modelView = m_uboViewProjection.view * transforms[t];
+                // Largest scale of the transform, the sphere must still enclose the mesh
+                float scale = std::max({glm::length(glm::vec3(modelView[0])), glm::length(glm::vec3(modelView[1])),
+                                        glm::length(glm::vec3(modelView[2]))});
+
+                glm::vec3 center = glm::vec3(modelView * glm::vec4(glm::vec3(sphere), 1.0f));
+                float radius = sphere.w * scale;
+                float distance = glm::length(center);
+
+                // Coarsest level whose error, scaled like the sphere, stays under the pixel threshold (full detail when inside the sphere)
+                uint32_t copySelected = 0;
+                if (distance > radius)
+                {
+                    float projectedRadius = radius / std::sqrt(distance * distance - radius * radius) * pixelsPerUnit;
+                    for (uint32_t lod = selected; lod > 0; lod--)
+                    {
+                        if (mesh->GetLod(lod).error / sphere.w * projectedRadius <= m_settings.lodErrorPixels)
+                        {
+                            copySelected = lod;
+                            break;
+                        }
+                    }
+                }
+                selected = std::min(selected, copySelected);
+            }
 
-    // Destroy staging buffers
-    vkDestroyBuffer(m_mainDevice.logicalDevice, imageStagingBuffer, nullptr);
-    vkFreeMemory(m_mainDevice.logicalDevice, imageStagingBufferMemory, nullptr);
+            if (selected != mesh->GetSelectedLod())
+            {
+                mesh->SetSelectedLod(selected);
+                changed = true;
+            }
+        }
+    }
 
-    // Return index of new texture image
-    return m_textureImages.size() - 1;
+    // Index ranges are recorded into the command buffers
+    if (changed && m_settings.cacheCommandBuffers)
+    {
+        InvalidateCommandBuffers();
+    }
 }
 
-int VulkanRenderer::CreateTexture(const std::string fileName)
+void VulkanRenderer::UpdateDraws(uint32_t imageIndex)
 {
-    // Create Texture image and get its location in array
-    int textureImageLoc = CreateTextureImage(fileName);
+    // Survivors of the cull pass the last time this image was drawn (its fence has signalled since). Groups may have
+    // changed since, the count buffer only holds those it had room for
+    const uint32_t *drawCounts = static_cast<const uint32_t *>(m_drawCountBufferMemorys[imageIndex].mapped);
+    size_t countedGroups = std::min<size_t>(m_drawGroups.size(), m_groupCapacities[imageIndex]);
+    uint32_t visibleCount = 0;
+    for (size_t i = 0; i < countedGroups; i++)
+    {
+        visibleCount += drawCounts[i];
+    }
+    visibleCount = std::min(visibleCount, m_drawCount);
+
+    // Meshes are culled one by one, models aren't culled as a whole
+    m_cullStatistics.visibleModels = static_cast<uint32_t>(m_sceneTree.GetProxyCount());
+    m_cullStatistics.culledModels = 0;
+    m_cullStatistics.visibleMeshes = visibleCount;
+    m_cullStatistics.culledMeshes = m_drawCount - visibleCount;
+
+    if (!m_drawsDirty[imageIndex])
+    {
+        return;
+    }
+
+    // Every image has draws of its own. Draw has already waited for the fence of the image's last frame, so its
+    // buffers are free to rewrite or grow while the other images' frames are still in flight
 
-    // Create Image view and add to list
-    VkImageView imageView = CreateImageView(m_textureImages[textureImageLoc], VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-    m_textureImageViews.push_back(imageView);
+    // One group per texture slot, whether or not a mesh uses it. Bindless textures are indexed per draw, so one group draws every mesh
+    uint32_t groupCount = m_bindless ? 1 : static_cast<uint32_t>(m_textureImages.size());
+    uint32_t drawCapacity = m_drawCapacities[imageIndex];
+    uint32_t groupCapacity = m_groupCapacities[imageIndex];
+    if (m_meshCount > drawCapacity || groupCount > groupCapacity)
+    {
+        if (m_meshCount > drawCapacity)
+        {
+            drawCapacity = std::max(static_cast<uint32_t>(m_meshCount), drawCapacity * 2);
+        }
+        if (groupCount > groupCapacity)
+        {
+            groupCapacity = std::max(groupCount, groupCapacity * 2);
+        }
 
-    // Create Descriptor Set Here
-    int descriptorLoc = CreateTextureDescriptor(imageView);
+        DestroyDrawBuffers(imageIndex);
+        CreateDrawBuffers(imageIndex, drawCapacity, groupCapacity);
+    }
 
-    return descriptorLoc;
+    // Draws of one texture are one range of the command buffer, drawn with a single indirect call.
+    // Every copy of a model (itself and each instance) has draws of its own, so the cull pass tests them one by one
+    m_drawGroups.assign(groupCount, {});
+    for (size_t i = 0; i < m_meshModels.size(); i++)
+    {
+        uint32_t copyCount = 1 + static_cast<uint32_t>(m_modelInstances[i].size());
+        for (uint32_t j = 0; j < m_meshModels[i].GetMeshCount(); j++)
+        {
+            m_drawGroups[m_bindless ? 0 : m_meshModels[i].GetMesh(j)->GetTexId()].drawCount += copyCount;
+        }
+    }
+
+    uint32_t firstCommand = 0;
+    m_groupCursors.resize(m_drawGroups.size());
+    for (size_t i = 0; i < m_drawGroups.size(); i++)
+    {
+        m_drawGroups[i].firstCommand = firstCommand;
+        m_groupCursors[i] = firstCommand;
+        firstCommand += m_drawGroups[i].drawCount;
+    }
+
+    // Draws in the order of their groups (freed model slots have no meshes). Instance transforms follow the model slots
+    uint32_t instanceBase = static_cast<uint32_t>(m_meshModels.size());
+    GpuDraw *draws = static_cast<GpuDraw *>(m_drawBufferMemorys[imageIndex].mapped);
+    for (size_t i = 0; i < m_meshModels.size(); i++)
+    {
+        for (size_t copy = 0; copy <= m_modelInstances[i].size(); copy++)
+        {
+            // The model's transform slot, then those of its instances after the model transforms
+            uint32_t modelIndex = copy == 0 ? static_cast<uint32_t>(i) : instanceBase + m_modelInstances[i][copy - 1];
+
+            for (uint32_t j = 0; j < m_meshModels[i].GetMeshCount(); j++)
+            {
+                Mesh *mesh = m_meshModels[i].GetMesh(j);
+                uint32_t group = m_bindless ? 0 : static_cast<uint32_t>(mesh->GetTexId());
+
+                GpuDraw &draw = draws[m_groupCursors[group]++];
+                draw = {};
+                draw.boundsCenter = glm::vec4((mesh->GetBoundsMin() + mesh->GetBoundsMax()) * 0.5f, mesh->GetBoundingSphere().w);
+                draw.boundsExtent = glm::vec4((mesh->GetBoundsMax() - mesh->GetBoundsMin()) * 0.5f, 0.0f);
+                draw.dequantization = *mesh->GetDequantizationPtr();
+                draw.modelIndex = modelIndex;
+                draw.group = group;
+                draw.firstCommand = m_drawGroups[group].firstCommand;
+                draw.lodCount = mesh->GetLodCount();
+                draw.vertexOffset = mesh->GetVertexOffset();
+                draw.textureIndex = static_cast<uint32_t>(mesh->GetTexId());
+                for (uint32_t lod = 0; lod < draw.lodCount; lod++)
+                {
+                    draw.firstIndex[lod] = mesh->GetFirstIndex() + mesh->GetLod(lod).firstIndex;
+                    draw.indexCount[lod] = mesh->GetLod(lod).indexCount;
+                    draw.lodError[lod] = mesh->GetLod(lod).error;
+                }
+            }
+        }
+    }
+
+    m_drawCount = firstCommand;
+    m_drawsDirty[imageIndex] = false;
+
+    // Dispatch size and groups are recorded. Other images are recorded again once their own draws are rewritten
+    m_commandBufferDirty[imageIndex] = true;
+}
+
+void VulkanRenderer::UpdateModel(size_t modelID, glm::mat4 newModel)
+{
+    if (modelID < m_meshModels.size())
+    {
+        m_meshModels[modelID].SetModel(newModel);
+
+        // Refit its scene tree leaf, the tree only changes once the model leaves the leaf's grown box
+        if (m_modelProxies[modelID] != SceneTree::NULL_NODE)
+        {
+            glm::vec3 center;
+            glm::vec3 extent;
+            FrustumCuller::TransformBounds(newModel, m_meshModels[modelID].GetBoundsMin(), m_meshModels[modelID].GetBoundsMax(),
+                                           &center, &extent);
+            m_sceneTree.MoveProxy(m_modelProxies[modelID], center - extent, center + extent);
+        }
+    }
+}
+
+int VulkanRenderer::CreateModelInstance(size_t modelID)
+{
+    if (modelID >= m_meshModels.size() ||
+        std::find(m_freeModelSlots.begin(), m_freeModelSlots.end(), modelID) != m_freeModelSlots.end())
+    {
+        throw std::runtime_error("Attempted to instance invalid Mesh Model");
+    }
+
+    // Visible copies of instanced models share the instance transforms, a model's own transform included
+    size_t transformCount = m_instances.size() - m_freeInstanceSlots.size() + 1;
+    for (size_t i = 0; i < m_modelInstances.size(); i++)
+    {
+        if (!m_modelInstances[i].empty() || i == modelID)
+        {
+            transformCount++;
+        }
+    }
+    if (transformCount > MAX_INSTANCES)
+    {
+        throw std::runtime_error("Instance transform storage buffer is full, can't create instance");
+    }
+
+    // Put it in a slot left by a destroyed instance, or add it to the list
+    size_t instanceID;
+    if (!m_freeInstanceSlots.empty())
+    {
+        instanceID = m_freeInstanceSlots.back();
+        m_freeInstanceSlots.pop_back();
+    }
+    else
+    {
+        instanceID = m_instances.size();
+        m_instances.push_back({});
+    }
+
+    // Identity transform until UpdateModelInstance moves it
+    ModelInstance &instance = m_instances[instanceID];
+    instance.modelID = modelID;
+    instance.transform = glm::mat4(1.0f);
+    instance.proxy = m_sceneTree.CreateProxy(m_meshModels[modelID].GetBoundsMin(), m_meshModels[modelID].GetBoundsMax(),
+                                             INSTANCE_PROXY_BIT | static_cast<uint32_t>(instanceID));
+
+    m_modelInstances[modelID].push_back(static_cast<uint32_t>(instanceID));
+    m_meshCount += m_meshModels[modelID].GetMeshCount();
+    std::fill(m_drawsDirty.begin(), m_drawsDirty.end(), true);
+
+    InvalidateCommandBuffers();
+
+    return static_cast<int>(instanceID);
+}
+
+void VulkanRenderer::DestroyModelInstance(size_t instanceID)
+{
+    if (instanceID >= m_instances.size() || m_instances[instanceID].proxy == SceneTree::NULL_NODE)
+    {
+        throw std::runtime_error("Attempted to destroy invalid Instance");
+    }
+
+    // Nothing to wait for, frames in flight only read its transform from their own slice of the frame allocator
+    ModelInstance &instance = m_instances[instanceID];
+    m_sceneTree.DestroyProxy(instance.proxy);
+    instance.proxy = SceneTree::NULL_NODE;
+
+    std::vector<uint32_t> &modelInstances = m_modelInstances[instance.modelID];
+    modelInstances.erase(std::find(modelInstances.begin(), modelInstances.end(), static_cast<uint32_t>(instanceID)));
+    m_meshCount -= m_meshModels[instance.modelID].GetMeshCount();
+    std::fill(m_drawsDirty.begin(), m_drawsDirty.end(), true);
+
+    m_freeInstanceSlots.push_back(instanceID);
+
+    InvalidateCommandBuffers();
+}
+
+void VulkanRenderer::UpdateModelInstance(size_t instanceID, glm::mat4 newModel)
+{
+    if (instanceID < m_instances.size() && m_instances[instanceID].proxy != SceneTree::NULL_NODE)
+    {
+        ModelInstance &instance = m_instances[instanceID];
+        instance.transform = newModel;
+
+        // Same bounds as its model, refit like a model's leaf
+        glm::vec3 center;
+        glm::vec3 extent;
+        FrustumCuller::TransformBounds(newModel, m_meshModels[instance.modelID].GetBoundsMin(),
+                                       m_meshModels[instance.modelID].GetBoundsMax(), &center, &extent);
+        m_sceneTree.MoveProxy(instance.proxy, center - extent, center + extent);
+    }
+}
+
+void VulkanRenderer::CreatePushConstantRange()
+{
+    // Define Push Constant values (no 'create' needed!)
+    m_pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;            // Shader stage push constant will go to
+    m_pushConstantRange.offset = 0;                                         // Offset into given data to push constant
+    m_pushConstantRange.size = sizeof(Model) + sizeof(MeshDequantization) + sizeof(uint32_t); // Size of data being passed (model, mesh dequantization, texture index)
+}
+
+void VulkanRenderer::CreateDepthBufferImage()
+{
+    // Get supported format for depth buffer
+    m_depthFormat = ChooseSupportedFormat({VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT},
+                                          VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+    // Create Depth Buffer Image
+    m_depthBufferImage = CreateImage(m_swapChainExtent.width, m_swapChainExtent.height, m_depthFormat, VK_IMAGE_TILING_OPTIMAL,
+                                     VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_depthBufferImageMemory);
+
+    m_depthBufferImageView = CreateImageView(m_depthBufferImage, m_depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+}
+
+VkImage VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
+                                    VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propFlags,
+                                    MemoryAllocation *imageMemory, uint32_t mipLevels)
+{
+    // CREATE IMAGE
+    // Image Create Info
+    VkImageCreateInfo imageCreateInfo = {};
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;              // Type of Image (1D, 2D or 3D)
+    imageCreateInfo.extent.width = width;                      // Width of Image extent
+    imageCreateInfo.extent.height = height;                    // Height of Image extent
+    imageCreateInfo.extent.depth = 1;                          // Depth of Image (just 1, no 3D aspect)
+    imageCreateInfo.mipLevels = mipLevels;                     // No of mipmap levels
+    imageCreateInfo.arrayLayers = 1;                           //No of levels in large array
+    imageCreateInfo.format = format;                           // Format type of image
+    imageCreateInfo.tiling = tiling;                           // How large data should be "tiled" (arranged for optimal reading speed)
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // Layout for imgage data on creation
+    imageCreateInfo.usage = usageFlags;                        // Bit flags defining what image will be used for
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;           // No of samples for multi-sampling
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;   // Whether the image can be shared between queues
+
+    // CREATE MEMORY FOR IMAGE
+    VkImage image;
+    VkResult result = vkCreateImage(m_mainDevice.logicalDevice, &imageCreateInfo, nullptr, &image);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create an image");
+    }
+
+    // CREATE MEMORY FOR IMAGE
+
+    // Get memory requirements for a type of image
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(m_mainDevice.logicalDevice, image, &memoryRequirements);
+
+    // Sub-allocate from a pooled block, linear tiled images may share pages with buffers
+    *imageMemory = m_memoryAllocator.Allocate(memoryRequirements, propFlags, tiling == VK_IMAGE_TILING_LINEAR);
+
+    // Connect memory to image
+    vkBindImageMemory(m_mainDevice.logicalDevice, image, imageMemory->memory, imageMemory->offset);
+
+    return image;
+}
+
+VkFormat VulkanRenderer::ChooseSupportedFormat(const std::vector<VkFormat> &formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags)
+{
+    // Loop through options and find compatible one
+    for (VkFormat format : formats)
+    {
+        // Get properties for given format on this device
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(m_mainDevice.physicalDevice, format, &properties);
+
+        // Depending on tiling choice, need to check for different feature flags
+        if ((tiling == VK_IMAGE_TILING_LINEAR) && (properties.linearTilingFeatures & featureFlags))
+        {
+            return format;
+        }
+        else if ((tiling == VK_IMAGE_TILING_OPTIMAL) && (properties.optimalTilingFeatures & featureFlags))
+        {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("Failed to find a matching format");
+}
+
+TextureData VulkanRenderer::LoadTexture(const std::string filePath)
+{
+    // Only touches the file and CPU memory, so can run on import worker threads
+    TextureData texture = {};
+
+    // Prefer baked texture (block compressed with all mip levels), no image decoding needed
+    if (m_settings.useBakedTextures && LoadBakedTexture(filePath, &texture))
+    {
+        return texture;
+    }
+
+    // Number of channels image uses
+    int channels;
+
+    // Load pixel data for image
+    texture.pixels = stbi_load(filePath.c_str(), &texture.width, &texture.height, &channels, STBI_rgb_alpha);
+    if (texture.pixels == nullptr)
+    {
+        throw std::runtime_error("Failed to load a Texture file! (" + filePath + ")");
+    }
+
+    // Calculate image size using given and known data
+    texture.size = static_cast<VkDeviceSize>(texture.width) * texture.height * 4;
+    texture.mipLevels = BlockCompression::GetMipLevelCount(texture.width, texture.height);
+    texture.levels = {{0, texture.size, static_cast<uint32_t>(texture.width), static_cast<uint32_t>(texture.height)}};
+
+    // Identical images stored under different names end up sharing one texture
+    texture.contentHash = TextureCache::HashContent(texture.pixels, static_cast<size_t>(texture.size));
+
+    // Upload queue can't blit, filter the other levels here on the worker instead
+    if (!m_blitMipmaps)
+    {
+        texture.levelData.assign(texture.pixels, texture.pixels + texture.size);
+        stbi_image_free(texture.pixels);
+        texture.pixels = nullptr;
+
+        for (uint32_t i = 1; i < texture.mipLevels; i++)
+        {
+            ImageLevel previous = texture.levels.back();
+            std::vector<uint8_t> level = BlockCompression::Downsample(texture.levelData.data() + previous.offset, previous.width, previous.height);
+
+            texture.levels.push_back({texture.levelData.size(), level.size(), std::max(previous.width / 2, 1u), std::max(previous.height / 2, 1u)});
+            texture.levelData.insert(texture.levelData.end(), level.begin(), level.end());
+        }
+
+        texture.size = texture.levelData.size();
+    }
+
+    return texture;
+}
+
+bool VulkanRenderer::LoadBakedTexture(const std::string &filePath, TextureData *texture)
+{
+    const std::string bakedPath = Ktx2File::GetBakedPath(filePath);
+
+    // Ignore baked texture if the image file was changed after baking (image file itself doesn't have to exist)
+    std::error_code error;
+    std::filesystem::file_time_type bakedTime = std::filesystem::last_write_time(bakedPath, error);
+    if (error)
+    {
+        return false;
+    }
+    std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(filePath, error);
+    if (!error && sourceTime > bakedTime)
+    {
+        return false;
+    }
+
+    VkFormat format;
+    uint32_t width, height;
+    std::vector<unsigned char> data;
+    std::vector<Ktx2Level> levels;
+    if (!Ktx2File::Read(bakedPath, &format, &width, &height, &data, &levels))
+    {
+        return false;
+    }
+
+    // Hash of the stored blocks rather than of decoded pixels, so a baked texture only deduplicates with other baked
+    // textures, never with the same image loaded from its source file
+    texture->contentHash = TextureCache::HashContent(data.data(), data.size());
+    texture->width = static_cast<int>(width);
+    texture->height = static_cast<int>(height);
+
+    if (BlockCompression::IsCompressed(format) && !m_textureCompressionBC)
+    {
+        // Device can't sample BC formats, decompress every level to RGBA8 (still saves decoding and filtering the image)
+        std::vector<unsigned char> pixels;
+        texture->levels.resize(levels.size());
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            std::vector<uint8_t> levelPixels = BlockCompression::Decompress(data.data() + levels[i].offset, levels[i].width, levels[i].height, format);
+            texture->levels[i] = {pixels.size(), levelPixels.size(), levels[i].width, levels[i].height};
+            pixels.insert(pixels.end(), levelPixels.begin(), levelPixels.end());
+        }
+
+        texture->format = VK_FORMAT_R8G8B8A8_UNORM;
+        texture->levelData = std::move(pixels);
+    }
+    else
+    {
+        texture->levels.resize(levels.size());
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            texture->levels[i] = {levels[i].offset, levels[i].size, levels[i].width, levels[i].height};
+        }
+
+        texture->format = format;
+        texture->levelData = std::move(data);
+    }
+
+    texture->mipLevels = static_cast<uint32_t>(texture->levels.size());
+    texture->size = 0;
+    for (const ImageLevel &level : texture->levels)
+    {
+        texture->size += level.size;
+    }
+
+    return true;
+}
+
+VkImage VulkanRenderer::CreateTextureImage(TextureData &texture, UploadBatch *upload, MemoryAllocation *imageMemory)
+{
+    // Levels missing from the data are blitted from the full size image, which also reads the image
+    bool generateMipmaps = texture.levels.size() < texture.mipLevels;
+    VkImageUsageFlags usageFlags = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (generateMipmaps)
+    {
+        usageFlags |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    // Create image to hold final texture (with room for every mip level)
+    VkImage texImage = CreateImage(texture.width, texture.height, texture.format, VK_IMAGE_TILING_OPTIMAL,
+                                   usageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, imageMemory, texture.mipLevels);
+
+    // COPY DATA TO IMAGE
+    // Stage image data and record layout transitions around the copy into the batch
+    const unsigned char *data = texture.pixels != nullptr ? texture.pixels : texture.levelData.data();
+    if (generateMipmaps)
+    {
+        upload->UploadImageAndGenerateMipmaps(texImage, data, texture.levels[0].size, texture.width, texture.height, texture.mipLevels);
+    }
+    else
+    {
+        upload->UploadImage(texImage, data, texture.levels);
+    }
+
+    // Free original image data (upload batch keeps its own copy)
+    FreeTextureData(texture);
+
+    return texImage;
+}
+
+int VulkanRenderer::CreateTexture(TextureData &texture, UploadBatch *upload)
+{
+    // Reuse id of a destroyed texture if there is one, otherwise add a new one
+    int textureId;
+    if (!m_freeTextureSlots.empty())
+    {
+        textureId = m_freeTextureSlots.back();
+        m_freeTextureSlots.pop_back();
+    }
+    else
+    {
+        textureId = static_cast<int>(m_textureImages.size());
+        if (m_bindless && static_cast<uint32_t>(textureId) >= m_bindlessTextureCount)
+        {
+            throw std::runtime_error("Bindless texture array is full");
+        }
+        m_textureImages.push_back(nullptr);
+        m_textureImageMemorys.push_back({});
+        m_textureImageViews.push_back(nullptr);
+        m_samplerDescriptorSets.push_back({});
+    }
+
+    // Create Texture image
+    m_textureImages[textureId] = CreateTextureImage(texture, upload, &m_textureImageMemorys[textureId]);
+
+    // Create Image view
+    m_textureImageViews[textureId] = CreateImageView(m_textureImages[textureId], texture.format, VK_IMAGE_ASPECT_COLOR_BIT,
+                                                     texture.mipLevels);
+
+    // Create Descriptor Set Here (bindless textures: write the texture's element of the texture array)
+    if (m_bindless)
+    {
+        WriteBindlessTexture(static_cast<uint32_t>(textureId), m_textureImageViews[textureId]);
+    }
+    else
+    {
+        m_samplerDescriptorSets[textureId] = CreateTextureDescriptor(m_textureImageViews[textureId]);
+    }
+
+    InvalidateCommandBuffers();
+
+    return textureId;
+}
+
+void VulkanRenderer::DestroyTexture(int textureId)
+{
+    m_samplerDescriptorAllocator.Free(m_samplerDescriptorSets[textureId]);
+
+    vkDestroyImageView(m_mainDevice.logicalDevice, m_textureImageViews[textureId], nullptr);
+    m_textureImageViews[textureId] = nullptr;
+
+    vkDestroyImage(m_mainDevice.logicalDevice, m_textureImages[textureId], nullptr);
+    m_textureImages[textureId] = nullptr;
+
+    m_memoryAllocator.Free(m_textureImageMemorys[textureId]);
+
+    m_freeTextureSlots.push_back(textureId);
+}
+
+int VulkanRenderer::CacheTexture(const std::string &filePath, TextureData &texture, UploadBatch *upload)
+{
+    // Same pixels already uploaded under another name, use that texture
+    int textureId = m_textureCache.FindByContent(texture.contentHash, texture.width, texture.height, texture.format, texture.mipLevels);
+    if (textureId >= 0)
+    {
+        FreeTextureData(texture);
+
+        m_textureCache.AddPath(textureId, filePath);
+        return textureId;
+    }
+
+    textureId = CreateTexture(texture, upload);
+    m_textureCache.Insert(textureId, filePath, texture.contentHash, texture.width, texture.height, texture.format, texture.mipLevels);
+
+    return textureId;
+}
+
+int VulkanRenderer::AcquireTexture(const std::string fileName, UploadBatch *upload)
+{
+    // Only load file if no one has loaded it yet
+    const std::string filePath = TexturePath(fileName);
+    int textureId = m_textureCache.FindByPath(filePath);
+    if (textureId < 0)
+    {
+        TextureData texture = LoadTexture(filePath);
+        textureId = CacheTexture(filePath, texture, upload);
+    }
+
+    m_textureCache.AddReference(textureId);
+
+    return textureId;
 }
 
 void VulkanRenderer::CreateTextureSampler()
@@ -1747,7 +3453,7 @@ void VulkanRenderer::CreateTextureSampler()
     samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;     // Mipmap interpolation mode
     samplerCreateInfo.mipLodBias = 0.0f;                              // Level of detail bias for mip level
     samplerCreateInfo.minLod = 0.0f;                                  // Minimum level of detail to pick mip level
-    samplerCreateInfo.maxLod = 0.0f;                                  // Maximum level of detail to pick mip level
+    samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;                     // Maximum level of detail to pick mip level (every level image has)
     samplerCreateInfo.anisotropyEnable = VK_TRUE;                     // Enable Anisotropic filtering
     samplerCreateInfo.maxAnisotropy = 16.0f;                          // Maximum Anisotroy sample level
 
@@ -1758,21 +3464,10 @@ void VulkanRenderer::CreateTextureSampler()
     }
 }
 
-int VulkanRenderer::CreateTextureDescriptor(VkImageView textureImageView)
+DescriptorAllocation VulkanRenderer::CreateTextureDescriptor(VkImageView textureImageView)
 {
-    VkDescriptorSet descriptorSet;
-
-    VkDescriptorSetAllocateInfo setAllocInfo = {};
-    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    setAllocInfo.descriptorPool = m_samplerDescriptorPool;
-    setAllocInfo.descriptorSetCount = 1;
-    setAllocInfo.pSetLayouts = &m_samplerSetLayout;
-
-    VkResult result = vkAllocateDescriptorSets(m_mainDevice.logicalDevice, &setAllocInfo, &descriptorSet);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to allocate Texture Descriptor Sets");
-    }
+    // From the first sampler pool with room (a new one if they are all full)
+    DescriptorAllocation descriptorSet = m_samplerDescriptorAllocator.Allocate();
 
     // Texture Image info
     VkDescriptorImageInfo imageInfo = {};
@@ -1780,64 +3475,288 @@ int VulkanRenderer::CreateTextureDescriptor(VkImageView textureImageView)
     imageInfo.imageView = textureImageView;                           // Image to bind to set
     imageInfo.sampler = m_textureSampler;                             // Sampler to use for set
 
-    // Descriptor Write Info
-    VkWriteDescriptorSet descriptorWrite = {};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = descriptorSet;
-    descriptorWrite.dstBinding = 0;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pImageInfo = &imageInfo;
-
-    // Update new Descriptor Set
-    vkUpdateDescriptorSets(m_mainDevice.logicalDevice, 1, &descriptorWrite, 0, nullptr);
+    // Update new Descriptor Set, laid out as the allocator's template entry expects
+    m_samplerDescriptorAllocator.Write(descriptorSet.set, &imageInfo);
 
-    // Add Descriptor set to list
-    m_samplerDescriptorSets.push_back(descriptorSet);
+    return descriptorSet;
+}
 
-    // Return descriptor set location
-    return m_samplerDescriptorSets.size() - 1;
+void VulkanRenderer::WriteBindlessTexture(uint32_t textureId, VkImageView textureImageView)
+{
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = textureImageView;
+    imageInfo.sampler = m_textureSampler;
+
+    // Element of a destroyed texture is rewritten when its id is reused, never read before (partially bound)
+    VkWriteDescriptorSet setWrite = {};
+    setWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    setWrite.dstSet = m_bindlessDescriptorSet;
+    setWrite.dstBinding = 0;
+    setWrite.dstArrayElement = textureId;
+    setWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    setWrite.descriptorCount = 1;
+    setWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(m_mainDevice.logicalDevice, 1, &setWrite, 0, nullptr);
 }
 
 int VulkanRenderer::CreateMeshModel(const std::string modelFileName)
 {
-    // Import Model "scene"
+    if (m_freeModelSlots.empty() && m_meshModels.size() >= MAX_MODELS)
+    {
+        throw std::runtime_error("Model transform storage buffer is full, can't load (" + modelFileName + ")");
+    }
+
+    // Import flags are part of the mesh cache key, a cache written with other flags is stale
+    const uint32_t importFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices;
+    // The geometry pool of GPU-driven rendering only holds 32 bit triangle lists
+    const bool useTriangleStrips = m_settings.useTriangleStrips && !m_gpuDriven;
+    const uint32_t processFlags = (m_settings.optimizeMeshes ? MESH_PROCESS_OPTIMIZE : 0) |
+                                  (useTriangleStrips ? MESH_PROCESS_STRIPS : 0) |
+                                  (m_settings.generateLods ? MESH_PROCESS_LODS : 0) |
+                                  (m_gpuDriven ? MESH_PROCESS_WIDE_INDICES : 0);
+
+    // Warm start: meshes and texture names are read from the mapped cache file, Assimp isn't run at all
+    const std::string cachePath = MeshCache::GetCachePath(modelFileName);
+    MeshCache meshCache;
+    bool cacheHit = m_settings.useMeshCache && meshCache.Open(cachePath, modelFileName, importFlags, processFlags, m_settings.vertexFormat);
+
     Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(modelFileName, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
-    if (scene == nullptr)
+    std::vector<std::string> textureNames;
+    std::vector<aiMesh *> sceneMeshes;
+
+    if (cacheHit)
+    {
+        textureNames = meshCache.GetTextureNames();
+    }
+    else
     {
-        throw std::runtime_error("Failed to load (" + modelFileName + ")");
+        // Import Model "scene"
+        const aiScene *scene = importer.ReadFile(modelFileName, importFlags);
+        if (scene == nullptr)
+        {
+            throw std::runtime_error("Failed to load (" + modelFileName + ")");
+        }
+
+        // Get vector of all materials with 1:1 ID placement
+        textureNames = MeshModel::LoadMaterials(scene);
+
+        // Flatten node tree into list of meshes
+        MeshModel::CollectMeshes(scene->mRootNode, scene, sceneMeshes);
     }
 
-    // Get vector of all materials with 1:1 ID placement
-    std::vector<std::string> textureNames = MeshModel::LoadMaterials(scene);
+    // Only decode texture files that aren't cached yet, each of them once even if several materials use it
+    std::vector<std::string> texturePaths(textureNames.size());
+    std::vector<std::string> decodePaths;
+    for (size_t i = 0; i < textureNames.size(); i++)
+    {
+        if (textureNames[i].empty())
+        {
+            continue;
+        }
+
+        texturePaths[i] = TexturePath(textureNames[i]);
+        if (m_textureCache.FindByPath(texturePaths[i]) < 0 &&
+            std::find(decodePaths.begin(), decodePaths.end(), texturePaths[i]) == decodePaths.end())
+        {
+            decodePaths.push_back(texturePaths[i]);
+        }
+    }
+
+    // CPU WORK: decode texture files and convert every mesh on the worker threads
+    std::vector<TextureData> textures(decodePaths.size());
+    std::vector<MeshData> meshData(sceneMeshes.size());
+
+    for (size_t i = 0; i < decodePaths.size(); i++)
+    {
+        m_threadPool.Enqueue([this, &textures, &decodePaths, i]
+                             { textures[i] = LoadTexture(decodePaths[i]); });
+    }
+    for (size_t i = 0; i < sceneMeshes.size(); i++)
+    {
+        m_threadPool.Enqueue([this, &meshData, &sceneMeshes, useTriangleStrips, i]
+                             {
+                                 meshData[i] = MeshModel::ConvertMesh(sceneMeshes[i]);
+                                 if (m_settings.optimizeMeshes)
+                                 {
+                                     meshData[i].optimization = MeshOptimizer::Optimize(meshData[i].vertices, meshData[i].indices);
+                                 }
+                                 if (m_settings.generateLods)
+                                 {
+                                     MeshModel::GenerateLods(meshData[i]);
+                                 }
+                                 MeshModel::PackVertices(meshData[i], m_settings.vertexFormat);
+                                 MeshModel::PackIndices(meshData[i], useTriangleStrips, !m_gpuDriven);
+                             });
+    }
+
+    try
+    {
+        m_threadPool.Wait();
+    }
+    catch (...)
+    {
+        // Textures decoded before the failure are never uploaded
+        for (TextureData &texture : textures)
+        {
+            FreeTextureData(texture);
+        }
+        throw;
+    }
+
+    // Report how much optimizing improved the vertex cache, and how many levels of detail were made
+    m_importStatistics = {};
+    m_importStatistics.meshCacheHit = cacheHit;
+    for (const MeshData &data : meshData)
+    {
+        m_importStatistics.lodLevels += data.lods.empty() ? 0 : static_cast<uint32_t>(data.lods.size()) - 1;
+    }
+    if (m_settings.optimizeMeshes)
+    {
+        for (const MeshData &data : meshData)
+        {
+            const MeshOptimizationStatistics &optimization = data.optimization;
+            m_importStatistics.optimizedMeshes++;
+            m_importStatistics.triangleCount += optimization.triangleCount;
+            m_importStatistics.vertexCount += optimization.vertexCount;
+            m_importStatistics.before.acmr += optimization.before.acmr * optimization.triangleCount;
+            m_importStatistics.before.atvr += optimization.before.atvr * optimization.vertexCount;
+            m_importStatistics.after.acmr += optimization.after.acmr * optimization.triangleCount;
+            m_importStatistics.after.atvr += optimization.after.atvr * optimization.vertexCount;
+        }
+        if (m_importStatistics.triangleCount > 0)
+        {
+            m_importStatistics.before.acmr /= m_importStatistics.triangleCount;
+            m_importStatistics.after.acmr /= m_importStatistics.triangleCount;
+        }
+        if (m_importStatistics.vertexCount > 0)
+        {
+            m_importStatistics.before.atvr /= m_importStatistics.vertexCount;
+            m_importStatistics.after.atvr /= m_importStatistics.vertexCount;
+        }
+    }
+
+    // GPU WORK: create resources and record their uploads on this thread
+    // Every texture and mesh of the model is uploaded with a single submission
+    UploadBatch upload = CreateUploadBatch();
+
+    // Create textures for newly decoded files (or find them by content)
+    for (size_t i = 0; i < decodePaths.size(); i++)
+    {
+        CacheTexture(decodePaths[i], textures[i], &upload);
+    }
 
     // Conversion from the materials list IDs to our Descriptor Array IDs
     std::vector<int> matToTex(textureNames.size());
+    // Model holds one reference to every distinct texture it uses
+    std::vector<int> modelTextures;
 
-    // Loop over texture names and create textures for them
     for (size_t i = 0; i < textureNames.size(); i++)
     {
         // If material had no texture, set '0' to indicate no texture, texture 0 will be reserved for a default texture
-        if (textureNames[i].empty())
+        if (texturePaths[i].empty())
         {
             matToTex[i] = 0;
+            continue;
         }
-        // Otherwise, create texture and set value to index of texture
-        else
+
+        // Otherwise, set value to id of cached texture
+        matToTex[i] = m_textureCache.FindByPath(texturePaths[i]);
+        if (std::find(modelTextures.begin(), modelTextures.end(), matToTex[i]) == modelTextures.end())
         {
-            matToTex[i] = CreateTexture(textureNames[i]);
+            modelTextures.push_back(matToTex[i]);
+            m_textureCache.AddReference(matToTex[i]);
         }
     }
 
-    // Load in all meshes
-    std::vector<Mesh> modelMeshes = MeshModel::LoadModel(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, m_graphicsQueue, m_graphicsCommandPool,
-                                                         scene->mRootNode, scene, matToTex);
+    // Create all meshes (in the geometry pool for GPU-driven rendering)
+    GeometryPool *geometryPool = m_gpuDriven ? &m_geometryPool : nullptr;
+    std::vector<Mesh> modelMeshes = cacheHit ? MeshModel::CreateMeshes(&m_memoryAllocator, m_mainDevice.logicalDevice, &upload,
+                                                                       meshCache, matToTex, geometryPool)
+                                             : MeshModel::CreateMeshes(&m_memoryAllocator, m_mainDevice.logicalDevice, &upload,
+                                                                       meshData, matToTex, geometryPool);
+
+    SubmitUpload(upload);
+
+    // Cold start: store converted meshes for the next start (if that fails the model is just imported again)
+    if (m_settings.useMeshCache && !cacheHit)
+    {
+        MeshCache::Write(cachePath, modelFileName, importFlags, processFlags, m_settings.vertexFormat, textureNames, meshData);
+    }
 
-    // Create Mesh Model and add it list
+    // Create Mesh Model and put it in a slot left by a destroyed model, or add it to the list
     MeshModel meshModel = MeshModel(modelMeshes);
-    m_meshModels.push_back(meshModel);
+    size_t modelID;
+    if (!m_freeModelSlots.empty())
+    {
+        modelID = m_freeModelSlots.back();
+        m_freeModelSlots.pop_back();
+
+        m_meshModels[modelID] = meshModel;
+        m_meshModelTextures[modelID] = modelTextures;
+    }
+    else
+    {
+        modelID = m_meshModels.size();
+
+        m_meshModels.push_back(meshModel);
+        m_meshModelTextures.push_back(modelTextures);
+        m_modelProxies.push_back(SceneTree::NULL_NODE);
+        m_modelInstances.push_back({});
+    }
+
+    // Identity transform until UpdateModel moves it
+    m_modelProxies[modelID] = m_sceneTree.CreateProxy(meshModel.GetBoundsMin(), meshModel.GetBoundsMax(), static_cast<uint32_t>(modelID));
+    m_meshCount += meshModel.GetMeshCount();
+    std::fill(m_drawsDirty.begin(), m_drawsDirty.end(), true);
+
+    InvalidateCommandBuffers();
+
+    return static_cast<int>(modelID);
+}
+
+void VulkanRenderer::DestroyMeshModel(size_t modelID)
+{
+    if (modelID >= m_meshModels.size() ||
+        std::find(m_freeModelSlots.begin(), m_freeModelSlots.end(), modelID) != m_freeModelSlots.end())
+    {
+        throw std::runtime_error("Attempted to destroy invalid Mesh Model");
+    }
+
+    // Frames in flight may still be drawing it
+    vkDeviceWaitIdle(m_mainDevice.logicalDevice);
+
+    // Its instances go with it
+    for (uint32_t instanceID : m_modelInstances[modelID])
+    {
+        m_sceneTree.DestroyProxy(m_instances[instanceID].proxy);
+        m_instances[instanceID].proxy = SceneTree::NULL_NODE;
+        m_meshCount -= m_meshModels[modelID].GetMeshCount();
+        m_freeInstanceSlots.push_back(instanceID);
+    }
+    m_modelInstances[modelID].clear();
+
+    m_sceneTree.DestroyProxy(m_modelProxies[modelID]);
+    m_modelProxies[modelID] = SceneTree::NULL_NODE;
+    m_meshCount -= m_meshModels[modelID].GetMeshCount();
+    std::fill(m_drawsDirty.begin(), m_drawsDirty.end(), true);
+
+    // Leave an empty model in its slot so ids of other models don't change
+    m_meshModels[modelID].DestroyModel();
+    m_meshModels[modelID] = MeshModel();
+
+    // Destroy textures no other model uses anymore
+    for (int textureId : m_meshModelTextures[modelID])
+    {
+        if (m_textureCache.Release(textureId))
+        {
+            DestroyTexture(textureId);
+        }
+    }
+    m_meshModelTextures[modelID].clear();
+
+    m_freeModelSlots.push_back(modelID);
 
-    return m_meshModels.size() - 1;
+    InvalidateCommandBuffers();
 }
@@ -13,6 +13,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <vector>
+#include <array>
 #include <set>
 #include <algorithm>
 
@@ -22,6 +23,86 @@
 #include "Utilities.h"
 #include "Mesh.hpp"
 #include "MeshModel.hpp"
+#include "UploadBatch.hpp"
+#include "FrameAllocator.hpp"
+#include "ThreadPool.hpp"
+#include "TextureCache.hpp"
+#include "MeshCache.hpp"
+#include "FrustumCuller.hpp"
+#include "SceneTree.hpp"
+#include "GeometryPool.hpp"
+#include "DescriptorAllocator.hpp"
+#include "DrawList.hpp"
+#include "CommandRecorder.hpp"
+
+// CPU time spent in each stage of a Draw() call, in milliseconds
+struct FrameTimings
+{
+    double fenceWait = 0.0;            // Waiting for the frame's previous submission to finish
+    double acquire = 0.0;              // vkAcquireNextImageKHR
+    double recordCommands = 0.0;       // RecordCommands
+    double updateUniformBuffers = 0.0; // UpdateUniformBuffers
+    double cullMeshes = 0.0;           // CullMeshes
+    double selectLods = 0.0;           // SelectLods
+    double queueSubmit = 0.0;          // vkQueueSubmit
+    double present = 0.0;              // vkQueuePresentKHR
+};
+
+// Mesh optimization of the last model created, summed over its meshes
+struct ImportStatistics
+{
+    bool meshCacheHit = false;     // Meshes came from the mesh cache (optimized when it was written, nothing to report)
+    uint32_t optimizedMeshes = 0;
+    uint32_t triangleCount = 0;
+    uint32_t vertexCount = 0;
+    VertexCacheStatistics before{}; // Weighted by triangles (ACMR) and vertices (ATVR) of each mesh
+    VertexCacheStatistics after{};
+    uint32_t lodLevels = 0;         // Simplified levels generated, summed over meshes (LOD 0 not counted)
+};
+
+// Frustum culling of the last frame drawn
+struct CullStatistics
+{
+    uint32_t visibleModels = 0; // Models and instances
+    uint32_t culledModels = 0;  // Rejected by the scene tree, their meshes aren't looked at
+    uint32_t visibleMeshes = 0; // Counted once per copy drawn (instanced models draw them for every visible copy)
+    uint32_t culledMeshes = 0;  // Bounds entirely outside the view frustum (or of a culled model), not drawn
+};
+
+// Decoded texture file (RGBA8) or baked texture (KTX2 with mip levels), data is freed once uploaded
+struct TextureData
+{
+    stbi_uc *pixels = nullptr;                  // Decoded image file, single level
+    std::vector<unsigned char> levelData{};     // Baked texture file or image with filtered mip levels, levels are at their offsets in it
+    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    int width = 0;
+    int height = 0;
+    VkDeviceSize size = 0;
+    uint32_t mipLevels = 1;                     // Levels of the image, any past levels.size() are blitted on the GPU
+    std::vector<ImageLevel> levels{};           // Mip levels in pixels or levelData, levels[0] is full size
+    uint64_t contentHash = 0;                   // Hash of file content, finds identical images stored under another name
+};
+
+// Options chosen at initialisation time
+struct RendererSettings
+{
+    bool cacheCommandBuffers = false;                 // Keep recorded command buffers across frames, transforms are read from a storage buffer
+    bool useTransferQueue = true;                     // Upload through a dedicated transfer queue family when the device has one
+    VkDeviceSize stagingRingSize = 32 * 1024 * 1024;  // Host visible memory all uploads are staged in
+    VkDeviceSize frameAllocatorSize = 1024 * 1024;    // Transient per-frame data (view projection, model and instance transforms) per image
+    uint32_t importThreads = 0;                       // Worker threads decoding textures and converting meshes (0: one per hardware thread)
+    bool useMeshCache = true;                         // Load meshes from a .meshcache file next to the model, written on first import
+    bool useBakedTextures = true;                     // Load <texture>.ktx2 made by the bake tool instead of decoding the image file
+    VertexFormat vertexFormat = VertexFormat::Full;   // Layout meshes are stored in on the GPU (Compact 16 bytes, Quantized 12 bytes per vertex)
+    bool optimizeMeshes = false;                      // Reorder imported meshes for the vertex cache, overdraw and vertex fetch
+    bool useTriangleStrips = false;                   // Draw meshes as strips with primitive restart where that takes fewer indices
+    bool generateLods = false;                        // Simplified levels of detail per mesh, chosen every frame by size on screen
+    float lodErrorPixels = 1.0f;                      // Screen space error a level may have, in pixels, before a finer one is drawn
+    bool frustumCulling = true;                       // Skip meshes whose bounds are outside the view frustum
+    bool gpuDrivenRendering = false;                  // Cull meshes and choose their LODs in a compute pass, draw them with indirect commands
+    VkDeviceSize geometryPoolSize = 64 * 1024 * 1024; // GPU-driven rendering: size of the vertex buffer and of the index buffer all meshes share
+    bool bindlessTextures = false;                    // Every texture in one descriptor array indexed per draw, bound once per frame
+};
 
 class VulkanRenderer
 {
@@ -29,20 +110,80 @@ public:
     VulkanRenderer();
     ~VulkanRenderer();
 
-    int Init(GLFWwindow *newWindow);
+    int Init(GLFWwindow *newWindow, const RendererSettings &settings = {});
+    int InitHeadless(uint32_t width, uint32_t height, const RendererSettings &settings = {});
     int CreateMeshModel(const std::string modelFileName);
+    void DestroyMeshModel(size_t modelID);
     void UpdateModel(size_t modelID, glm::mat4 newModel);
+    // Another copy of a model sharing its meshes, identity transform until UpdateModelInstance moves it.
+    // A model with instances draws each of its meshes once for all visible copies (itself included)
+    int CreateModelInstance(size_t modelID);
+    void DestroyModelInstance(size_t instanceID);
+    void UpdateModelInstance(size_t instanceID, glm::mat4 newModel);
 
     void Draw();
+    const FrameTimings &GetFrameTimings() const;
+    const ImportStatistics &GetImportStatistics() const;
+    const CullStatistics &GetCullStatistics() const;
+    // Binds of the last command buffer recorded (recorded again only when the scene changes if command buffers are cached)
+    const BindStatistics &GetBindStatistics() const;
+    MemoryStatistics GetMemoryStatistics() const;
     void CleanUP();
 
 private:
     GLFWwindow *m_window = nullptr;
+    bool m_headless = false;                  // Render to offscreen images instead of a window surface
+    bool m_textureCompressionBC = false;      // Device samples BC1/BC3/BC7 images, otherwise baked textures are decompressed on load
+    bool m_blitMipmaps = false;               // Mip levels of decoded images are blitted on the GPU, otherwise filtered on the import workers
+    bool m_gpuDriven = false;                 // GPU-driven rendering asked for, and the device draws multiple indirect commands with first instance
+    bool m_drawIndirectCount = false;         // VK_KHR_draw_indirect_count enabled, draw counts are read from the count buffer
+    bool m_descriptorUpdateTemplates = false; // VK_KHR_descriptor_update_template enabled, descriptor sets are written through templates
+    bool m_physicalDeviceProperties2 = false; // VK_KHR_get_physical_device_properties2 enabled, features past Vulkan 1.0 can be queried
+    bool m_bindless = false;                  // Bindless textures asked for and VK_EXT_descriptor_indexing enabled, textures are one array
+    RendererSettings m_settings{};
 
     int m_currentFrame = 0;
+    FrameTimings m_frameTimings{};
+    ImportStatistics m_importStatistics{};
+    CullStatistics m_cullStatistics{};
+    BindStatistics m_bindStatistics{};
 
     // Scene Objects
     std::vector<MeshModel> m_meshModels{};
+    std::vector<std::vector<int>> m_meshModelTextures{}; // Per model, textures it holds a cache reference to
+    std::vector<size_t> m_freeModelSlots{};              // Slots of destroyed models, reused by the next model created
+    FrustumCuller m_frustumCuller{};                     // World space bounds of the meshes of visible models, in drawing order
+    SceneTree m_sceneTree{};                             // World space bounds of every model, culled hierarchically
+    std::vector<int32_t> m_modelProxies{};               // Per model slot, its scene tree leaf (NULL_NODE for free slots)
+    std::vector<uint32_t> m_visibleModels{};             // Slots of the models drawn this frame (themselves or an instance visible), in increasing order
+    std::vector<uint32_t> m_visibleProxies{};            // Scene tree user data of the models and instances visible this frame, in increasing order
+    std::vector<uint32_t> m_lastVisibleProxies{};        // Same for the frame before
+    size_t m_meshCount = 0;                              // Meshes of all models and instances
+    DrawList m_drawList{};                               // Visible meshes in the order they are recorded
+    CommandRecorder m_commandRecorder{};                 // Skips binds of the state already bound while recording
+
+    // Instances
+    static constexpr uint32_t INSTANCE_PROXY_BIT = 0x80000000u; // Set in the scene tree user data of instances (the rest is their id)
+
+    struct ModelInstance
+    {
+        size_t modelID = 0;
+        glm::mat4 transform = glm::mat4(1.0f);
+        int32_t proxy = SceneTree::NULL_NODE; // Scene tree leaf, NULL_NODE for free slots
+    };
+
+    // Visible copies of an instanced model this frame, a range of m_instanceTransforms
+    struct InstanceRange
+    {
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    std::vector<ModelInstance> m_instances{};
+    std::vector<size_t> m_freeInstanceSlots{};              // Slots of destroyed instances, reused by the next instance created
+    std::vector<std::vector<uint32_t>> m_modelInstances{};  // Per model slot, ids of its instances
+    std::vector<InstanceRange> m_instanceRanges{};          // Per model slot, only meaningful for instanced models
+    std::vector<glm::mat4> m_instanceTransforms{};          // Visible copies of instanced models, model first, written after the model transforms
 
     // Scene Settings
     struct UBOViewProjection
@@ -51,6 +192,42 @@ private:
         glm::mat4 view;
     } m_uboViewProjection;
 
+    // Per frame input of the cull pass (std140, matches CullData in cull.comp)
+    struct CullData
+    {
+        glm::vec4 planes[6];      // View frustum, inside where dot(plane.xyz, p) + plane.w >= 0
+        glm::vec4 cameraPosition; // World space, w is the pixels covered by one unit at distance one
+        float lodErrorPixels;
+        uint32_t drawCount;
+        uint32_t frustumCulling;  // Every draw survives when 0
+        uint32_t padding;
+    };
+
+    // Draw of one mesh, read by the cull pass and the vertex shader (std430, matches Draw in cull.comp and shader.vert)
+    struct GpuDraw
+    {
+        glm::vec4 boundsCenter;            // Center of the bounds in mesh units, w is the bounding sphere radius
+        glm::vec4 boundsExtent;            // Half size of the bounds
+        MeshDequantization dequantization;
+        uint32_t modelIndex;               // Slot of the transform (model slot, or model slot count + instance id)
+        uint32_t group;                    // Texture of the mesh (0 with bindless textures), survivors are counted and drawn per group
+        uint32_t firstCommand;             // First command of the group in the indirect command buffer
+        uint32_t lodCount;
+        int32_t vertexOffset;              // Of the mesh in the geometry pool
+        uint32_t textureIndex;             // Array element of the mesh's texture (bindless textures)
+        uint32_t padding[2];
+        uint32_t firstIndex[MAX_MESH_LODS]; // Per LOD, in the geometry pool's index buffer
+        uint32_t indexCount[MAX_MESH_LODS];
+        float lodError[MAX_MESH_LODS];
+    };
+
+    // Draws of one texture, a range of the indirect command buffer
+    struct DrawGroup
+    {
+        uint32_t firstCommand = 0;
+        uint32_t drawCount = 0;
+    };
+
     // Vulkan Components
     // - Main
     VkInstance m_vkInstance = nullptr;
@@ -61,18 +238,28 @@ private:
         VkDevice logicalDevice = nullptr;
     } m_mainDevice{};
 
+    // - Memory
+    DeviceMemoryAllocator m_memoryAllocator{};
+    StagingRing m_stagingRing{};
+    ThreadPool m_threadPool{};
+
     VkQueue m_graphicsQueue = nullptr;
     VkQueue m_presentationQueue = nullptr;
+    VkQueue m_transferQueue = nullptr; // Only set when a dedicated transfer queue family is used
 
     VkSurfaceKHR m_surface{};
     VkSwapchainKHR m_swapchain{};
     std::vector<SwapchainImage> m_swapChainImages{};
     std::vector<VkFramebuffer> m_swapChainFrameBuffers{};
     std::vector<VkCommandBuffer> m_commandBuffers{};
+    std::vector<bool> m_commandBufferDirty{}; // Command buffer must be re-recorded before its next submission
+
+    // - Headless
+    std::vector<MemoryAllocation> m_offscreenImageMemory{}; // Backing memory of offscreen color targets (stored in m_swapChainImages)
 
     VkFormat m_depthFormat{};
     VkImage m_depthBufferImage{};
-    VkDeviceMemory m_depthBufferImageMemory{};
+    MemoryAllocation m_depthBufferImageMemory{};
     VkImageView m_depthBufferImageView{};
 
     VkSampler m_textureSampler{};
@@ -83,32 +270,56 @@ private:
     VkPushConstantRange m_pushConstantRange{};
 
     VkDescriptorPool m_descriptorPool{};
-    VkDescriptorPool m_samplerDescriptorPool{};
+    DescriptorAllocator m_samplerDescriptorAllocator{};          // Texture sets, pools are added as textures are created
     std::vector<VkDescriptorSet> m_descriptorSets{};
-    std::vector<VkDescriptorSet> m_samplerDescriptorSets{};
+    std::vector<DescriptorAllocation> m_samplerDescriptorSets{}; // Indexed by texture id
+    DescriptorTemplateFunctions m_descriptorTemplateFunctions{}; // Null unless m_descriptorUpdateTemplates
+    VkDescriptorPool m_bindlessDescriptorPool{};                 // Bindless textures: pool of the one texture set, updatable after bind
+    VkDescriptorSet m_bindlessDescriptorSet{};                   // Bindless textures: array element of each texture is its id
+    uint32_t m_bindlessTextureCount = 0;                         // Size of the texture array, textures the renderer can hold at once
 
-    std::vector<VkBuffer> m_vpUniformBuffer{};
-    std::vector<VkDeviceMemory> m_vpUniformBufferMemory{};
-
-    std::vector<VkBuffer> m_modelDynUniformBuffer{};
-    std::vector<VkDeviceMemory> m_modelDynUniformBufferMemory{};
-
-    // VkDeviceSize m_minUniformBufferOffset{};
-    // size_t m_modelUniformAlignment{};
-    // Model *m_modelTransferSpace{}; Using push constants instead
+    std::vector<FrameAllocator> m_frameAllocators{};       // Per image, holds view projection and model transforms of the frame drawn to it
+    std::vector<std::array<uint32_t, 2>> m_frameOffsets{}; // Per image, dynamic offsets of set 0 bindings (view projection, model transforms)
+    std::vector<uint32_t> m_cullDataOffsets{};             // Per image, dynamic offset of the cull pass's CullData
 
     // - Assets
     std::vector<VkImage> m_textureImages{};
-    std::vector<VkDeviceMemory> m_textureImageMemorys{};
+    std::vector<MemoryAllocation> m_textureImageMemorys{};
     std::vector<VkImageView> m_textureImageViews{};
+    std::vector<int> m_freeTextureSlots{}; // Texture ids of destroyed textures, reused by the next texture created
+    TextureCache m_textureCache{};
+    std::vector<UploadBatch> m_pendingUploads{}; // Submitted uploads whose staging memory is still in use by the GPU
 
     // - Pipeline
-    VkPipeline m_graphicsPipeline{};
+    std::array<VkPipeline, VERTEX_FORMAT_COUNT * 2> m_graphicsPipelines{}; // Indexed by GetPipelineIndex (vertex format and topology)
     VkPipelineLayout m_pipelineLayout{};
     VkRenderPass m_renderPass{};
 
+    // - GPU-Driven Rendering
+    GeometryPool m_geometryPool{};                          // Vertices and indices of every mesh
+    std::vector<VkBuffer> m_drawBuffers{};                  // Per image, GpuDraw of every mesh, in the order of their groups
+    std::vector<MemoryAllocation> m_drawBufferMemorys{};
+    std::vector<uint32_t> m_drawCapacities{};               // Per image, draws the draw and command buffers have room for
+    std::vector<uint32_t> m_groupCapacities{};              // Per image, groups the count buffer has room for
+    uint32_t m_drawCount = 0;
+    std::vector<bool> m_drawsDirty{};                       // Per image, models were created or destroyed since its draw buffer was written
+    std::vector<DrawGroup> m_drawGroups{};                  // Indexed by texture id, a single group with bindless textures
+    std::vector<uint32_t> m_groupCursors{};                 // UpdateDraws scratch, next draw of each group
+    std::vector<VkBuffer> m_indirectCommandBuffers{};       // Per image, VkDrawIndexedIndirectCommand written by the cull pass
+    std::vector<MemoryAllocation> m_indirectCommandBufferMemorys{};
+    std::vector<VkBuffer> m_drawCountBuffers{};             // Per image, surviving draws of each group (host visible, read for statistics)
+    std::vector<MemoryAllocation> m_drawCountBufferMemorys{};
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_cmdDrawIndexedIndirectCount = nullptr;
+
+    VkDescriptorSetLayout m_cullSetLayout{};
+    VkPipelineLayout m_cullPipelineLayout{};
+    VkPipeline m_cullPipeline{};
+    VkDescriptorPool m_cullDescriptorPool{};
+    std::vector<VkDescriptorSet> m_cullDescriptorSets{};
+
     // - Pools
     VkCommandPool m_graphicsCommandPool{};
+    VkCommandPool m_transferCommandPool{};
 
     // - Utility
     QueueFamilyIndices m_indices{};
@@ -119,22 +330,27 @@ private:
     std::vector<VkSemaphore> m_imageAvailable{};
     std::vector<VkSemaphore> m_renderFinished{};
     std::vector<VkFence> m_drawFences{};
+    std::vector<VkFence> m_imagesInFlight{}; // Fence of the frame currently using each image, if any
 
     // - Validation
     VkDebugReportCallbackEXT m_callback{};
     VkDebugUtilsMessengerEXT m_debugMessenger{};
 
     // Vulkan Functions
+    int InitRenderer();
+
     // - Create Functions
     void CreateInstance();
     void CreateLogicalDevice();
     void CreateDebugCallback();
     void CreateSurface();
     void CreateSwapChain();
+    void CreateOffscreenTargets();
     void CreateRenderPass();
     void CreateDescriptorSetLayout();
     void CreatePushConstantRange();
     void CreateGraphicsPipeline();
+    void CreateCullPipeline();
     void CreateDepthBufferImage();
     void CreateFrameBuffers();
     void CreateCommandPool();
@@ -145,18 +361,29 @@ private:
     void CreateUniformBuffers();
     void CreateDescriptorPool();
     void CreateDescriptorSets();
+    void CreateDrawBuffers(size_t imageIndex, uint32_t drawCapacity, uint32_t groupCapacity);
+    void DestroyDrawBuffers(size_t imageIndex);
 
     void UpdateUniformBuffers(uint32_t imageIndex);
+    void CullMeshes();
+    void SelectLods();
+    void UpdateDraws(uint32_t imageIndex);
 
     // - Record Functions
+    void BuildDrawList();
     void RecordCommands(uint32_t currentImage);
+    void RecordCullPass(uint32_t currentImage);
+    void RecordIndirectDraws(uint32_t currentImage);
+    void InvalidateCommandBuffers();
+
+    // - Upload Functions
+    UploadBatch CreateUploadBatch();
+    void SubmitUpload(UploadBatch &upload);
+    void ReleaseCompletedUploads();
 
     // - Get Functions
     void GetPhysicalDevice();
 
-    // - Allocate Functions
-    void AllocateDynamicBufferTransferSpace();
-
     // - Support Functions
     // -- Checker Functions
     bool CheckInstanceExtensionsSupport(std::vector<const char *> checkExtensions);
@@ -166,6 +393,7 @@ private:
 
     // -- Getter Functions
     QueueFamilyIndices GetQueueFamilies(VkPhysicalDevice device);
+    static size_t GetPipelineIndex(VertexFormat vertexFormat, VkPrimitiveTopology topology);
     SwapChainDetails GetSwapChainDetails(VkPhysicalDevice device);
 
     // -- Choose Functions
@@ -175,16 +403,23 @@ private:
     VkFormat ChooseSupportedFormat(const std::vector<VkFormat> &formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags);
 
     // -- Create Functions
-    VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+    VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels = 1);
     VkShaderModule CreateShaderModule(const std::vector<char> &code);
     VkImage CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
                         VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propFlags,
-                        VkDeviceMemory *imageMemory);
+                        MemoryAllocation *imageMemory, uint32_t mipLevels = 1);
+
+    VkImage CreateTextureImage(TextureData &texture, UploadBatch *upload, MemoryAllocation *imageMemory);
+    int CreateTexture(TextureData &texture, UploadBatch *upload);
+    DescriptorAllocation CreateTextureDescriptor(VkImageView textureImageView);
+    void WriteBindlessTexture(uint32_t textureId, VkImageView textureImageView);
+    void DestroyTexture(int textureId);
 
-    int CreateTextureImage(const std::string fileName);
-    int CreateTexture(const std::string fileName);
-    int CreateTextureDescriptor(VkImageView textureImageView);
+    // -- Texture Cache Functions
+    int CacheTexture(const std::string &filePath, TextureData &texture, UploadBatch *upload);
+    int AcquireTexture(const std::string fileName, UploadBatch *upload);
 
     // -- Loader Functions
-    stbi_uc *LoadTexture(const std::string fileName, int *width, int *height, VkDeviceSize *imageSize);
+    TextureData LoadTexture(const std::string filePath);
+    bool LoadBakedTexture(const std::string &filePath, TextureData *texture);
 };
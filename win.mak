@@ -1,6 +1,10 @@
 
 # output binary
 BIN := test.exe
+# benchmark binary
+BENCH_BIN := bench.exe
+# texture baker binary
+BAKE_BIN := bake.exe
 
 # files included in the tarball generated by 'make dist' (e.g. add LICENSE file)
 DISTFILES := $(BIN)
@@ -15,11 +19,13 @@ DEPDIR := .d
 
 # object files, auto generated from source files
 OBJS := $(patsubst %,$(OBJDIR)/%.o,$(basename $(SRCS)))
+BENCH_OBJS := $(patsubst %,$(OBJDIR)/%.o,$(basename $(BENCH_SRCS)))
+BAKE_OBJS := $(patsubst %,$(OBJDIR)/%.o,$(basename $(BAKE_SRCS)))
 # dependency files, auto generated from source files
-DEPS := $(patsubst %,$(DEPDIR)/%.d,$(basename $(SRCS)))
+DEPS := $(patsubst %,$(DEPDIR)/%.d,$(basename $(sort $(SRCS) $(BENCH_SRCS) $(BAKE_SRCS))))
 
 # compilers (at least gcc and clang) don't create the subdirectories automatically
-$(shell mkdir -p $(dir $(OBJS)) >/dev/null)
+$(shell mkdir -p $(dir $(OBJS) $(BENCH_OBJS) $(BAKE_OBJS)) >/dev/null)
 $(shell mkdir -p $(dir $(DEPS)) >/dev/null)
 
 # C compiler
@@ -58,6 +64,12 @@ POSTCOMPILE = mv -f $(DEPDIR)/$*.Td $(DEPDIR)/$*.d
 
 all: $(BIN)
 
+.PHONY: bench
+bench: $(BENCH_BIN)
+
+.PHONY: bake
+bake: $(BAKE_BIN)
+
 dist: $(DISTFILES)
 	$(TAR) -cvzf $(DISTOUTPUT) $^
 
@@ -67,7 +79,7 @@ clean:
 
 .PHONY: distclean
 distclean: clean
-	$(RM) $(BIN) $(DISTOUTPUT)
+	$(RM) $(BIN) $(BENCH_BIN) $(BAKE_BIN) $(DISTOUTPUT)
 
 .PHONY: install
 install:
@@ -83,11 +95,17 @@ check:
 
 .PHONY: help
 help:
-	@echo available targets: all dist clean distclean install uninstall check
+	@echo available targets: all bench bake dist clean distclean install uninstall check
 
 $(BIN): $(OBJS)
 	$(LD) $^ $(LINK.o)
 
+$(BENCH_BIN): $(BENCH_OBJS)
+	$(LD) $^ $(LINK.o)
+
+$(BAKE_BIN): $(BAKE_OBJS)
+	$(LD) $^ $(LINK.o)
+
 $(OBJDIR)/%.o: %.c
 $(OBJDIR)/%.o: %.c $(DEPDIR)/%.d
 	$(PRECOMPILE)